@@ -9,6 +9,7 @@
 #include <fstream>
 #include "Log.h"
 #include "HttpReq.h"
+#include "FileHasher.h"
 #include <chrono>
 #include <thread>
 
@@ -1723,7 +1724,8 @@ std::string executeCMDInNewProcessAndReadOutput(LPSTR lpCommandLine)
 }
 #endif
 
-std::string ApiSystem::getCRC32(std::string fileName, bool fromZipContents)
+// Used for the archive formats FileHasher can't read, like 7z
+static std::string get7zCRC32(const std::string& fileName, bool fromZipContents)
 {
 	std::string cmd = "7zr h \"" + fileName + "\"";
 	
@@ -1773,6 +1775,11 @@ std::string ApiSystem::getCRC32(std::string fileName, bool fromZipContents)
 	return crc;
 }
 
+std::string ApiSystem::getCRC32(std::string fileName, bool fromZipContents)
+{
+	return FileHasher::getCRC32(fileName, fromZipContents, [fileName, fromZipContents] { return get7zCRC32(fileName, fromZipContents); });
+}
+
 const char* BACKLIGHT_BRIGHTNESS_NAME = "/sys/class/backlight/backlight/brightness";
 const char* BACKLIGHT_BRIGHTNESS_MAX_NAME = "/sys/class/backlight/backlight/max_brightness";
 #define BACKLIGHT_BUFFER_SIZE 127
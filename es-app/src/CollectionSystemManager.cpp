@@ -21,6 +21,136 @@
 std::string myCollectionsName = "collections";
 
 #define LAST_PLAYED_MAX	50
+#define MOST_PLAYED_MAX	50
+
+// What the auto collections need to know about a game, computed once per game
+struct AutoCollectionGame
+{
+	FileData* file;
+	bool include;	// not excluded from auto collections
+	bool isArcade;	// from an arcade system
+	bool played;
+};
+
+struct AutoCollectionRule
+{
+	CollectionSystemType type;
+	const char* arcadeSystemName; // when set, the games of arcade systems with this "arcadesystemname"
+	bool(*match)(const AutoCollectionGame& game);
+
+	// ranked collections only keep the "limit" games with the highest rank, highest first
+	long long(*rank)(FileData* file);
+	int limit;
+};
+
+// "lastplayed" is stored as YYYYMMDDTHHMMSS : its digits make a number in time order
+static long long getLastPlayedRank(FileData* file)
+{
+	long long rank = 0;
+
+	for (auto c : file->getMetadata("lastplayed"))
+		if (c >= '0' && c <= '9')
+			rank = rank * 10 + (c - '0');
+
+	return rank;
+}
+
+static long long getPlayCountRank(FileData* file)
+{
+	return file->getMetadata().getInt("playcount");
+}
+
+static bool matchPlayers(FileData* file, int val)
+{
+	std::string players = file->getMetadata("players");
+	if (players.empty())
+		return false;
+
+	int min = -1;
+
+	auto split = players.rfind("+");
+	if (split != std::string::npos)
+		players = Utils::String::replace(players, "+", "-999");
+
+	split = players.rfind("-");
+	if (split != std::string::npos)
+	{
+		min = atoi(players.substr(0, split).c_str());
+		players = players.substr(split + 1);
+	}
+
+	int max = atoi(players.c_str());
+	return min <= 0 ? (val == max) : (min <= val && val <= max);
+}
+
+static const AutoCollectionRule autoCollectionRules[] =
+{
+	{ AUTO_ALL_GAMES,       nullptr,        [](const AutoCollectionGame& game) { return game.include; } },
+	{ AUTO_LAST_PLAYED,     nullptr,        [](const AutoCollectionGame& game) { return game.include && game.played; }, getLastPlayedRank, LAST_PLAYED_MAX },
+	{ AUTO_MOST_PLAYED,     nullptr,        [](const AutoCollectionGame& game) { return game.include && game.played; }, getPlayCountRank, MOST_PLAYED_MAX },
+	{ AUTO_NEVER_PLAYED,    nullptr,        [](const AutoCollectionGame& game) { return game.include && !game.played; } },
+	// we may still want to add files we don't want in auto collections in "favorites"
+	{ AUTO_FAVORITES,       nullptr,        [](const AutoCollectionGame& game) { return game.file->getMetadata("favorite") == "true"; } },
+	{ AUTO_ARCADE,          nullptr,        [](const AutoCollectionGame& game) { return game.include && game.isArcade; } },
+	{ AUTO_AT2PLAYERS,      nullptr,        [](const AutoCollectionGame& game) { return matchPlayers(game.file, 2); } }, // batocera
+	{ AUTO_AT4PLAYERS,      nullptr,        [](const AutoCollectionGame& game) { return matchPlayers(game.file, 4); } },
+
+	{ CPS1_COLLECTION,      "cps1",         nullptr },
+	{ CPS2_COLLECTION,      "cps2",         nullptr },
+	{ CPS3_COLLECTION,      "cps3",         nullptr },
+	{ CAVE_COLLECTION,      "cave",         nullptr },
+	{ NEOGEO_COLLECTION,    "neogeo",       nullptr },
+	{ SEGA_COLLECTION,      "sega",         nullptr },
+	{ IREM_COLLECTION,      "irem",         nullptr },
+	{ MIDWAY_COLLECTION,    "midway",       nullptr },
+	{ CAPCOM_COLLECTION,    "capcom",       nullptr },
+	{ TECMO_COLLECTION,     "techmo",       nullptr },
+	{ SNK_COLLECTION,       "snk",          nullptr },
+	{ NAMCO_COLLECTION,     "namco",        nullptr },
+	{ TAITO_COLLECTION,     "taito",        nullptr },
+	{ KONAMI_COLLECTION,    "konami",       nullptr },
+	{ JALECO_COLLECTION,    "jaleco",       nullptr },
+	{ ATARI_COLLECTION,     "atari",        nullptr },
+	{ NINTENDO_COLLECTION,  "nintendo",     nullptr },
+	{ SAMMY_COLLECTION,     "sammy",        nullptr },
+	{ ACCLAIM_COLLECTION,   "acclaim",      nullptr },
+	{ PSIKYO_COLLECTION,    "psikyo",       nullptr },
+	{ KANEKO_COLLECTION,    "kaneko",       nullptr },
+	{ COLECO_COLLECTION,    "coleco",       nullptr },
+	{ ATLUS_COLLECTION,     "atlus",        nullptr },
+	{ BANPRESTO_COLLECTION, "banpresto",    nullptr }
+};
+
+static const AutoCollectionRule* getAutoCollectionRule(CollectionSystemType type)
+{
+	for (auto& rule : autoCollectionRules)
+		if (rule.type == type)
+			return &rule;
+
+	return nullptr;
+}
+
+static bool matchAutoCollection(const AutoCollectionRule* rule, const AutoCollectionGame& game)
+{
+	if (rule->arcadeSystemName != nullptr)
+		return game.isArcade && game.file->getMetadata("arcadesystemname") == rule->arcadeSystemName;
+
+	return rule->match(game);
+}
+
+// moves a game of a ranked collection after the games with the same or a higher rank
+static void placeRankedGame(const AutoCollectionRule* rule, FolderData* rootFolder, FileData* entry)
+{
+	std::vector<FileData*>& childs = (std::vector<FileData*>&) rootFolder->getChildren();
+
+	auto it = std::find(childs.begin(), childs.end(), entry);
+	if (it != childs.end())
+		childs.erase(it);
+
+	long long rank = rule->rank(entry);
+	auto pos = std::upper_bound(childs.begin(), childs.end(), rank, [rule](long long value, FileData* child) { return value > rule->rank(child); });
+	childs.insert(pos, entry);
+}
 
 /* Handling the getting, initialization, deinitialization, saving and deletion of
  * a CollectionSystemManager Instance */
@@ -31,7 +161,8 @@ std::vector<CollectionSystemDecl> CollectionSystemManager::getSystemDecls()
 	CollectionSystemDecl systemDecls[] = {
 		//type                name            long name                 default sort					  theme folder               isCustom     displayIfEmpty
 		{ AUTO_ALL_GAMES,       "all",          _("all games"),         FileSorts::FILENAME_ASCENDING,    "auto-allgames",           false,       true },
-		{ AUTO_LAST_PLAYED,     "recent",       _("last played"),       FileSorts::LASTPLAYED_ASCENDING,  "auto-lastplayed",         false,       true },
+		{ AUTO_LAST_PLAYED,     "recent",       _("last played"),       FileSorts::LASTPLAYED_DESCENDING, "auto-lastplayed",         false,       true },
+		{ AUTO_MOST_PLAYED,     "mostplayed",   _("most played"),       FileSorts::TIMESPLAYED_DESCENDING,"auto-mostplayed",         false,       true },
 		{ AUTO_FAVORITES,       "favorites",    _("favorites"),         FileSorts::FILENAME_ASCENDING,    "auto-favorites",          false,       true },
 		{ AUTO_AT2PLAYERS,      "2players",	    _("2 players"),         FileSorts::FILENAME_ASCENDING,    "auto-at2players",         false,       true }, // batocera
 		{ AUTO_AT4PLAYERS,      "4players",     _("4 players"),         FileSorts::FILENAME_ASCENDING,    "auto-at4players",         false,       true }, // batocera
@@ -273,90 +404,94 @@ void CollectionSystemManager::refreshCollectionSystems(FileData* file)
 	if (!file->getSystem()->isGameSystem() || file->getType() != GAME)
 		return;
 
-	std::map<std::string, CollectionSystemData> allCollections;
-	allCollections.insert(mAutoCollectionSystemsData.cbegin(), mAutoCollectionSystemsData.cend());
-	allCollections.insert(mCustomCollectionSystemsData.cbegin(), mCustomCollectionSystemsData.cend());
+	for (auto& sysData : mAutoCollectionSystemsData)
+		updateCollectionSystem(file, sysData.second);
 
-	for(auto sysDataIt = allCollections.cbegin(); sysDataIt != allCollections.cend(); sysDataIt++)
-	{
-		updateCollectionSystem(file, sysDataIt->second);
-	}
+	for (auto& sysData : mCustomCollectionSystemsData)
+		updateCollectionSystem(file, sysData.second);
 }
 
 void CollectionSystemManager::updateCollectionSystem(FileData* file, CollectionSystemData sysData)
 {
-	if (sysData.isPopulated)
+	if (!sysData.isPopulated)
+		return;
+
+	// collection files use the full path as key, to avoid clashes
+	std::string key = file->getFullPath();
+
+	SystemData* curSys = sysData.system;
+	FileData* collectionEntry = curSys->getRootFolder()->FindByPath(key);
+	FolderData* rootFolder = curSys->getRootFolder();
+
+	// Auto collections follow the metadata, custom collections are only changed by the user
+	bool included = (collectionEntry != nullptr);
+
+	const AutoCollectionRule* rule = sysData.decl.isCustom ? nullptr : getAutoCollectionRule(sysData.decl.type);
+	if (rule != nullptr)
 	{
-		// collection files use the full path as key, to avoid clashes
-		std::string key = file->getFullPath();
+		AutoCollectionGame game = { file, includeFileInAutoCollections(file), file->getSystem()->hasPlatformId(PlatformIds::ARCADE), file->getMetadata("playcount") > "0" };
+		included = matchAutoCollection(rule, game);
 
-		SystemData* curSys = sysData.system;
-		FileData* collectionEntry = curSys->getRootFolder()->FindByPath(key);
-		FolderData* rootFolder = curSys->getRootFolder();
+		// a new game only enters a full ranked collection above its lowest game
+		auto& childs = rootFolder->getChildren();
+		if (included && collectionEntry == nullptr && rule->rank != nullptr && (int)childs.size() >= rule->limit && !childs.empty() && rule->rank(file) <= rule->rank(childs.back()))
+			included = false;
+	}
 
-		std::string name = curSys->getName();
+	std::shared_ptr<IGameListView> listView = ViewController::get()->getGameListView(curSys, false);
 
-		if (collectionEntry != nullptr) 
-		{		
-			// remove from index, so we can re-index metadata after refreshing
-			curSys->removeFromIndex(collectionEntry);
-			collectionEntry->refreshMetadata();
-			// found and we are removing
-			if (name == "favorites" && file->getMetadata("favorite") == "false") {
-				// need to check if still marked as favorite, if not remove
-				ViewController::get()->getGameListView(curSys).get()->remove(collectionEntry, false);
+	if (collectionEntry != nullptr) 
+	{		
+		// remove from index, so we can re-index metadata after refreshing
+		curSys->removeFromIndex(collectionEntry);
+		collectionEntry->refreshMetadata();
 
-				// Send an event when removing from favorites
-				ViewController::get()->onFileChanged(file, FILE_METADATA_CHANGED);
-				ViewController::get()->getGameListView(curSys)->onFileChanged(collectionEntry, FILE_METADATA_CHANGED);
-			}
+		if (!included)
+		{
+			// found and we are removing
+			if (listView == nullptr)
+				delete collectionEntry;
 			else
-			{
-				// re-index with new metadata
-				curSys->addToIndex(collectionEntry);
-				ViewController::get()->onFileChanged(collectionEntry, FILE_METADATA_CHANGED);
-			}
+				listView.get()->remove(collectionEntry, false);
+
+			// Send an event when removing from a collection
+			ViewController::get()->onFileChanged(file, FILE_METADATA_CHANGED);
 		}
 		else
 		{
-			// we didn't find it here - we need to check if we should add it
-			if (name == "recent" && file->getMetadata("playcount") > "0" && includeFileInAutoCollections(file) ||
-				name == "favorites" && file->getMetadata("favorite") == "true") {
-				CollectionFileData* newGame = new CollectionFileData(file, curSys);
-				rootFolder->addChild(newGame);
-				curSys->addToIndex(newGame);
-				ViewController::get()->onFileChanged(file, FILE_METADATA_CHANGED);
-				ViewController::get()->getGameListView(curSys)->onFileChanged(newGame, FILE_METADATA_CHANGED);
-			}
-		}
+			// re-index with new metadata
+			curSys->addToIndex(collectionEntry);
 
-		curSys->updateDisplayedGameCount();
-
-		if (name == "recent")
-		{
-			sortLastPlayed(curSys);
-			trimCollectionCount(rootFolder, LAST_PLAYED_MAX);
-			ViewController::get()->onFileChanged(rootFolder, FILE_METADATA_CHANGED);
+			if (rule != nullptr && rule->rank != nullptr)
+				placeRankedGame(rule, rootFolder, collectionEntry);
+			ViewController::get()->onFileChanged(collectionEntry, FILE_METADATA_CHANGED);
 		}
-		else 
-			ViewController::get()->onFileChanged(rootFolder, FILE_SORTED);
 	}
-}
+	else if (included)
+	{
+		// we didn't find it here and it now belongs to the collection
+		CollectionFileData* newGame = new CollectionFileData(file, curSys);
+		rootFolder->addChild(newGame);
+		curSys->addToIndex(newGame);
 
-void CollectionSystemManager::sortLastPlayed(SystemData* system)
-{
-	if (system->getName() != "recent")
-		return;
+		if (rule != nullptr && rule->rank != nullptr)
+			placeRankedGame(rule, rootFolder, newGame);
 
-	FolderData* rootFolder = system->getRootFolder();
-	system->setSortId(FileSorts::LASTPLAYED_DESCENDING);
+		ViewController::get()->onFileChanged(file, FILE_METADATA_CHANGED);
 
-	const FileSorts::SortType& sort = FileSorts::getSortTypes().at(system->getSortId());
+		if (listView != nullptr)
+			listView->onFileChanged(newGame, FILE_METADATA_CHANGED);
+	}
 
-	std::vector<FileData*>& childs = (std::vector<FileData*>&) rootFolder->getChildren();
-	std::sort(childs.begin(), childs.end(), sort.comparisonFunction);
-	if (!sort.ascending)
-		std::reverse(childs.begin(), childs.end());
+	curSys->updateDisplayedGameCount();
+
+	if (rule != nullptr && rule->rank != nullptr)
+	{
+		trimCollectionCount(rootFolder, rule->limit);
+		ViewController::get()->onFileChanged(rootFolder, FILE_METADATA_CHANGED);
+	}
+	else 
+		ViewController::get()->onFileChanged(rootFolder, FILE_SORTED);
 }
 
 void CollectionSystemManager::trimCollectionCount(FolderData* rootFolder, int limit)
@@ -787,163 +922,115 @@ SystemData* CollectionSystemManager::createNewCollectionEntry(std::string name,
 // populates an Automatic Collection System
 void CollectionSystemManager::populateAutoCollection(CollectionSystemData* sysData)
 {
-	SystemData* newSys = sysData->system;
-	CollectionSystemDecl sysDecl = sysData->decl;
-	FolderData* rootFolder = newSys->getRootFolder(); 
-	
-	for(auto sysIt = SystemData::sSystemVector.cbegin(); sysIt != SystemData::sSystemVector.cend(); sysIt++)
+	std::vector<CollectionSystemData*> collections;
+	collections.push_back(sysData);
+	populateAutoCollections(collections);
+}
+
+// populates several Automatic Collection Systems with a single pass over the games
+void CollectionSystemManager::populateAutoCollections(const std::vector<CollectionSystemData*>& collections)
+{
+	typedef std::pair<long long, FileData*> RankedGame;
+
+	struct RankedCollection
 	{
-        std::vector<PlatformIds::PlatformId> platforms = (*sysIt)->getPlatformIds();
-        bool isArcade =  std::find(platforms.begin(), platforms.end(), PlatformIds::ARCADE) != platforms.end();
+		const AutoCollectionRule* rule;
+		CollectionSystemData* sysData;
+		std::vector<RankedGame> best; // min-heap of the best games found so far
+	};
+
+	std::vector<std::pair<const AutoCollectionRule*, CollectionSystemData*>> rules;
+	std::vector<RankedCollection> rankedCollections;
+	std::unordered_map<std::string, CollectionSystemData*> arcadeSystems;
+
+	for (auto sysData : collections)
+	{
+		const AutoCollectionRule* rule = getAutoCollectionRule(sysData->decl.type);
+		if (rule == nullptr)
+			continue;
+
+		if (rule->arcadeSystemName != nullptr)
+			arcadeSystems[rule->arcadeSystemName] = sysData;
+		else if (rule->rank != nullptr)
+		{
+			RankedCollection ranked;
+			ranked.rule = rule;
+			ranked.sysData = sysData;
+			rankedCollections.push_back(ranked);
+		}
+		else
+			rules.push_back(std::make_pair(rule, sysData));
+	}
+
+	auto lowestFirst = [](const RankedGame& a, const RankedGame& b) { return a.first > b.first; };
 
+	auto addGame = [](CollectionSystemData* sysData, FileData* file)
+	{
+		CollectionFileData* newGame = new CollectionFileData(file, sysData->system);
+		sysData->system->getRootFolder()->addChild(newGame);
+		sysData->system->addToIndex(newGame);
+	};
+
+	for (auto system : SystemData::sSystemVector)
+	{
 		// we won't iterate all collections
-		if ((*sysIt)->isGameSystem() && !(*sysIt)->isCollection()) 
+		if (!system->isGameSystem() || system->isCollection())
+			continue;
+
+		bool isArcade = system->hasPlatformId(PlatformIds::ARCADE);
+
+		system->getRootFolder()->visitFiles(GAME, false, [&](FileData* file)
 		{
-			std::vector<FileData*> files = (*sysIt)->getRootFolder()->getFilesRecursive(GAME);
-			for(auto gameIt = files.cbegin(); gameIt != files.cend(); gameIt++)
+			AutoCollectionGame game = { file, includeFileInAutoCollections(file), isArcade, file->getMetadata("playcount") > "0" };
+
+			for (auto& rule : rules)
+				if (rule.first->match(game))
+					addGame(rule.second, file);
+
+			for (auto& ranked : rankedCollections)
 			{
-				bool include = includeFileInAutoCollections((*gameIt));
+				if (!ranked.rule->match(game))
+					continue;
 
-                std::string systemarcadename;
-				switch(sysDecl.type) 
+				RankedGame item(ranked.rule->rank(file), file);
+
+				if ((int)ranked.best.size() < ranked.rule->limit)
 				{
-					case AUTO_LAST_PLAYED:
-						include = include && (*gameIt)->getMetadata("playcount") > "0";
-						break;
-					case AUTO_NEVER_PLAYED:
-						include = include && !((*gameIt)->getMetadata("playcount") > "0");
-						break;					
-					case AUTO_FAVORITES:
-						// we may still want to add files we don't want in auto collections in "favorites"
-						include = (*gameIt)->getMetadata("favorite") == "true";
-						break;
-					case AUTO_ARCADE:
-						include = include && isArcade;
-						break;
-					case CPS1_COLLECTION:
-                        systemarcadename = "cps1";
-                        break;
-                    case CPS2_COLLECTION:
-                        systemarcadename = "cps2";
-                        break;
-                    case CPS3_COLLECTION:
-                        systemarcadename = "cps3";
-                        break;
-                    case CAVE_COLLECTION:
-                        systemarcadename = "cave";
-                        break;
-                    case NEOGEO_COLLECTION:
-                        systemarcadename = "neogeo";
-                        break;
-                    case SEGA_COLLECTION:
-                        systemarcadename = "sega";
-                        break;
-                    case IREM_COLLECTION:
-                        systemarcadename = "irem";
-                        break;
-                    case MIDWAY_COLLECTION:
-                        systemarcadename = "midway";
-                        break;
-                    case CAPCOM_COLLECTION:
-                        systemarcadename = "capcom";
-                        break;
-                    case TECMO_COLLECTION:
-                        systemarcadename = "techmo";
-                        break;
-                    case SNK_COLLECTION:
-                        systemarcadename = "snk";
-                        break;
-                    case NAMCO_COLLECTION:
-                        systemarcadename = "namco";
-                        break;
-                    case TAITO_COLLECTION:
-                        systemarcadename = "taito";
-                        break;
-                    case KONAMI_COLLECTION:
-                        systemarcadename = "konami";
-                        break;
-                    case JALECO_COLLECTION:
-                        systemarcadename = "jaleco";
-                        break;
-                    case ATARI_COLLECTION:
-                        systemarcadename = "atari";
-                        break;
-                    case NINTENDO_COLLECTION:
-                        systemarcadename = "nintendo";
-                        break;
-                    case SAMMY_COLLECTION:
-                        systemarcadename = "sammy";
-                        break;
-                    case ACCLAIM_COLLECTION:
-                        systemarcadename = "acclaim";
-                        break;
-                    case PSIKYO_COLLECTION:
-                        systemarcadename = "psikyo";
-                        break;
-                    case KANEKO_COLLECTION:
-                        systemarcadename = "kaneko";
-                        break;
-                    case COLECO_COLLECTION:
-                        systemarcadename = "coleco";
-                        break;
-                    case ATLUS_COLLECTION:
-                        systemarcadename = "atlus";
-                        break;
-                    case BANPRESTO_COLLECTION:
-                        systemarcadename = "banpresto";
-                        break;
-
-					case AUTO_AT2PLAYERS: // batocera
-					case AUTO_AT4PLAYERS:
-						{
-							std::string players = (*gameIt)->getMetadata("players");
-							if (players.empty())
-								include = false;
-							else
-							{
-								int min = -1;
-
-								auto split = players.rfind("+");
-								if (split != std::string::npos)
-									players = Utils::String::replace(players, "+", "-999");
-
-								split = players.rfind("-");
-								if (split != std::string::npos)
-								{
-									min = atoi(players.substr(0, split).c_str());
-									players = players.substr(split + 1);
-								}
-
-								int max = atoi(players.c_str());
-								int val = (sysDecl.type == AUTO_AT2PLAYERS ? 2 : 4);
-								include = min <= 0 ? (val == max) : (min <= val && val <= max);
-							}
-						}
-						break;
+					ranked.best.push_back(item);
+					std::push_heap(ranked.best.begin(), ranked.best.end(), lowestFirst);
 				}
-				
-                std::vector<PlatformIds::PlatformId> platforms = (*sysIt)->getPlatformIds();
-				
-				if (!systemarcadename.empty())
-					include = isArcade && (*gameIt)->getMetadata("arcadesystemname") == systemarcadename;
-				    
-				if (include) 
+				else if (!ranked.best.empty() && item.first > ranked.best.front().first)
 				{
-					CollectionFileData* newGame = new CollectionFileData(*gameIt, newSys);
-					rootFolder->addChild(newGame);
-					newSys->addToIndex(newGame);
+					std::pop_heap(ranked.best.begin(), ranked.best.end(), lowestFirst);
+					ranked.best.back() = item;
+					std::push_heap(ranked.best.begin(), ranked.best.end(), lowestFirst);
 				}
 			}
-		}
+
+			if (isArcade && !arcadeSystems.empty())
+			{
+				auto it = arcadeSystems.find(file->getMetadata("arcadesystemname"));
+				if (it != arcadeSystems.cend())
+					addGame(it->second, file);
+			}
+
+			return true;
+		});
 	}
 
-	if (sysDecl.type == AUTO_LAST_PLAYED)
+	// highest rank first
+	for (auto& ranked : rankedCollections)
 	{
-		sortLastPlayed(newSys);
-		trimCollectionCount(rootFolder, LAST_PLAYED_MAX);
+		std::sort_heap(ranked.best.begin(), ranked.best.end(), lowestFirst);
+
+		for (auto& item : ranked.best)
+			addGame(ranked.sysData, item.second);
+
+		ranked.sysData->system->setSortId(ranked.sysData->decl.defaultSortId);
 	}
 
-	sysData->isPopulated = true;
+	for (auto sysData : collections)
+		sysData->isPopulated = true;
 }
 
 // populates a Custom Collection System
@@ -1028,23 +1115,24 @@ void CollectionSystemManager::removeCollectionsFromDisplayedSystems()
 
 void CollectionSystemManager::addEnabledCollectionsToDisplayedSystems(std::map<std::string, CollectionSystemData>* colSystemData, std::unordered_map<std::string, FileData*>* pMap)
 {
+	// populate the enabled auto collections at once
+	std::vector<CollectionSystemData*> autoCollections;
+	for (auto& sysData : *colSystemData)
+		if (sysData.second.isEnabled && !sysData.second.isPopulated && !sysData.second.decl.isCustom)
+			autoCollections.push_back(&sysData.second);
+
+	if (!autoCollections.empty())
+		populateAutoCollections(autoCollections);
+
 	// add auto enabled ones
 	for(std::map<std::string, CollectionSystemData>::iterator it = colSystemData->begin() ; it != colSystemData->end() ; it++ )
 	{
 		if(it->second.isEnabled)
 		{
 			// check if populated, otherwise populate
-			if (!it->second.isPopulated)
-			{
-				if(it->second.decl.isCustom)
-				{
-					populateCustomCollection(&(it->second), pMap);
-				}
-				else
-				{
-					populateAutoCollection(&(it->second));
-				}
-			}
+			if (!it->second.isPopulated && it->second.decl.isCustom)
+				populateCustomCollection(&(it->second), pMap);
+
 			// check if it has its own view
 			if(!it->second.decl.isCustom || themeFolderExists(it->first) || !Settings::getInstance()->getBool("UseCustomCollectionsSystem")) // batocera
 			{
@@ -21,6 +21,7 @@ enum CollectionSystemType
 	AUTO_AT2PLAYERS,
 	AUTO_AT4PLAYERS,
 	AUTO_NEVER_PLAYED,
+	AUTO_MOST_PLAYED,
 	AUTO_ARCADE,
 	CUSTOM_COLLECTION,
     CPS1_COLLECTION,
@@ -111,6 +112,7 @@ public:
 	void updateCollectionFolderMetadata(SystemData* sys);
 
     void populateAutoCollection(CollectionSystemData* sysData);
+	void populateAutoCollections(const std::vector<CollectionSystemData*>& collections);
 
 private:
 	static CollectionSystemManager* sInstance;
@@ -140,7 +142,6 @@ private:
 	std::vector<std::string> getUserCollectionThemeFolders();
 
 	void trimCollectionCount(FolderData* rootFolder, int limit);
-	void sortLastPlayed(SystemData* system);
 
 	bool themeFolderExists(std::string folder);
 
@@ -7,11 +7,14 @@
 #include "CollectionSystemManager.h"
 #include "FileFilterIndex.h"
 #include "FileSorts.h"
+#include "GameMediaIndex.h"
+#include "LocalArtCache.h"
 #include "Log.h"
 #include "MameNames.h"
 #include "platform.h"
 #include "Scripting.h"
 #include "SystemData.h"
+#include "VideoPreviewCache.h"
 #include "VolumeControl.h"
 #include "Window.h"
 #include "views/UIModeController.h"
@@ -23,10 +26,19 @@
 #include "ApiSystem.h"
 #include <time.h>
 
+// Read for every game
+static SettingValue<bool> sShowFilenames("ShowFilenames");
+static SettingValue<bool> sLocalArt("LocalArt");
+static SettingValue<std::string> sFolderViewMode("FolderViewMode");
+static SettingValue<bool> sShowHiddenFiles("ShowHiddenFiles");
+static SettingValue<bool> sForceDisableFilters("ForceDisableFilters");
+
 FileData::FileData(FileType type, const std::string& path, SystemData* system)
 	: mType(type), mSystem(system), mParent(NULL), mMetadata(type == GAME ? GAME_METADATA : FOLDER_METADATA) // metadata is REALLY set in the constructor!
 {
-	mPath = Utils::FileSystem::createRelativePath(path, getSystemEnvData()->mStartPath, false);
+	// Interned : getPath() is called for every game when sorting, filtering, looking for medias...
+	const std::string& startPath = getSystemEnvData()->mStartPath;
+	mPath = Utils::FileSystem::InternedPath::get(path.empty() ? startPath : Utils::FileSystem::resolveRelativePath(path, startPath, true));
 
 	// metadata needs at least a name field (since that's what getName() will return)
 	if (mMetadata.get("name").empty())
@@ -35,17 +47,15 @@ FileData::FileData(FileType type, const std::string& path, SystemData* system)
 	mMetadata.resetChangedFlag();
 }
 
-const std::string FileData::getPath() const
+const std::string& FileData::getPath() const
 { 	
-	if (mPath.empty())
-		return getSystemEnvData()->mStartPath;
-
-	return Utils::FileSystem::resolveRelativePath(mPath, getSystemEnvData()->mStartPath, true);	
+	static const std::string empty;
+	return mPath != nullptr ? mPath->getPath() : empty;
 }
 
 const std::string FileData::getConfigurationName()
 {
-	std::string gameConf = Utils::FileSystem::getFileName(getPath());
+	std::string gameConf = getFileName();
 	gameConf = Utils::String::replace(gameConf, "=", "");
 	gameConf = Utils::String::replace(gameConf, "#", "");
 	gameConf = getSourceFileData()->getSystem()->getName() + std::string("[\"") + gameConf + std::string("\"]");
@@ -68,12 +78,17 @@ FileData::~FileData()
 		mParent->removeChild(this);
 
 	if(mType == GAME)
-		mSystem->removeFromIndex(this);	
+	{
+		mSystem->removeFromIndex(this);
+
+		if (!mSystem->isCollection())
+			GameMediaIndex::onGameRemoved();
+	}
 }
 
 std::string FileData::getDisplayName() const
 {
-	std::string stem = Utils::FileSystem::getStem(getPath());
+	std::string stem = getStem();
 	if(mSystem && mSystem->hasPlatformId(PlatformIds::ARCADE) || mSystem->hasPlatformId(PlatformIds::NEOGEO))
 		stem = MameNames::getInstance()->getRealName(stem);
 
@@ -93,7 +108,7 @@ const std::string FileData::getThumbnailPath()
 	if(thumbnail.empty())
 	{			
 		// no image, try to use local image
-		if(thumbnail.empty() && Settings::getInstance()->getBool("LocalArt"))
+		if(thumbnail.empty() && sLocalArt.get())
 		{
 			const char* extList[2] = { ".png", ".jpg" };
 			for(int i = 0; i < 2; i++)
@@ -101,7 +116,7 @@ const std::string FileData::getThumbnailPath()
 				if(thumbnail.empty())
 				{
 					std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-thumb" + extList[i];
-					if (Utils::FileSystem::exists(path))
+					if (LocalArtCache::exists(path))
 					{
 						setMetadata("thumbnail", path);
 						thumbnail = path;
@@ -114,7 +129,7 @@ const std::string FileData::getThumbnailPath()
 			thumbnail = getMetadata().get("image");
 
 		// no image, try to use local image
-		if (thumbnail.empty() && Settings::getInstance()->getBool("LocalArt"))
+		if (thumbnail.empty() && sLocalArt.get())
 		{
 			const char* extList[2] = { ".png", ".jpg" };
 			for (int i = 0; i < 2; i++)
@@ -122,10 +137,10 @@ const std::string FileData::getThumbnailPath()
 				if (thumbnail.empty())
 				{
 					std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-image" + extList[i];					
-					if (!Utils::FileSystem::exists(path))
+					if (!LocalArtCache::exists(path))
 						path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + extList[i];
 
-					if (Utils::FileSystem::exists(path))
+					if (LocalArtCache::exists(path))
 						thumbnail = path;
 				}
 			}
@@ -150,23 +165,12 @@ const bool FileData::getKidGame()
 	return getMetadata().get("kidgame") != "false";
 }
 
-static std::shared_ptr<bool> showFilenames;
-
-void FileData::resetSettings() 
-{
-	showFilenames = nullptr;
-}
-
 const std::string FileData::getName()
 {
-	if (showFilenames == nullptr)
-		showFilenames = std::make_shared<bool>(Settings::getInstance()->getBool("ShowFilenames"));
-
-	// Faster than accessing map each time
-	if (*showFilenames)
+	if (sShowFilenames.get())
 	{
 		if (mSystem != nullptr && !mSystem->hasPlatformId(PlatformIds::ARCADE) && !mSystem->hasPlatformId(PlatformIds::NEOGEO))
-			return Utils::FileSystem::getStem(getPath());
+			return getStem();
 		else
 			return getDisplayName();
 	}
@@ -179,10 +183,10 @@ const std::string FileData::getVideoPath()
 	std::string video = getMetadata().get("video");
 	
 	// no video, try to use local video
-	if(video.empty() && Settings::getInstance()->getBool("LocalArt"))
+	if(video.empty() && sLocalArt.get())
 	{
 		std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-video.mp4";
-		if (Utils::FileSystem::exists(path))
+		if (LocalArtCache::exists(path))
 		{
 			setMetadata("video", path);
 			video = path;
@@ -197,7 +201,7 @@ const std::string FileData::getMarqueePath()
 	std::string marquee = getMetadata().get("marquee");
 
 	// no marquee, try to use local marquee
-	if (marquee.empty() && Settings::getInstance()->getBool("LocalArt"))
+	if (marquee.empty() && sLocalArt.get())
 	{
 		const char* extList[2] = { ".png", ".jpg" };
 		for(int i = 0; i < 2; i++)
@@ -205,7 +209,7 @@ const std::string FileData::getMarqueePath()
 			if(marquee.empty())
 			{
 				std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-marquee" + extList[i];
-				if (Utils::FileSystem::exists(path))
+				if (LocalArtCache::exists(path))
 				{
 					setMetadata("marquee", path);
 					marquee = path;
@@ -227,7 +231,7 @@ const std::string FileData::getImagePath()
 		if (getSystemName() == "imageviewer")
 			image = getPath();
 
-		if (Settings::getInstance()->getBool("LocalArt"))
+		if (sLocalArt.get())
 		{
 			const char* extList[2] = { ".png", ".jpg" };
 			for (int i = 0; i < 2; i++)
@@ -235,10 +239,10 @@ const std::string FileData::getImagePath()
 				if (image.empty())
 				{
 					std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-image" + extList[i];
-					if (!Utils::FileSystem::exists(path))
+					if (!LocalArtCache::exists(path))
 						path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + extList[i];
 
-					if (Utils::FileSystem::exists(path))
+					if (LocalArtCache::exists(path))
 					{
 						setMetadata("image", path);
 						image = path;
@@ -259,7 +263,7 @@ const bool FileData::isArcadeAsset()
 {
 	if (mSystem && (mSystem->hasPlatformId(PlatformIds::ARCADE) || mSystem->hasPlatformId(PlatformIds::NEOGEO)))
 	{	
-		const std::string stem = Utils::FileSystem::getStem(getPath());
+		const std::string stem = getStem();
 		return MameNames::getInstance()->isBios(stem) || MameNames::getInstance()->isDevice(stem);		
 	}
 
@@ -278,6 +282,7 @@ void FileData::launchGame(Window* window, LaunchGameOptions options)
 
 	AudioManager::getInstance()->deinit(); // batocera
 	VolumeControl::getInstance()->deinit();
+	VideoPreviewCache::stop();
 
 	//ThreadedScraper::pause();
 
@@ -288,7 +293,7 @@ void FileData::launchGame(Window* window, LaunchGameOptions options)
 	std::string command = getSystemEnvData()->mLaunchCommand;
 
 	const std::string rom = Utils::FileSystem::getEscapedPath(getPath());
-	const std::string basename = Utils::FileSystem::getStem(getPath());
+	const std::string basename = getStem();
 	const std::string rom_raw = Utils::FileSystem::getPreferredPath(getPath());
 
 	command = Utils::String::replace(command, "%SYSTEM%", systemName); // batocera
@@ -426,7 +431,7 @@ SystemEnvironmentData* CollectionFileData::getSystemEnvData() const
 	return mSourceFileData->getSystemEnvData();
 }
 
-const std::string CollectionFileData::getPath() const
+const std::string& CollectionFileData::getPath() const
 {
 	return mSourceFileData->getPath();
 }
@@ -477,13 +482,13 @@ const std::vector<FileData*> FolderData::getChildrenListToDisplay()
 {
 	std::vector<FileData*> ret;
 
-	std::string showFoldersMode = Settings::getInstance()->getString("FolderViewMode");
+	const std::string& showFoldersMode = sFolderViewMode.get();
 
 
-	bool showHiddenFiles = Settings::getInstance()->getBool("ShowHiddenFiles");
+	bool showHiddenFiles = sShowHiddenFiles.get();
 	bool filterKidGame = false;
 
-	if (!Settings::getInstance()->getBool("ForceDisableFilters"))
+	if (!sForceDisableFilters.get())
 	{
 		if (UIModeController::getInstance()->isUIModeKiosk())
 			showHiddenFiles = false;
@@ -559,15 +564,13 @@ const std::vector<FileData*> FolderData::getChildrenListToDisplay()
 
 FileData* FolderData::findUniqueGameForFolder()
 {
-	auto games = this->getFilesRecursive(GAME);
-	if (games.size() == 1)
-	{
-		auto it = games.cbegin();
-		if ((*it)->getType() == GAME)
-			return (*it);
-	}
+	// Stops at the second game
+	FileData* game = nullptr;
+	int count = 0;
 
-	return nullptr;
+	visitFiles(GAME, false, [&game, &count](FileData* file) { game = file; return ++count < 2; });
+
+	return count == 1 ? game : nullptr;
 }
 
 std::vector<FileData*> FolderData::getFlatGameList(bool displayedOnly, SystemData* system) const 
@@ -578,29 +581,39 @@ std::vector<FileData*> FolderData::getFlatGameList(bool displayedOnly, SystemDat
 std::vector<FileData*> FolderData::getFilesRecursive(unsigned int typeMask, bool displayedOnly, SystemData* system) const
 {
 	std::vector<FileData*> out;
+	visitFiles(typeMask, displayedOnly, [&out](FileData* file) { out.push_back(file); return true; }, system);
+	return out;
+}
 
-	FileFilterIndex* idx = (system != nullptr ? system : mSystem)->getIndex(false);
-
-	for (auto it = mChildren.cbegin(); it != mChildren.cend(); it++)
+// The filter index is resolved once for the whole walk
+static bool visitFolderFiles(const FolderData* folder, unsigned int typeMask, FileFilterIndex* idx, FolderData::FileVisitorFunc visitor, void* context)
+{
+	for (auto child : folder->getChildren())
 	{
-		if ((*it)->getType() & typeMask)
-		{
-			if (!displayedOnly || idx == nullptr || !idx->isFiltered() || idx->showFile(*it))
-				out.push_back(*it);
-		}
+		if ((child->getType() & typeMask) && (idx == nullptr || idx->showFile(child)))
+			if (!visitor(child, context))
+				return false;
 
-		if ((*it)->getType() != FOLDER)
-			continue;
+		if (child->getType() == FOLDER && !((FolderData*)child)->getChildren().empty())
+			if (!visitFolderFiles((FolderData*)child, typeMask, idx, visitor, context))
+				return false;
+	}
 
-		FolderData* folder = (FolderData*)(*it);
-		if (folder->getChildren().size() > 0)
-		{
-			std::vector<FileData*> subchildren = folder->getFilesRecursive(typeMask, displayedOnly, system);
-			out.insert(out.cend(), subchildren.cbegin(), subchildren.cend());
-		}
+	return true;
+}
+
+bool FolderData::visitFilesRaw(unsigned int typeMask, bool displayedOnly, FileVisitorFunc visitor, void* context, SystemData* system) const
+{
+	FileFilterIndex* idx = nullptr;
+
+	if (displayedOnly)
+	{
+		idx = (system != nullptr ? system : mSystem)->getIndex(false);
+		if (idx != nullptr && !idx->isFiltered())
+			idx = nullptr;
 	}
 
-	return out;
+	return visitFolderFiles(this, typeMask, idx, visitor, context);
 }
 
 void FolderData::addChild(FileData* file, bool assignParent)
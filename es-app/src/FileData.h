@@ -3,6 +3,7 @@
 #define ES_APP_FILE_DATA_H
 
 #include "utils/FileSystemUtil.h"
+#include "utils/InternedPath.h"
 #include "MetaData.h"
 #include <unordered_map>
 
@@ -59,7 +60,7 @@ public:
 
 	inline SystemData* getSystem() const { return mSystem; }
 
-	virtual const std::string getPath() const;
+	virtual const std::string& getPath() const;
 
 	virtual SystemEnvironmentData* getSystemEnvData() const;
 
@@ -81,7 +82,8 @@ public:
 	virtual std::string getKey();
 	const bool isArcadeAsset();
 	inline std::string getFullPath() { return getPath(); };
-	inline std::string getFileName() { return Utils::FileSystem::getFileName(getPath()); };
+	inline std::string getFileName() { return mPath != nullptr ? mPath->getName() : std::string(); };
+	inline std::string getStem() const { return mPath != nullptr ? mPath->getStem() : std::string(); };
 	virtual FileData* getSourceFileData();
 	virtual std::string getSystemName() const;
 
@@ -93,7 +95,6 @@ public:
 
 	void launchGame(Window* window, LaunchGameOptions options = LaunchGameOptions());
 
-	static void resetSettings();
 	
 	virtual const MetaDataList& getMetadata() const { return mMetadata; }
 	virtual MetaDataList& getMetadata() { return mMetadata; }
@@ -108,7 +109,7 @@ private:
 
 protected:	
 	FolderData* mParent;
-	std::string mPath;
+	const Utils::FileSystem::InternedPath* mPath;
 	FileType mType;
 	SystemData* mSystem;
 };
@@ -122,7 +123,7 @@ public:
 	void refreshMetadata();
 	FileData* getSourceFileData();
 	std::string getKey();
-	virtual const std::string getPath() const;
+	virtual const std::string& getPath() const;
 
 	virtual std::string getSystemName() const;
 	virtual SystemEnvironmentData* getSystemEnvData() const;
@@ -168,6 +169,32 @@ public:
 	inline const std::vector<FileData*>& getChildren() const { return mChildren; }
 	const std::vector<FileData*> getChildrenListToDisplay();
 	std::vector<FileData*> getFilesRecursive(unsigned int typeMask, bool displayedOnly = false, SystemData* system = nullptr) const;
+
+	// Walks the tree without building any list : visitor is called with each file matching typeMask (and the filters
+	// when displayedOnly is set), depth first, and returns false to stop. Returns false if the walk was stopped.
+	template<typename Visitor>
+	bool visitFiles(unsigned int typeMask, bool displayedOnly, const Visitor& visitor, SystemData* system = nullptr) const
+	{
+		return visitFilesRaw(typeMask, displayedOnly, [](FileData* file, void* context) { return (*(const Visitor*)context)(file); }, (void*)&visitor, system);
+	}
+
+	// Same walk with a plain function, context is given back to it. Named apart so that it can't be picked instead of visitFiles
+	typedef bool (*FileVisitorFunc)(FileData* file, void* context);
+	bool visitFilesRaw(unsigned int typeMask, bool displayedOnly, FileVisitorFunc visitor, void* context, SystemData* system = nullptr) const;
+
+	// Number of files matching typeMask, and predicate if given
+	template<typename Predicate>
+	size_t countFiles(unsigned int typeMask, bool displayedOnly, const Predicate& predicate) const
+	{
+		size_t count = 0;
+		visitFiles(typeMask, displayedOnly, [&count, &predicate](FileData* file) { if (predicate(file)) count++; return true; });
+		return count;
+	}
+
+	size_t countFiles(unsigned int typeMask, bool displayedOnly = false) const
+	{
+		return countFiles(typeMask, displayedOnly, [](FileData*) { return true; });
+	}
 	std::vector<FileData*> getFlatGameList(bool displayedOnly, SystemData* system) const;
 
 	void addChild(FileData* file, bool assignParent = true); // Error if mType != FOLDER
@@ -0,0 +1,356 @@
+#include "FileHasher.h"
+
+#include "scrapers/md5.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "Log.h"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#define HASH_READ_BUFFER_SIZE	(1024 * 1024)
+#define ZIP_EOCD_SIZE			22
+#define ZIP_CDH_SIZE			46
+#define ZIP_MAX_COMMENT_SIZE	65535
+
+#if WIN32
+#define fseeko _fseeki64
+#define ftello _ftelli64
+#endif
+
+// CRC32 (IEEE 802.3, same as zip & zlib)
+
+static unsigned int sCrcTable[8][256];
+
+static bool initCrcTable()
+{
+	for (unsigned int i = 0; i < 256; i++)
+	{
+		unsigned int crc = i;
+		for (int j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+
+		sCrcTable[0][i] = crc;
+	}
+
+	// Tables for slicing-by-8 : sCrcTable[k][i] is the CRC of byte i followed by k zero bytes
+	for (unsigned int i = 0; i < 256; i++)
+		for (int k = 1; k < 8; k++)
+			sCrcTable[k][i] = (sCrcTable[k - 1][i] >> 8) ^ sCrcTable[0][sCrcTable[k - 1][i] & 0xFF];
+
+	return true;
+}
+
+unsigned int FileHasher::crc32(unsigned int crc, const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	crc = ~crc;
+
+#if defined(__ARM_FEATURE_CRC32)
+	// ARMv8 CRC instructions use the same polynomial
+	while (size > 0 && ((size_t)p & 7) != 0)
+	{
+		crc = __crc32b(crc, *p++);
+		size--;
+	}
+
+	for (; size >= 8; size -= 8, p += 8)
+		crc = __crc32d(crc, *(const uint64_t*)p);
+
+	while (size-- > 0)
+		crc = __crc32b(crc, *p++);
+#else
+	static bool tableReady = initCrcTable(); // built once, thread safe
+	(void)tableReady;
+
+	for (; size >= 8; size -= 8, p += 8)
+	{
+		// Little endian words
+		unsigned int one = (p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24)) ^ crc;
+		unsigned int two = p[4] | (p[5] << 8) | (p[6] << 16) | ((unsigned int)p[7] << 24);
+
+		crc = sCrcTable[7][one & 0xFF] ^ sCrcTable[6][(one >> 8) & 0xFF] ^ sCrcTable[5][(one >> 16) & 0xFF] ^ sCrcTable[4][one >> 24] ^
+			sCrcTable[3][two & 0xFF] ^ sCrcTable[2][(two >> 8) & 0xFF] ^ sCrcTable[1][(two >> 16) & 0xFF] ^ sCrcTable[0][two >> 24];
+	}
+
+	while (size-- > 0)
+		crc = sCrcTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+#endif
+
+	return ~crc;
+}
+
+static std::string formatCRC32(unsigned int crc)
+{
+	char buffer[16];
+	snprintf(buffer, sizeof(buffer), "%08X", crc);
+	return buffer;
+}
+
+// Calls process for each block of the file, returns false on read errors
+static bool readFile(const std::string& path, const std::function<void(const char*, size_t)>& process)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	std::vector<char> buffer(HASH_READ_BUFFER_SIZE);
+
+	size_t size;
+	while ((size = fread(buffer.data(), 1, buffer.size(), file)) > 0)
+		process(buffer.data(), size);
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+static unsigned int readLE16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+static unsigned int readLE32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24); }
+
+// Reads the CRC of the last file stored in a zip archive from its central directory.
+// Returns false if the file isn't a zip archive, or a zip64 one
+static bool getZipContentCRC32(const std::string& path, unsigned int& crc)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	bool found = false;
+
+	// Archives can be larger than 2 GB
+	long long fileSize = fseeko(file, 0, SEEK_END) == 0 ? (long long)ftello(file) : -1;
+	if (fileSize < ZIP_EOCD_SIZE)
+	{
+		fclose(file);
+		return false;
+	}
+
+	// The end of central directory record is at the end of the file, followed by an optional comment
+	long long tailSize = std::min(fileSize, (long long)(ZIP_EOCD_SIZE + ZIP_MAX_COMMENT_SIZE));
+	std::vector<unsigned char> tail((size_t)tailSize);
+
+	if (fseeko(file, fileSize - tailSize, SEEK_SET) == 0 && fread(tail.data(), 1, (size_t)tailSize, file) == (size_t)tailSize)
+	{
+		for (long long pos = tailSize - ZIP_EOCD_SIZE; pos >= 0; pos--)
+		{
+			const unsigned char* eocd = tail.data() + pos;
+			if (readLE32(eocd) != 0x06054b50)
+				continue;
+
+			unsigned int entries = readLE16(eocd + 10);
+			unsigned int directorySize = readLE32(eocd + 12);
+			unsigned int directoryOffset = readLE32(eocd + 16);
+
+			if (entries == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF)
+				break;
+
+			if ((long long)directoryOffset + (long long)directorySize > fileSize || fseeko(file, (long long)directoryOffset, SEEK_SET) != 0)
+				break;
+
+			std::vector<unsigned char> directory(directorySize);
+			if (fread(directory.data(), 1, directorySize, file) != directorySize)
+				break;
+
+			size_t offset = 0;
+			for (unsigned int i = 0; i < entries && offset + ZIP_CDH_SIZE <= directorySize; i++)
+			{
+				const unsigned char* header = directory.data() + offset;
+				if (readLE32(header) != 0x02014b50)
+					break;
+
+				unsigned int nameLength = readLE16(header + 28);
+				unsigned int extraLength = readLE16(header + 30);
+				unsigned int commentLength = readLE16(header + 32);
+
+				if (offset + ZIP_CDH_SIZE + nameLength > directorySize)
+					break;
+
+				// Skip folders
+				if (nameLength > 0 && header[ZIP_CDH_SIZE + nameLength - 1] != '/')
+				{
+					crc = readLE32(header + 16);
+					found = true;
+				}
+
+				offset += ZIP_CDH_SIZE + nameLength + extraLength + commentLength;
+			}
+
+			break;
+		}
+	}
+
+	fclose(file);
+	return found;
+}
+
+// Persistent cache
+
+struct HashCacheEntry
+{
+	HashCacheEntry() : size(0), date(0) { }
+
+	long long	size;
+	long long	date;
+	std::string crc32;
+	std::string zipCrc32;
+	std::string md5;
+};
+
+static std::mutex sCacheLock;
+static std::unordered_map<std::string, HashCacheEntry> sCache;
+static bool sCacheLoaded = false;
+static bool sCacheDirty = false;
+
+static std::string getCachePath()
+{
+	return Utils::FileSystem::getEsConfigPath() + "/hashes.cache";
+}
+
+// Called with sCacheLock held
+static void loadCache()
+{
+	if (sCacheLoaded)
+		return;
+
+	sCacheLoaded = true;
+
+	std::ifstream file(getCachePath());
+	if (!file.is_open())
+		return;
+
+	// size|date|crc32|zipcrc32|md5|path
+	std::string line;
+	while (std::getline(file, line))
+	{
+		size_t fields[5];
+		size_t pos = 0;
+
+		int count = 0;
+		for (; count < 5; count++)
+		{
+			pos = line.find('|', pos);
+			if (pos == std::string::npos)
+				break;
+
+			fields[count] = pos++;
+		}
+
+		if (count < 5)
+			continue;
+
+		HashCacheEntry entry;
+		entry.size = atoll(line.substr(0, fields[0]).c_str());
+		entry.date = atoll(line.substr(fields[0] + 1, fields[1] - fields[0] - 1).c_str());
+		entry.crc32 = line.substr(fields[1] + 1, fields[2] - fields[1] - 1);
+		entry.zipCrc32 = line.substr(fields[2] + 1, fields[3] - fields[2] - 1);
+		entry.md5 = line.substr(fields[3] + 1, fields[4] - fields[3] - 1);
+
+		sCache[line.substr(fields[4] + 1)] = entry;
+	}
+}
+
+void FileHasher::saveCache()
+{
+	std::unique_lock<std::mutex> lock(sCacheLock);
+	if (!sCacheDirty)
+		return;
+
+	std::string path = getCachePath();
+	std::string tmpPath = path + ".tmp";
+
+	std::ofstream file(tmpPath, std::ios_base::out | std::ios_base::trunc);
+	if (!file.is_open())
+	{
+		LOG(LogError) << "FileHasher : unable to write " << tmpPath;
+		return;
+	}
+
+	for (auto item : sCache)
+		file << item.second.size << "|" << item.second.date << "|" << item.second.crc32 << "|" << item.second.zipCrc32 << "|" << item.second.md5 << "|" << item.first << "\n";
+
+	file.close();
+
+	Utils::FileSystem::removeFile(path);
+	if (std::rename(tmpPath.c_str(), path.c_str()) == 0)
+		sCacheDirty = false;
+}
+
+// Returns the cached value of a field, or computes and stores it when the file is unknown or changed
+static std::string getHash(const std::string& path, std::string HashCacheEntry::* field, const std::function<std::string()>& compute)
+{
+	long long size = (long long)Utils::FileSystem::getFileSize(path);
+	long long date = (long long)Utils::FileSystem::getFileModificationDate(path).getTime();
+
+	{
+		std::unique_lock<std::mutex> lock(sCacheLock);
+		loadCache();
+
+		auto it = sCache.find(path);
+		if (it != sCache.cend() && it->second.size == size && it->second.date == date && !(it->second.*field).empty())
+			return it->second.*field;
+	}
+
+	// Hash outside the lock, files are hashed in parallel
+	std::string hash = compute();
+	if (hash.empty())
+		return hash;
+
+	std::unique_lock<std::mutex> lock(sCacheLock);
+
+	HashCacheEntry& entry = sCache[path];
+	if (entry.size != size || entry.date != date)
+	{
+		entry = HashCacheEntry();
+		entry.size = size;
+		entry.date = date;
+	}
+
+	entry.*field = hash;
+	sCacheDirty = true;
+
+	return hash;
+}
+
+std::string FileHasher::getCRC32(const std::string& path, bool fromZipContents, const std::function<std::string()>& external)
+{
+	std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(path));
+	bool isArchive = fromZipContents && (ext == ".zip" || ext == ".7z");
+
+	return getHash(path, isArchive ? &HashCacheEntry::zipCrc32 : &HashCacheEntry::crc32, [path, ext, isArchive, external]
+	{
+		if (isArchive)
+		{
+			unsigned int crc = 0;
+			if (ext == ".zip" && getZipContentCRC32(path, crc))
+				return formatCRC32(crc);
+
+			return external != nullptr ? Utils::String::toUpper(external()) : std::string();
+		}
+
+		unsigned int crc = 0;
+		if (!readFile(path, [&crc](const char* data, size_t size) { crc = FileHasher::crc32(crc, data, size); }))
+			return std::string();
+
+		return formatCRC32(crc);
+	});
+}
+
+std::string FileHasher::getMD5(const std::string& path)
+{
+	return getHash(path, &HashCacheEntry::md5, [path]
+	{
+		MD5 md5;
+		if (!readFile(path, [&md5](const char* data, size_t size) { md5.update(data, (MD5::size_type)size); }))
+			return std::string();
+
+		md5.finalize();
+		return md5.hexdigest();
+	});
+}
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef ES_APP_FILE_HASHER_H
+#define ES_APP_FILE_HASHER_H
+
+#include <functional>
+#include <string>
+
+// In-process file hashing.
+// Files are streamed with large sequential reads, zip archives give the CRC32 of their content from the central directory
+// without decompressing anything. Results are kept in ~/.emulationstation/hashes.cache, keyed by path, size and
+// modification date, so unchanged files are never read again.
+class FileHasher
+{
+public:
+	// CRC32 as 8 uppercase hex digits, empty on error.
+	// With fromZipContents, archives give the CRC32 of their last member. Formats which aren't handled in-process
+	// (7z, zip64) use the external function, its result is cached as well.
+	static std::string getCRC32(const std::string& path, bool fromZipContents = true, const std::function<std::string()>& external = nullptr);
+
+	// MD5 as 32 lowercase hex digits, empty on error
+	static std::string getMD5(const std::string& path);
+
+	static void saveCache();
+
+	static unsigned int crc32(unsigned int crc, const void* data, size_t size);
+};
+
+#endif // ES_APP_FILE_HASHER_H
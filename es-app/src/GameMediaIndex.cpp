@@ -0,0 +1,342 @@
+#include "GameMediaIndex.h"
+
+#include "utils/FileSystemUtil.h"
+#include "FileData.h"
+#include "LocalArtCache.h"
+#include "Log.h"
+#include "Settings.h"
+#include "SystemData.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <time.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// What the scan needs to know about a game
+struct MediaIndexEntry
+{
+	FileData* game;
+	std::string paths[GameMediaIndex::MEDIA_TYPE_COUNT];
+	std::string localArt; // <rom path>/images/<name>, empty without LocalArt
+};
+
+struct MediaIndexScan
+{
+	std::vector<MediaIndexEntry> entries;
+	std::vector<FileData*> medias[GameMediaIndex::MEDIA_TYPE_COUNT];
+	std::unordered_map<const MetaDataList*, FileData*> games; // the scanned games, by their metadata
+
+	unsigned int removals;
+
+	std::mutex lock;
+	std::condition_variable finished;
+	bool done;
+};
+
+static std::atomic<unsigned int> sChanges(1);
+static std::atomic<unsigned int> sRemovals(0);
+
+// Games whose media paths changed since the last scan started
+static std::mutex sChangedLock;
+static std::unordered_set<const MetaDataList*> sChangedGames;
+
+// Main thread only
+static std::shared_ptr<MediaIndexScan> sScan;
+static unsigned int sScanChanges = 0;
+
+static std::vector<FileData*> sMedias[GameMediaIndex::MEDIA_TYPE_COUNT];
+static std::unordered_map<const MetaDataList*, FileData*> sGames;
+static size_t sRemaining[GameMediaIndex::MEDIA_TYPE_COUNT];
+static bool sValid = false;
+static unsigned int sValidRemovals = 0;
+
+static std::mt19937 sRandom((unsigned int)time(NULL));
+
+static bool existsOne(const std::string& base, const char* suffix1, const char* suffix2)
+{
+	return LocalArtCache::exists(base + suffix1) || LocalArtCache::exists(base + suffix2);
+}
+
+// Same rules as the FileData getters, without updating the metadata
+static bool hasMedia(const MediaIndexEntry& entry, int type)
+{
+	const std::string& path = entry.paths[type];
+	if (!path.empty())
+		return Utils::FileSystem::exists(path);
+
+	if (type == GameMediaIndex::THUMBNAIL)
+	{
+		if (!entry.localArt.empty() && existsOne(entry.localArt, "-thumb.png", "-thumb.jpg"))
+			return true;
+
+		return hasMedia(entry, GameMediaIndex::IMAGE);
+	}
+
+	if (entry.localArt.empty())
+		return false;
+
+	switch (type)
+	{
+	case GameMediaIndex::VIDEO:
+		return LocalArtCache::exists(entry.localArt + "-video.mp4");
+	case GameMediaIndex::IMAGE:
+		return existsOne(entry.localArt, "-image.png", ".png") || existsOne(entry.localArt, "-image.jpg", ".jpg");
+	case GameMediaIndex::MARQUEE:
+		return existsOne(entry.localArt, "-marquee.png", "-marquee.jpg");
+	}
+
+	return false;
+}
+
+static MediaIndexEntry getEntry(FileData* file, bool localArt)
+{
+	MediaIndexEntry entry;
+	entry.game = file;
+	entry.paths[GameMediaIndex::VIDEO] = file->getMetadata("video");
+	entry.paths[GameMediaIndex::IMAGE] = file->getMetadata("image");
+	entry.paths[GameMediaIndex::MARQUEE] = file->getMetadata("marquee");
+	entry.paths[GameMediaIndex::THUMBNAIL] = file->getMetadata("thumbnail");
+
+	if (entry.paths[GameMediaIndex::IMAGE].empty() && file->getSystem()->getName() == "imageviewer")
+		entry.paths[GameMediaIndex::IMAGE] = file->getPath();
+
+	if (localArt)
+		entry.localArt = file->getSystemEnvData()->mStartPath + "/images/" + file->getDisplayName();
+
+	return entry;
+}
+
+static void runScan(std::shared_ptr<MediaIndexScan> scan)
+{
+	for (auto& entry : scan->entries)
+		for (int type = 0; type < GameMediaIndex::MEDIA_TYPE_COUNT; type++)
+			if (hasMedia(entry, type))
+				scan->medias[type].push_back(entry.game);
+
+	scan->entries.clear();
+
+	std::unique_lock<std::mutex> lock(scan->lock);
+	scan->done = true;
+	scan->finished.notify_all();
+}
+
+static void startScan()
+{
+	auto scan = std::make_shared<MediaIndexScan>();
+	scan->removals = sRemovals;
+	scan->done = false;
+
+	sScanChanges = sChanges;
+
+	// The scan sees the current paths
+	{
+		std::unique_lock<std::mutex> lock(sChangedLock);
+		sChangedGames.clear();
+	}
+
+	bool localArt = Settings::getInstance()->getBool("LocalArt");
+
+	for (auto system : SystemData::sSystemVector)
+	{
+		// We only want games from game systems that are not collections
+		if (!system->isGameSystem() || system->isCollection())
+			continue;
+
+		system->getRootFolder()->visitFiles(GAME, true, [&](FileData* file)
+		{
+			scan->entries.push_back(getEntry(file, localArt));
+			scan->games[&file->getMetadata()] = file;
+			return true;
+		});
+	}
+
+	LOG(LogDebug) << "GameMediaIndex : scanning the medias of " << scan->entries.size() << " games";
+
+	sScan = scan;
+	std::thread(runScan, scan).detach();
+}
+
+// Takes the results of a finished scan
+static void adoptScan(bool wait)
+{
+	if (sScan == nullptr)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(sScan->lock);
+		if (!sScan->done)
+		{
+			if (!wait)
+				return;
+
+			sScan->finished.wait(lock, [] { return sScan->done; });
+		}
+	}
+
+	auto scan = sScan;
+	sScan = nullptr;
+
+	// Games were deleted during the scan
+	if (scan->removals != sRemovals)
+		return;
+
+	for (int type = 0; type < GameMediaIndex::MEDIA_TYPE_COUNT; type++)
+	{
+		sMedias[type].swap(scan->medias[type]);
+		sRemaining[type] = 0;
+	}
+
+	sGames.swap(scan->games);
+	sValid = true;
+	sValidRemovals = scan->removals;
+
+	LOG(LogDebug) << "GameMediaIndex : " << sMedias[GameMediaIndex::VIDEO].size() << " videos, " << sMedias[GameMediaIndex::IMAGE].size() << " images";
+}
+
+// Checks again the medias of the games whose paths changed, and updates the lists in place
+static void updateChangedGames()
+{
+	std::unordered_set<const MetaDataList*> changed;
+
+	{
+		std::unique_lock<std::mutex> lock(sChangedLock);
+		changed.swap(sChangedGames);
+	}
+
+	if (changed.empty())
+		return;
+
+	bool localArt = Settings::getInstance()->getBool("LocalArt");
+
+	for (auto metadata : changed)
+	{
+		// Not displayed when the lists were built
+		auto it = sGames.find(metadata);
+		if (it == sGames.cend())
+			continue;
+
+		MediaIndexEntry entry = getEntry(it->second, localArt);
+
+		for (int type = 0; type < GameMediaIndex::MEDIA_TYPE_COUNT; type++)
+		{
+			std::vector<FileData*>& medias = sMedias[type];
+			bool listed = std::find(medias.cbegin(), medias.cend(), entry.game) != medias.cend();
+
+			if (hasMedia(entry, type))
+			{
+				if (!listed)
+					medias.push_back(entry.game);
+			}
+			else if (listed)
+				GameMediaIndex::remove(entry.game, (GameMediaIndex::MediaType)type);
+		}
+	}
+
+	LOG(LogDebug) << "GameMediaIndex : medias of " << changed.size() << " games checked again";
+}
+
+void GameMediaIndex::refresh(bool wait)
+{
+	adoptScan(false);
+
+	if (sValid && sValidRemovals != sRemovals)
+	{
+		sValid = false;
+
+		for (int type = 0; type < MEDIA_TYPE_COUNT; type++)
+		{
+			sMedias[type].clear();
+			sRemaining[type] = 0;
+		}
+
+		sGames.clear();
+	}
+
+	// Changes made during a scan are applied once it's adopted
+	if (sValid)
+		updateChangedGames();
+
+	if (sScan == nullptr && (!sValid || sScanChanges != sChanges))
+		startScan();
+
+	if (wait && !sValid)
+	{
+		adoptScan(true);
+
+		// Games were deleted while waiting, the next refresh will try again
+		if (!sValid)
+			LOG(LogDebug) << "GameMediaIndex : scan outdated before its end";
+		else
+			updateChangedGames();
+	}
+}
+
+size_t GameMediaIndex::getCount(MediaType type)
+{
+	return sValid ? sMedias[type].size() : 0;
+}
+
+FileData* GameMediaIndex::pick(MediaType type, bool shuffle)
+{
+	if (!sValid || sMedias[type].empty())
+		return nullptr;
+
+	std::vector<FileData*>& medias = sMedias[type];
+
+	if (!shuffle)
+		return medias[std::uniform_int_distribution<size_t>(0, medias.size() - 1)(sRandom)];
+
+	// The games not picked yet are kept at the beginning of the list
+	size_t& remaining = sRemaining[type];
+	if (remaining == 0 || remaining > medias.size())
+		remaining = medias.size();
+
+	size_t index = std::uniform_int_distribution<size_t>(0, remaining - 1)(sRandom);
+
+	remaining--;
+	std::swap(medias[index], medias[remaining]);
+	return medias[remaining];
+}
+
+void GameMediaIndex::remove(FileData* game, MediaType type)
+{
+	std::vector<FileData*>& medias = sMedias[type];
+
+	auto it = std::find(medias.begin(), medias.end(), game);
+	if (it == medias.end())
+		return;
+
+	size_t index = it - medias.begin();
+
+	// Keep the not picked games first
+	if (index < sRemaining[type])
+	{
+		sRemaining[type]--;
+		std::swap(medias[index], medias[sRemaining[type]]);
+		index = sRemaining[type];
+	}
+
+	medias.erase(medias.begin() + index);
+}
+
+void GameMediaIndex::onMediaChanged()
+{
+	sChanges++;
+}
+
+void GameMediaIndex::onMediaChanged(const MetaDataList* metadata)
+{
+	std::unique_lock<std::mutex> lock(sChangedLock);
+	sChangedGames.insert(metadata);
+}
+
+void GameMediaIndex::onGameRemoved()
+{
+	sRemovals++;
+}
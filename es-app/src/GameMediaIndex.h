@@ -0,0 +1,47 @@
+#pragma once
+#ifndef ES_APP_GAME_MEDIA_INDEX_H
+#define ES_APP_GAME_MEDIA_INDEX_H
+
+#include <stddef.h>
+
+class FileData;
+class MetaDataList;
+
+// Lists of the displayed games whose medias exist on disk, one per media type, for the screensaver.
+// The files are checked on a background thread, from a copy of the metadata taken on the main thread : the scan never
+// touches the games themselves. When the media path of a game changes, only this game is checked again, at the next
+// refresh. A new scan is started when the filters or the settings change, the current lists being used until it ends.
+// When a game is deleted, the lists are dropped at once since they may point to it.
+// Everything but the scan and onMediaChanged(metadata) runs on the main thread.
+class GameMediaIndex
+{
+public:
+	enum MediaType
+	{
+		VIDEO = 0,
+		IMAGE = 1,
+		MARQUEE = 2,
+		THUMBNAIL = 3,
+		MEDIA_TYPE_COUNT = 4
+	};
+
+	// Starts a scan if the lists are missing or outdated. With wait, returns once some lists are available
+	static void refresh(bool wait);
+
+	static size_t getCount(MediaType type);
+
+	// Uniform random game among the ones having this media. With shuffle, every game is picked once before any repeat
+	static FileData* pick(MediaType type, bool shuffle);
+
+	// The media of this game was found missing
+	static void remove(FileData* game, MediaType type);
+
+	// The filters or the list of games changed
+	static void onMediaChanged();
+	// A media path of this game changed, from any thread
+	static void onMediaChanged(const MetaDataList* metadata);
+	// A game is being deleted
+	static void onGameRemoved();
+};
+
+#endif // ES_APP_GAME_MEDIA_INDEX_H
@@ -8,10 +8,19 @@
 #include "Settings.h"
 #include "SystemData.h"
 #include <pugixml/src/pugixml.hpp>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 #ifdef WIN32
 #include <Windows.h>
 #include <direct.h>
+#include <io.h>
 #else
 #include <unistd.h>
 #endif
@@ -104,12 +113,314 @@ FileData* findOrCreateFile(SystemData* system, const std::string& path, FileType
 	return NULL;
 }
 
+// Applies a <game> or <folder> node to the matching FileData
+static void loadGamelistNode(pugi::xml_node fileNode, SystemData* system, std::unordered_map<std::string, FileData*>& fileMap, bool trustGamelist, bool setDirty)
+{
+	FileType type = GAME;
+
+	std::string tag = fileNode.name();
+
+	if (tag == "folder")
+		type = FOLDER;
+	else if (tag != "game")
+		return;
+
+	const std::string path = Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), system->getStartPath(), false);
+
+	if (!trustGamelist && !Utils::FileSystem::exists(path))
+	{
+		LOG(LogWarning) << "File \"" << path << "\" does not exist! Ignoring.";
+		return;
+	}
+
+	FileData* file = findOrCreateFile(system, path, type, fileMap);
+	if (!file)
+	{
+		LOG(LogError) << "Error finding/creating FileData for \"" << path << "\", skipping.";
+		return;
+	}
+	else if (!file->isArcadeAsset())
+	{
+		std::string defaultName = file->getMetadata().get("name");
+		file->setMetadata(MetaDataList::createFromXML(type == FOLDER ? FOLDER_METADATA : GAME_METADATA, fileNode, system));
+
+		//make sure name gets set if one didn't exist
+		if (file->getMetadata().get("name").empty())
+			file->setMetadata("name", defaultName);
+
+		if (!file->getHidden() && Utils::FileSystem::isHidden(path))
+			file->getMetadata().set("hidden", "true");
+
+		if (setDirty)
+			file->getMetadata().setDirty();
+		else
+			file->getMetadata().resetChangedFlag();
+	}
+}
+
+// Streaming gamelist reader.
+// The file is memory mapped and scanned for the child elements of <gameList>, which are then parsed one at a time :
+// memory use is proportional to one record rather than to the whole document.
+class GamelistReader
+{
+public:
+	GamelistReader(const char* data, size_t size) : mPos(data), mEnd(data + size) { }
+
+	// Reads the <gameList> start tag. Returns false if the file doesn't start with one (not UTF-8, not a gamelist...)
+	bool readRoot(std::string& rootTag)
+	{
+		if (mPos == nullptr)
+			return false;
+
+		while (findMarkup())
+		{
+			if (mPos[1] == '?' || mPos[1] == '!')
+			{
+				// Records are parsed as UTF-8 : a declared ISO-8859-1 gamelist is left to pugixml, which converts it
+				if (!isUtf8Declaration())
+					return false;
+
+				if (!skipSpecial())
+					return false;
+
+				continue;
+			}
+
+			const char* tagEnd = findTagEnd(mPos);
+			if (tagEnd == nullptr || strncmp(mPos, "<gameList", 9) != 0 || (!isspace((unsigned char)mPos[9]) && mPos[9] != '>' && mPos[9] != '/'))
+				return false;
+
+			rootTag = std::string(mPos, tagEnd + 1);
+
+			// <gameList/> has no records
+			mPos = tagEnd[-1] == '/' ? mEnd : tagEnd + 1;
+			return true;
+		}
+
+		return false;
+	}
+
+	// Gives the text of the next record, false once </gameList> is reached
+	bool readRecord(const char*& start, size_t& length)
+	{
+		while (findMarkup())
+		{
+			if (mPos[1] == '/')
+				return false;
+
+			if (mPos[1] == '?' || mPos[1] == '!')
+			{
+				if (!skipSpecial())
+					return false;
+
+				continue;
+			}
+
+			const char* recordEnd = findElementEnd(mPos);
+			if (recordEnd == nullptr)
+			{
+				LOG(LogWarning) << "Truncated gamelist record ignored";
+				return false;
+			}
+
+			start = mPos;
+			length = recordEnd - mPos;
+			mPos = recordEnd;
+			return true;
+		}
+
+		return false;
+	}
+
+	// Parses the text of a record, or the root tag
+	static bool parse(const char* start, size_t length, pugi::xml_document& doc)
+	{
+		return doc.load_buffer(start, length, pugi::parse_default, pugi::encoding_utf8) && doc.first_child();
+	}
+
+	static unsigned int getRootAttribute(const std::string& rootTag, const char* name)
+	{
+		std::string tag = rootTag;
+		if (tag.size() < 2 || tag[tag.size() - 2] != '/')
+			tag.insert(tag.size() - 1, "/");
+
+		pugi::xml_document doc;
+		if (!parse(tag.c_str(), tag.size(), doc))
+			return 0;
+
+		return doc.first_child().attribute(name).as_uint();
+	}
+
+private:
+	// True unless mPos is an XML declaration with an encoding other than UTF-8
+	bool isUtf8Declaration()
+	{
+		if (mEnd - mPos < 6 || strncmp(mPos, "<?xml", 5) != 0 || !isspace((unsigned char)mPos[5]))
+			return true;
+
+		const char* end = findTagEnd(mPos);
+		if (end == nullptr)
+			return true;
+
+		std::string declaration(mPos, end);
+
+		size_t pos = declaration.find("encoding");
+		if (pos == std::string::npos)
+			return true;
+
+		size_t start = declaration.find_first_of("\"'", pos);
+		if (start == std::string::npos)
+			return false;
+
+		size_t stop = declaration.find(declaration[start], start + 1);
+		if (stop == std::string::npos)
+			return false;
+
+		std::string encoding = Utils::String::toLower(declaration.substr(start + 1, stop - start - 1));
+		return encoding == "utf-8" || encoding == "utf8";
+	}
+
+	bool findMarkup()
+	{
+		if (mPos >= mEnd)
+			return false;
+
+		mPos = (const char*)memchr(mPos, '<', mEnd - mPos);
+		if (mPos == nullptr || mPos + 1 >= mEnd)
+		{
+			mPos = mEnd;
+			return false;
+		}
+
+		return true;
+	}
+
+	const char* find(const char* from, const char* text)
+	{
+		const char* found = std::search(from, mEnd, text, text + strlen(text));
+		return found == mEnd ? nullptr : found;
+	}
+
+	// Comments, CDATA sections, processing instructions and declarations
+	const char* findSpecialEnd(const char* p)
+	{
+		const char* end = nullptr;
+
+		if (mEnd - p >= 4 && strncmp(p, "<!--", 4) == 0)
+			end = find(p + 4, "-->");
+		else if (mEnd - p >= 9 && strncmp(p, "<![CDATA[", 9) == 0)
+			end = find(p + 9, "]]>");
+		else
+			return findTagEnd(p);
+
+		return end == nullptr ? nullptr : end + 2;
+	}
+
+	bool skipSpecial()
+	{
+		const char* end = findSpecialEnd(mPos);
+		mPos = end == nullptr ? mEnd : end + 1;
+		return end != nullptr;
+	}
+
+	// Position of the '>' closing the tag at p, quoted attribute values may contain one
+	const char* findTagEnd(const char* p)
+	{
+		char quote = 0;
+
+		for (p++; p < mEnd; p++)
+		{
+			if (quote != 0)
+			{
+				if (*p == quote)
+					quote = 0;
+			}
+			else if (*p == '"' || *p == '\'')
+				quote = *p;
+			else if (*p == '>')
+				return p;
+		}
+
+		return nullptr;
+	}
+
+	// Position following the end of the element starting at p
+	const char* findElementEnd(const char* p)
+	{
+		int depth = 0;
+
+		while (p < mEnd)
+		{
+			p = (const char*)memchr(p, '<', mEnd - p);
+			if (p == nullptr || p + 1 >= mEnd)
+				return nullptr;
+
+			if (p[1] == '?' || p[1] == '!')
+			{
+				const char* end = findSpecialEnd(p);
+				if (end == nullptr)
+					return nullptr;
+
+				p = end + 1;
+				continue;
+			}
+
+			const char* tagEnd = findTagEnd(p);
+			if (tagEnd == nullptr)
+				return nullptr;
+
+			if (p[1] == '/')
+				depth--;
+			else if (tagEnd[-1] != '/')
+				depth++;
+
+			p = tagEnd + 1;
+
+			if (depth <= 0)
+				return p;
+		}
+
+		return nullptr;
+	}
+
+	const char* mPos;
+	const char* mEnd;
+};
+
 void loadGamelistFile (const std::string xmlpath, SystemData* system, std::unordered_map<std::string, FileData*>& fileMap, size_t checkSize = SIZE_MAX)
 {	
 	bool trustGamelist = Settings::getInstance()->getBool("ParseGamelistOnly");
 
 	LOG(LogInfo) << "Parsing XML file \"" << xmlpath << "\"...";
 
+	Utils::FileSystem::MappedFile file(xmlpath);
+	GamelistReader reader(file.data(), file.size());
+
+	std::string rootTag;
+	if (reader.readRoot(rootTag))
+	{
+		if (checkSize != SIZE_MAX && GamelistReader::getRootAttribute(rootTag, "parentHash") != checkSize)
+		{
+			LOG(LogWarning) << "gamelist size don't match !";
+			return;
+		}
+
+		const char* start;
+		size_t length;
+
+		while (reader.readRecord(start, length))
+		{
+			pugi::xml_document doc;
+			if (GamelistReader::parse(start, length, doc))
+				loadGamelistNode(doc.first_child(), system, fileMap, trustGamelist, checkSize != SIZE_MAX);
+			else
+				LOG(LogWarning) << "Invalid record in \"" << xmlpath << "\" ignored";
+		}
+
+		return;
+	}
+
+	// Other encodings are left to pugixml
 	pugi::xml_document doc;
 	pugi::xml_parse_result result = doc.load_file(xmlpath.c_str());
 
@@ -136,51 +447,8 @@ void loadGamelistFile (const std::string xmlpath, SystemData* system, std::unord
 		}
 	}
 	
-	std::string relativeTo = system->getStartPath();
-
 	for (pugi::xml_node fileNode : root.children())
-	{
-		FileType type = GAME;
-
-		std::string tag = fileNode.name();
-
-		if (tag == "folder")
-			type = FOLDER;
-		else if (tag != "game")
-			continue;
-
-		const std::string path = Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), relativeTo, false);
-				
-		if (!trustGamelist && !Utils::FileSystem::exists(path))
-		{
-			LOG(LogWarning) << "File \"" << path << "\" does not exist! Ignoring.";
-			continue;
-		}
-
-		FileData* file = findOrCreateFile(system, path, type, fileMap);
-		if (!file)
-		{
-			LOG(LogError) << "Error finding/creating FileData for \"" << path << "\", skipping.";
-			continue;
-		}
-		else if (!file->isArcadeAsset())
-		{
-			std::string defaultName = file->getMetadata().get("name");
-			file->setMetadata(MetaDataList::createFromXML(type == FOLDER ? FOLDER_METADATA : GAME_METADATA, fileNode, system));
-
-			//make sure name gets set if one didn't exist
-			if (file->getMetadata().get("name").empty())
-				file->setMetadata("name", defaultName);
-
-			if (!file->getHidden() && Utils::FileSystem::isHidden(path))
-				file->getMetadata().set("hidden", "true");
-
-			if (checkSize != SIZE_MAX)
-				file->getMetadata().setDirty();
-			else
-				file->getMetadata().resetChangedFlag();
-		}
-	}
+		loadGamelistNode(fileNode, system, fileMap, trustGamelist, checkSize != SIZE_MAX);
 }
 
 void clearTemporaryGamelistRecovery(SystemData* system)
@@ -204,22 +472,6 @@ void clearTemporaryGamelistRecovery(SystemData* system)
 	rmdir(path.c_str());
 }
 
-void parseGamelist(SystemData* system, std::unordered_map<std::string, FileData*>& fileMap)
-{
-	std::string xmlpath = system->getGamelistPath(false);
-
-	auto size = Utils::FileSystem::getFileSize(xmlpath);
-	if (size != 0)
-		loadGamelistFile(xmlpath, system, fileMap);
-
-	auto files = Utils::FileSystem::getDirContent(getGamelistRecoveryPath(system), true);
-	for (auto file : files)
-		loadGamelistFile(file, system, fileMap, size);
-
-	if (size != SIZE_MAX)
-		system->setGamelistHash(size);
-}
-
 bool addFileDataNode(pugi::xml_node& parent, const FileData* file, const char* tag, SystemData* system)
 {
 	//create game and add to parent node
@@ -244,165 +496,584 @@ bool addFileDataNode(pugi::xml_node& parent, const FileData* file, const char* t
 	return true;	
 }
 
-bool saveToGamelistRecovery(FileData* file)
+// Write-behind journal
+// Metadata changes are appended to recovery/<system>.journal, one <game> or <folder> node per line holding the whole
+// metadata of the file, and are durable as soon as they are written. Compaction merges the journal into gamelist.xml,
+// with an atomic replace, on a background thread and at exit. The first line is the size of gamelist.xml when the journal was
+// started : a gamelist changed outside ES makes the journal obsolete. Applying a record again is harmless, so a crash
+// between the replace and the removal of the journal loses nothing.
+
+#define GAMELIST_JOURNAL_HEADER		"ESJOURNAL1 "
+#define GAMELIST_JOURNAL_MAX_SIZE	(256 * 1024) // compacted in the background above this size
+
+struct GamelistJournalFiles
 {
-	if (!Settings::getInstance()->getBool("SaveGamelistsOnExit"))
-		return false;
-	
-	pugi::xml_document doc;
-	pugi::xml_node root = doc.append_child("gameList");
+	std::string journalPath;
+	std::string readPath;
+	std::string writePath;
+	std::string startPath;
+};
+
+static std::mutex sJournalLock;
+static std::map<std::string, int> sGamelistVersions; // incremented each time a compaction replaces a gamelist, under sJournalLock
+
+static std::mutex sCompactionLock;
+static std::deque<GamelistJournalFiles> sCompactionQueue;
+static std::thread sCompactionThread;
+static bool sCompactionRunning = false;
+static std::string sCompactionCurrent; // journal being compacted
+static std::map<std::string, size_t> sCompactionRetrySizes; // after a failure, journal size to reach before trying again
+
+static GamelistJournalFiles getGamelistJournalFiles(SystemData* system)
+{
+	GamelistJournalFiles files;
+	files.journalPath = getGamelistRecoveryPath(system) + ".journal";
+	files.readPath = system->getGamelistPath(false);
+	files.writePath = system->getGamelistPath(true);
+	files.startPath = system->getStartPath();
+	return files;
+}
 
-	const char* tag = file->getType() == GAME ? "game" : "folder";
+// Reads the records of a journal, removes it if it doesn't match the gamelist anymore.
+// readSize receives the length of the journal read
+// Called with sJournalLock held
+static std::vector<std::string> readGamelistJournal(const GamelistJournalFiles& files, size_t* readSize = nullptr)
+{
+	std::vector<std::string> records;
 
-	SystemData* system = file->getSourceFileData()->getSystem();
-	root.append_attribute("parentHash").set_value(system->getGamelistHash());
+	if (readSize != nullptr)
+		*readSize = 0;
 
-	if (addFileDataNode(root, file, tag, system))
+	std::ifstream file(files.journalPath, std::ios_base::in | std::ios_base::binary);
+	if (!file.is_open())
+		return records;
+
+	std::string line;
+	if (!std::getline(file, line) || line != GAMELIST_JOURNAL_HEADER + std::to_string(Utils::FileSystem::getFileSize(files.readPath)))
 	{
-		std::string fp = file->getFullPath();
-		fp = Utils::FileSystem::createRelativePath(file->getFullPath(), system->getRootFolder()->getFullPath(), true);
-		fp = Utils::FileSystem::getParent(fp) + "/" + Utils::FileSystem::getStem(fp) + ".xml";
+		int lost = 0;
+		while (std::getline(file, line))
+			if (!line.empty())
+				lost++;
+
+		LOG(LogWarning) << "Gamelist journal \"" << files.journalPath << "\" doesn't match the gamelist, " << lost << " changes discarded";
 
-		std::string path = Utils::FileSystem::getAbsolutePath(fp, getGamelistRecoveryPath(system));
-		path = Utils::FileSystem::getCanonicalPath(path);
+		file.close();
+		Utils::FileSystem::removeFile(files.journalPath);
+		return records;
+	}
 
-		std::string folder = Utils::FileSystem::getParent(path);
+	// A record torn by a crash is the last line, and doesn't parse
+	while (std::getline(file, line))
+		if (!line.empty())
+			records.push_back(line);
 
-		if (!Utils::FileSystem::exists(folder))
-			Utils::FileSystem::createDirectory(folder);
+	// Appends are done with the lock held : this is exactly what was read
+	if (readSize != nullptr)
+		*readSize = Utils::FileSystem::getFileSize(files.journalPath);
 
-		if (!doc.save_file(path.c_str()))
+	return records;
+}
+
+// Replaces the gamelist with its compacted version, and removes the records folded into it from the journal.
+// Records appended while the gamelist was written are kept, behind a header matching the new gamelist
+// Called with sJournalLock held
+static bool replaceCompactedGamelist(const GamelistJournalFiles& files, const std::string& tmpPath, size_t foldedSize)
+{
+	if (std::rename(tmpPath.c_str(), files.writePath.c_str()) != 0)
+	{
+		// Windows doesn't replace existing files
+		Utils::FileSystem::removeFile(files.writePath);
+		if (std::rename(tmpPath.c_str(), files.writePath.c_str()) != 0)
 		{
-			LOG(LogError) << "Error saving gamelist.xml to \"" << path << "\" (for system " << system->getName() << ")!";
+			LOG(LogError) << "Error replacing \"" << files.writePath << "\"!";
 			return false;
 		}
+	}
+
+	sGamelistVersions[files.writePath]++;
+
+	std::string tail;
+
+	std::ifstream journal(files.journalPath, std::ios_base::in | std::ios_base::binary);
+	if (journal.is_open())
+	{
+		journal.seekg((std::streamoff)foldedSize);
+
+		std::stringstream ss;
+		ss << journal.rdbuf();
+		tail = ss.str();
+		journal.close();
+	}
 
+	if (tail.empty())
+	{
+		Utils::FileSystem::removeFile(files.journalPath);
 		return true;
 	}
 
-	return false;
+	std::string journalTmpPath = files.journalPath + ".tmp";
+
+	std::ofstream out(journalTmpPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	out << GAMELIST_JOURNAL_HEADER << Utils::FileSystem::getFileSize(files.writePath) << "\n" << tail;
+	out.close();
+
+	if (out.fail())
+	{
+		// The journal doesn't match the new gamelist anymore : it would be dropped at load
+		LOG(LogError) << "Error writing gamelist journal \"" << journalTmpPath << "\", " << tail.size() << " bytes of changes lost";
+		Utils::FileSystem::removeFile(journalTmpPath);
+		Utils::FileSystem::removeFile(files.journalPath);
+		return true;
+	}
+
+	Utils::FileSystem::removeFile(files.journalPath);
+	std::rename(journalTmpPath.c_str(), files.journalPath.c_str());
+	return true;
 }
 
-bool hasDirtyFile(SystemData* system)
+static bool parseGamelistJournalRecord(const std::string& record, pugi::xml_document& doc)
 {
-	if (system == nullptr || !system->isGameSystem() || system->getName() == "imageviewer")
+	return doc.load_string(record.c_str()) && doc.first_child();
+}
+
+static std::string getGamelistRecordPath(pugi::xml_node node, const std::string& startPath)
+{
+	return Utils::FileSystem::getCanonicalPath(Utils::FileSystem::resolveRelativePath(node.child("path").text().get(), startPath, true));
+}
+
+// Last record of each file, with the records they replace : only the last one is written
+static bool isLastGamelistRecord(const std::map<std::string, size_t>& replaced, pugi::xml_node recordNode, size_t index, const std::string& startPath)
+{
+	auto it = replaced.find(getGamelistRecordPath(recordNode, startPath));
+
+	// A record with only a path means default metadata : it's not written
+	return it != replaced.cend() && it->second == index && recordNode.first_child().next_sibling();
+}
+
+// Same as writeCompactedGamelist, through a pugixml DOM : for the gamelists the streaming reader doesn't handle (UTF-16...)
+static bool writeCompactedGamelistDom(const GamelistJournalFiles& files, const std::vector<std::unique_ptr<pugi::xml_document>>& recordDocs, const std::map<std::string, size_t>& replaced, const std::string& tmpPath)
+{
+	pugi::xml_document doc;
+	pugi::xml_parse_result result = doc.load_file(files.readPath.c_str());
+	if (!result)
+	{
+		LOG(LogError) << "Error parsing XML file \"" << files.readPath << "\", journal not compacted\n	" << result.description();
 		return false;
+	}
 
-	FolderData* rootFolder = system->getRootFolder();
-	if (rootFolder == nullptr)
+	pugi::xml_node root = doc.child("gameList");
+	if (!root)
+	{
+		LOG(LogError) << "Could not find <gameList> node in gamelist \"" << files.readPath << "\", journal not compacted";
 		return false;
+	}
 
-	for (auto file : rootFolder->getFilesRecursive(GAME | FOLDER))
-		if (file->getMetadata().wasChanged())
+	for (pugi::xml_node node = root.first_child(); node; )
+	{
+		pugi::xml_node next = node.next_sibling();
+
+		if (node.type() == pugi::node_element && replaced.find(getGamelistRecordPath(node, files.startPath)) != replaced.cend())
+			root.remove_child(node);
+
+		node = next;
+	}
+
+	for (size_t i = 0; i < recordDocs.size(); i++)
+		if (isLastGamelistRecord(replaced, recordDocs[i]->first_child(), i, files.startPath))
+			root.append_copy(recordDocs[i]->first_child());
+
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(files.writePath));
+
+	if (!doc.save_file(tmpPath.c_str(), "\t", pugi::format_indent, pugi::encoding_utf8))
+	{
+		LOG(LogError) << "Error saving gamelist.xml to \"" << tmpPath << "\"!";
+		Utils::FileSystem::removeFile(tmpPath);
+		return false;
+	}
+
+	return true;
+}
+
+// Writes gamelist.xml with the journal records applied to tmpPath.
+// The records of the gamelist are copied as they are, except the ones replaced by the journal
+static bool writeCompactedGamelist(const GamelistJournalFiles& files, const std::vector<std::unique_ptr<pugi::xml_document>>& recordDocs, const std::string& tmpPath)
+{
+	// Last record of each file
+	std::map<std::string, size_t> replaced;
+	for (size_t i = 0; i < recordDocs.size(); i++)
+		replaced[getGamelistRecordPath(recordDocs[i]->first_child(), files.startPath)] = i;
+
+	std::string rootTag = "<gameList>";
+
+	Utils::FileSystem::MappedFile gamelist(files.readPath);
+	GamelistReader reader(gamelist.data(), gamelist.size());
+
+	// Other encodings are left to pugixml
+	if (gamelist.data() != nullptr && !reader.readRoot(rootTag))
+		return writeCompactedGamelistDom(files, recordDocs, replaced, tmpPath);
+
+	if (rootTag.size() >= 2 && rootTag[rootTag.size() - 2] == '/')
+		rootTag.erase(rootTag.size() - 2, 1);
+
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(files.writePath));
+
+	std::ofstream out(tmpPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!out.is_open())
+	{
+		LOG(LogError) << "Error saving gamelist.xml to \"" << tmpPath << "\"!";
+		return false;
+	}
+
+	out << "<?xml version=\"1.0\"?>\n" << rootTag << "\n";
+
+	const char* start;
+	size_t length;
+
+	while (reader.readRecord(start, length))
+	{
+		pugi::xml_document doc;
+		if (GamelistReader::parse(start, length, doc) && replaced.find(getGamelistRecordPath(doc.first_child(), files.startPath)) != replaced.cend())
+			continue;
+
+		out << "\t";
+		out.write(start, length);
+		out << "\n";
+	}
+
+	for (size_t i = 0; i < recordDocs.size(); i++)
+		if (isLastGamelistRecord(replaced, recordDocs[i]->first_child(), i, files.startPath))
+			recordDocs[i]->first_child().print(out, "\t", pugi::format_indent, pugi::encoding_utf8, 1);
+
+	out << "</gameList>\n";
+	out.close();
+
+	if (out.fail())
+	{
+		LOG(LogError) << "Error saving gamelist.xml to \"" << tmpPath << "\"!";
+		Utils::FileSystem::removeFile(tmpPath);
+		return false;
+	}
+
+	return true;
+}
+
+// The journal is read, and the folded records removed, with sJournalLock held.
+// The gamelist is written without it : appends are not blocked, and land after the folded records
+static bool compactGamelistJournal(const GamelistJournalFiles& files)
+{
+	std::vector<std::string> records;
+	size_t foldedSize = 0;
+
+	{
+		std::unique_lock<std::mutex> lock(sJournalLock);
+
+		records = readGamelistJournal(files, &foldedSize);
+		if (records.empty())
+		{
+			Utils::FileSystem::removeFile(files.journalPath);
 			return true;
+		}
+	}
+
+	std::vector<std::unique_ptr<pugi::xml_document>> recordDocs;
 
-	return false;
+	for (auto record : records)
+	{
+		std::unique_ptr<pugi::xml_document> doc(new pugi::xml_document());
+		if (parseGamelistJournalRecord(record, *doc))
+			recordDocs.push_back(std::move(doc));
+	}
+
+	// On failure, the journal is kept : it's still applied at load
+	std::string tmpPath = files.writePath + ".tmp";
+	if (!writeCompactedGamelist(files, recordDocs, tmpPath))
+		return false;
+
+	std::unique_lock<std::mutex> lock(sJournalLock);
+	if (!replaceCompactedGamelist(files, tmpPath, foldedSize))
+		return false;
+
+	LOG(LogInfo) << "Compacted " << records.size() << " journal entries into '" << files.writePath << "'";
+	return true;
 }
 
-void updateGamelist(SystemData* system)
+// journalSize is the size reached by an append, 0 compacts whatever the size
+static void queueGamelistCompaction(const GamelistJournalFiles& files, size_t journalSize = 0)
 {
-	//We do this by reading the XML again, adding changes and then writing it back,
-	//because there might be information missing in our systemdata which would then miss in the new XML.
-	//We have the complete information for every game though, so we can simply remove a game
-	//we already have in the system from the XML, and then add it back from its GameData information...
+	std::unique_lock<std::mutex> lock(sCompactionLock);
 
-	if(system == nullptr || Settings::getInstance()->getBool("IgnoreGamelist"))
+	// Appends made during a compaction are kept in the journal, until a compaction is explicitly asked
+	if (files.journalPath == sCompactionCurrent && journalSize != 0)
 		return;
 
-	if (!system->isGameSystem() || system->getName() == "imageviewer")
+	for (auto& queued : sCompactionQueue)
+		if (queued.journalPath == files.journalPath)
+			return;
+
+	// A compaction which failed isn't tried again with each append
+	auto retry = sCompactionRetrySizes.find(files.journalPath);
+	if (journalSize != 0 && retry != sCompactionRetrySizes.cend() && journalSize < retry->second)
 		return;
 
-	FolderData* rootFolder = system->getRootFolder();
-	if (rootFolder == nullptr)
-	{
-		LOG(LogError) << "Found no root folder for system \"" << system->getName() << "\"!";
+	sCompactionQueue.push_back(files);
+
+	if (sCompactionRunning)
 		return;
-	}
 
-	std::vector<FileData*> dirtyFiles;
-	std::vector<FileData*> files = rootFolder->getFilesRecursive(GAME | FOLDER);
-	for (auto file : files)
-		if (file->getMetadata().wasChanged())
-			dirtyFiles.push_back(file);
+	// The previous thread has nothing left to do
+	if (sCompactionThread.joinable())
+		sCompactionThread.join();
 
-	if (dirtyFiles.size() == 0)
+	sCompactionRunning = true;
+	sCompactionThread = std::thread([]
 	{
-		clearTemporaryGamelistRecovery(system);
-		return;
+		while (true)
+		{
+			GamelistJournalFiles next;
+
+			{
+				std::unique_lock<std::mutex> lock(sCompactionLock);
+				if (sCompactionQueue.empty())
+				{
+					sCompactionRunning = false;
+					return;
+				}
+
+				next = sCompactionQueue.front();
+				sCompactionQueue.pop_front();
+				sCompactionCurrent = next.journalPath;
+			}
+
+			bool compacted = compactGamelistJournal(next);
+
+			std::unique_lock<std::mutex> lock(sCompactionLock);
+			sCompactionCurrent.clear();
+
+			if (compacted)
+				sCompactionRetrySizes.erase(next.journalPath);
+			else
+				sCompactionRetrySizes[next.journalPath] = std::max((size_t)GAMELIST_JOURNAL_MAX_SIZE, Utils::FileSystem::getFileSize(next.journalPath)) * 2;
+		}
+	});
+}
+
+void waitGamelistCompaction()
+{
+	std::thread thread;
+
+	{
+		std::unique_lock<std::mutex> lock(sCompactionLock);
+		thread.swap(sCompactionThread);
 	}
 
-	int numUpdated = 0;
+	if (thread.joinable())
+		thread.join();
+}
 
+static std::string getGamelistJournalRecord(FileData* file, SystemData* system)
+{
 	pugi::xml_document doc;
-	pugi::xml_node root;
-	std::string xmlReadPath = system->getGamelistPath(false);
 
-	if(Utils::FileSystem::exists(xmlReadPath))
+	const char* tag = file->getType() == GAME ? "game" : "folder";
+
+	// Default metadata : only the path, to remove the file from the gamelist
+	if (!addFileDataNode(doc, file, tag, system))
+		doc.append_child(tag).append_child("path").text().set(Utils::FileSystem::createRelativePath(file->getPath(), system->getStartPath(), false).c_str());
+
+	std::stringstream ss;
+	doc.save(ss, "", pugi::format_raw | pugi::format_no_declaration);
+
+	// One record per line : line breaks of the texts become character references
+	std::string record = Utils::String::replace(ss.str(), "\r", "&#13;");
+	return Utils::String::replace(record, "\n", "&#10;");
+}
+
+static bool appendGamelistJournal(SystemData* system, const std::vector<FileData*>& files)
+{
+	GamelistJournalFiles journalFiles = getGamelistJournalFiles(system);
+
+	std::string records;
+	for (auto file : files)
+		records += getGamelistJournalRecord(file, system) + "\n";
+
+	long size = 0;
+
 	{
-		//parse an existing file first
-		pugi::xml_parse_result result = doc.load_file(xmlReadPath.c_str());
-		if(!result)
-			LOG(LogError) << "Error parsing XML file \"" << xmlReadPath << "\"!\n	" << result.description();
+		std::unique_lock<std::mutex> lock(sJournalLock);
 
-		root = doc.child("gameList");
-		if(!root)
+		bool exists = Utils::FileSystem::exists(journalFiles.journalPath);
+		if (!exists)
+			Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(journalFiles.journalPath));
+
+		FILE* file = fopen(journalFiles.journalPath.c_str(), "ab");
+		if (file == nullptr)
 		{
-			LOG(LogError) << "Could not find <gameList> node in gamelist \"" << xmlReadPath << "\"!";
-			root = doc.append_child("gameList");
+			LOG(LogError) << "Error writing gamelist journal \"" << journalFiles.journalPath << "\"!";
+			return false;
 		}
-	}
-	else //set up an empty gamelist to append to		
-		root = doc.append_child("gameList");
 
-	std::map<std::string, pugi::xml_node> xmlMap;
+		if (!exists)
+			records = GAMELIST_JOURNAL_HEADER + std::to_string(Utils::FileSystem::getFileSize(journalFiles.readPath)) + "\n" + records;
 
-	for (pugi::xml_node fileNode : root.children())
-	{
-		pugi::xml_node path = fileNode.child("path");
-		if (path)
+		bool written = fwrite(records.c_str(), 1, records.size(), file) == records.size() && fflush(file) == 0;
+
+		// Survive a power loss, not only a crash
+#ifdef WIN32
+		_commit(_fileno(file));
+#else
+		fsync(fileno(file));
+#endif
+
+		size = ftell(file);
+		fclose(file);
+
+		if (!written)
 		{
-			std::string nodePath = Utils::FileSystem::getCanonicalPath(Utils::FileSystem::resolveRelativePath(path.text().get(), system->getStartPath(), true));
-			xmlMap[nodePath] = fileNode;
+			LOG(LogError) << "Error writing gamelist journal \"" << journalFiles.journalPath << "\"!";
+			return false;
 		}
 	}
-	
-	// iterate through all files, checking if they're already in the XML
-	for(auto file : dirtyFiles)
+
+	// Everything is durable
+	for (auto file : files)
+		file->getMetadata().resetChangedFlag();
+
+	if (size > GAMELIST_JOURNAL_MAX_SIZE)
+		queueGamelistCompaction(journalFiles, (size_t)size);
+
+	return true;
+}
+
+static void applyGamelistJournal(SystemData* system, const GamelistJournalFiles& files, const std::vector<std::string>& records, std::unordered_map<std::string, FileData*>& fileMap)
+{
+	if (records.empty())
+		return;
+
+	LOG(LogInfo) << "Applying " << records.size() << " gamelist journal entries for " << system->getName();
+
+	bool trustGamelist = Settings::getInstance()->getBool("ParseGamelistOnly");
+
+	// The records are durable : the files aren't dirty
+	for (auto record : records)
+	{
+		pugi::xml_document doc;
+		if (parseGamelistJournalRecord(record, doc))
+			loadGamelistNode(doc.first_child(), system, fileMap, trustGamelist, false);
+	}
+
+	queueGamelistCompaction(files);
+}
+
+void parseGamelist(SystemData* system, std::unordered_map<std::string, FileData*>& fileMap)
+{
+	std::string xmlpath = system->getGamelistPath(false);
+	GamelistJournalFiles journalFiles = getGamelistJournalFiles(system);
+
+	size_t size = 0;
+	std::vector<std::string> records;
+
+	// A compaction may replace the gamelist and shorten the journal while the gamelist is parsed, without holding
+	// sJournalLock : the gamelist is parsed again then, the journal must be read along with the gamelist it applies to.
+	// Applying a record twice, or parsing a gamelist twice, gives the same result
+	for (int attempt = 0; ; attempt++)
 	{
-		bool removed = false;
+		int version;
 
-		// check if the file already exists in the XML
-		// if it does, remove it before adding
-		auto xmf = xmlMap.find(Utils::FileSystem::getCanonicalPath(file->getPath()));
-		if (xmf != xmlMap.cend())
 		{
-			removed = true;
-			root.remove_child(xmf->second);
+			std::unique_lock<std::mutex> lock(sJournalLock);
+			version = sGamelistVersions[journalFiles.writePath];
 		}
-		
-		const char* tag = (file->getType() == GAME) ? "game" : "folder";
 
-		// it was either removed or never existed to begin with; either way, we can add it now
-		if (addFileDataNode(root, file, tag, system))
-			++numUpdated; // Only if really added
-		else if (removed)
-			++numUpdated; // Only if really removed
+		size = Utils::FileSystem::getFileSize(xmlpath);
+		if (size != 0)
+			loadGamelistFile(xmlpath, system, fileMap);
+
+		// Per-game recovery files of older versions
+		auto files = Utils::FileSystem::getDirContent(getGamelistRecoveryPath(system), true);
+		for (auto file : files)
+			loadGamelistFile(file, system, fileMap, size);
+
+		std::unique_lock<std::mutex> lock(sJournalLock);
+		if (sGamelistVersions[journalFiles.writePath] != version && attempt < 3)
+		{
+			LOG(LogDebug) << "Gamelist of " << system->getName() << " compacted while it was parsed, parsing it again";
+			continue;
+		}
+
+		records = readGamelistJournal(journalFiles);
+		break;
+	}
+
+	applyGamelistJournal(system, journalFiles, records, fileMap);
+
+	if (size != SIZE_MAX)
+		system->setGamelistHash(size);
+}
+
+bool saveToGamelistRecovery(FileData* file)
+{
+	if (!Settings::getInstance()->getBool("SaveGamelistsOnExit"))
+		return false;
+
+	SystemData* system = file->getSourceFileData()->getSystem();
+	return appendGamelistJournal(system, { file });
+}
+
+bool hasDirtyFile(SystemData* system)
+{
+	if (system == nullptr || !system->isGameSystem() || system->getName() == "imageviewer")
+		return false;
+
+	FolderData* rootFolder = system->getRootFolder();
+	if (rootFolder == nullptr)
+		return false;
+
+	return !rootFolder->visitFiles(GAME | FOLDER, false, [](FileData* file) { return !file->getMetadata().wasChanged(); });
+}
+
+void updateGamelist(SystemData* system, bool compact)
+{
+	// Changes which aren't in the journal yet are appended to it : this is cheap, and doesn't need to read the gamelist.
+	// The gamelist itself is rewritten on a background thread, or right now when compact is set.
+
+	if(system == nullptr || Settings::getInstance()->getBool("IgnoreGamelist"))
+		return;
+
+	if (!system->isGameSystem() || system->getName() == "imageviewer")
+		return;
+
+	FolderData* rootFolder = system->getRootFolder();
+	if (rootFolder == nullptr)
+	{
+		LOG(LogError) << "Found no root folder for system \"" << system->getName() << "\"!";
+		return;
 	}
 
-	// Now write the file
-	if (numUpdated > 0) 
+	std::vector<FileData*> dirtyFiles;
+	rootFolder->visitFiles(GAME | FOLDER, false, [&dirtyFiles](FileData* file)
 	{
-		//make sure the folders leading up to this path exist (or the write will fail)
-		std::string xmlWritePath(system->getGamelistPath(true));
-		Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(xmlWritePath));
+		if (file->getMetadata().wasChanged())
+			dirtyFiles.push_back(file);
 
-		LOG(LogInfo) << "Added/Updated " << numUpdated << " entities in '" << xmlReadPath << "'";
+		return true;
+	});
 
-		if (!doc.save_file(xmlWritePath.c_str()))
-			LOG(LogError) << "Error saving gamelist.xml to \"" << xmlWritePath << "\" (for system " << system->getName() << ")!";
-		else
-			clearTemporaryGamelistRecovery(system);
+	if (dirtyFiles.size() > 0)
+	{
+		LOG(LogInfo) << "Added/Updated " << dirtyFiles.size() << " entities in the journal of '" << system->getName() << "'";
+
+		if (!appendGamelistJournal(system, dirtyFiles))
+			return;
+	}
+
+	// Their content is in the journal now
+	clearTemporaryGamelistRecovery(system);
+
+	// Through the queue : a compaction of the same journal may be running already
+	if (compact)
+	{
+		queueGamelistCompaction(getGamelistJournalFiles(system));
+		waitGamelistCompaction();
 	}
-	else
-		clearTemporaryGamelistRecovery(system);
 }
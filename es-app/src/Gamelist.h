@@ -10,10 +10,16 @@ class FileData;
 // Loads gamelist.xml data into a SystemData.
 void parseGamelist(SystemData* system, std::unordered_map<std::string, FileData*>& fileMap);
 
-// Writes currently loaded metadata for a SystemData to gamelist.xml.
-void updateGamelist(SystemData* system);
+// Makes the changed metadata of a SystemData durable in its journal.
+// gamelist.xml is rewritten in the background, or before returning with compact.
+void updateGamelist(SystemData* system, bool compact = false);
 
+// Appends the metadata of a file to the journal of its system.
 bool saveToGamelistRecovery(FileData* file);
+
+// Waits for the gamelists being rewritten in the background.
+void waitGamelistCompaction();
+
 bool hasDirtyFile(SystemData* system);
 
 #endif // ES_APP_GAME_LIST_H
@@ -0,0 +1,81 @@
+#include "LocalArtCache.h"
+
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include <SDL_timer.h>
+#include <ctime>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#define FOLDER_CHECK_INTERVAL	5000
+
+struct LocalArtFolder
+{
+	std::unordered_set<std::string> files;
+	time_t modificationTime;
+	unsigned int lastCheck;
+};
+
+static std::mutex sLock;
+static std::unordered_map<std::string, LocalArtFolder> sFolders;
+
+static std::string getKey(const std::string& fileName)
+{
+#if WIN32
+	return Utils::String::toLower(fileName);
+#else
+	return fileName;
+#endif
+}
+
+bool LocalArtCache::exists(const std::string& path)
+{
+	std::string folderPath = Utils::FileSystem::getParent(path);
+	std::string key = getKey(Utils::FileSystem::getFileName(path));
+
+	unsigned int now = SDL_GetTicks();
+
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+
+		auto it = sFolders.find(folderPath);
+		if (it != sFolders.cend() && now - it->second.lastCheck < FOLDER_CHECK_INTERVAL)
+			return it->second.files.find(key) != it->second.files.cend();
+	}
+
+	// The disk is accessed without the lock : other folders are still answered meanwhile
+
+	// 0 if the folder doesn't exist
+	time_t modificationTime = Utils::FileSystem::getFileModificationDate(folderPath).getTime();
+
+	// A second change made in the same second would keep the same time : the listing is used, but not trusted
+	// to be still valid at the next check
+	if (modificationTime != 0 && time(NULL) - modificationTime < 2)
+		modificationTime = -1;
+
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+
+		auto it = sFolders.find(folderPath);
+		if (it != sFolders.cend() && modificationTime != -1 && it->second.modificationTime == modificationTime)
+		{
+			it->second.lastCheck = now;
+			return it->second.files.find(key) != it->second.files.cend();
+		}
+	}
+
+	LocalArtFolder folder;
+	folder.modificationTime = modificationTime;
+	folder.lastCheck = now;
+
+	if (modificationTime != 0)
+		for (auto file : Utils::FileSystem::getDirContent(folderPath))
+			folder.files.insert(getKey(Utils::FileSystem::getFileName(file)));
+
+	bool found = folder.files.find(key) != folder.files.cend();
+
+	std::unique_lock<std::mutex> lock(sLock);
+	sFolders[folderPath] = std::move(folder);
+	return found;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef ES_APP_LOCAL_ART_CACHE_H
+#define ES_APP_LOCAL_ART_CACHE_H
+
+#include <string>
+
+// Listing of the local art folders (<rom folder>/images), so that looking for the local art of a game doesn't hit the
+// disk : a missing media is found missing without any system call, which is the common case while scrolling.
+// A folder is listed on first use, and listed again when its modification time changes. The time is checked at most
+// every few seconds, so medias added or removed while running are seen soon after. A folder modified less than 2 seconds
+// before it's listed is listed again at the next check. Thread safe, folders are listed without holding the lock.
+class LocalArtCache
+{
+public:
+	static bool exists(const std::string& path);
+};
+
+#endif // ES_APP_LOCAL_ART_CACHE_H
@@ -2,6 +2,7 @@
 
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
+#include "GameMediaIndex.h"
 #include "Log.h"
 #include <pugixml/src/pugixml.hpp>
 #include "SystemData.h"
@@ -205,6 +206,9 @@ void MetaDataList::set(const std::string& key, const std::string& value)
 			return;
 
 		mMap[id] = value;
+
+		if (getType(id) == MD_PATH)
+			GameMediaIndex::onMediaChanged(this);
 	}
 
 	mWasChanged = true;
@@ -1,290 +1,268 @@
 #include "ScraperCmdLine.h"
 
+#include "scrapers/ThreadedScraper.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "FileData.h"
+#include "FileHasher.h"
+#include "Gamelist.h"
+#include "HttpReq.h"
 #include "Log.h"
 #include "platform.h"
+#include "Settings.h"
 #include "SystemData.h"
+#include <SDL_timer.h>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <set>
 #include <signal.h>
-#if defined(__linux__)
-#include <unistd.h>
-#elif defined(WIN32)
-#include <Windows.h>
-#endif
+
+#define PROGRESS_INTERVAL	10000
+
+// Batch scraper, made to run unattended (cron, ssh...) :
+//
+// emulationstation --scrape [--scrape-systems nes,snes] [--scrape-games "mario*"] [--scrape-all] [--scrape-restart] [--scrape-offline]
+//                           [--scrape-mock path]
+//
+// Each completed game is written to the gamelist recovery files and to a checkpoint journal : an interrupted run
+// started again with the same selection skips the games already done. Gamelists are updated when the run ends.
+// Output is made of "key=value" lines, one per game, plus periodic "progress" lines and a final "summary" line.
+//
+// With --scrape-mock, the canned answers of the "Mock" scraper are used instead of the configured scraper : along with
+// --scrape-all --scrape-restart, the summary line is a throughput benchmark of the whole pipeline.
 
 std::ostream& out = std::cout;
 
+static volatile sig_atomic_t sInterrupted = 0;
+
+// Only async-signal-safe work here : the interruption is logged once the batch returns
 void handle_interrupt_signal(int /*p*/)
 {
-	sleep(50);
+	sInterrupted = 1;
 
-	LOG(LogInfo) << "Interrupt received during scrape...";
-
-	SystemData::deleteSystems();
+	// The games in flight are dropped, everything committed so far is kept in the journal
+	ThreadedScraper::stop();
+}
 
-	exit(1);
+static std::string getJournalPath()
+{
+	return Utils::FileSystem::getEsConfigPath() + "/scraper.journal";
 }
 
-int run_scraper_cmdline()
+// Case insensitive match, supporting * and ?
+static bool matchWildcard(const char* pattern, const char* text)
 {
-	out << "EmulationStation scraper\n";
-	out << "========================\n";
-	out << "\n";
+	for (; *pattern != 0; pattern++, text++)
+	{
+		if (*pattern == '*')
+		{
+			while (*(pattern + 1) == '*')
+				pattern++;
 
-	signal(SIGINT, handle_interrupt_signal);
+			for (; ; text++)
+			{
+				if (matchWildcard(pattern + 1, text))
+					return true;
 
-	//==================================================================================
-	//filter
-	//==================================================================================
-	enum FilterChoice
-	{
-		FILTER_MISSING_IMAGES,
-		FILTER_ALL
-	};
+				if (*text == 0)
+					return false;
+			}
+		}
+
+		if (*text == 0 || (*pattern != '?' && tolower((unsigned char)*pattern) != tolower((unsigned char)*text)))
+			return false;
+	}
 
-	int filter_choice;
-	do {
-		out << "Select filter for games to be scraped:\n";
-		out << FILTER_MISSING_IMAGES << " - games missing images\n";
-		out << FILTER_ALL << " - all games period, can overwrite existing metadata\n";
+	return *text == 0;
+}
 
-		std::cin >> filter_choice;
-		std::cin.ignore(1, '\n'); //skip the unconsumed newline
-	} while(filter_choice < FILTER_MISSING_IMAGES || filter_choice > FILTER_ALL);
+static std::string quote(const std::string& value)
+{
+	return "\"" + Utils::String::replace(value, "\"", "\\\"") + "\"";
+}
 
-	out << "\n";
+int run_scraper_cmdline(int argc, char* argv[])
+{
+	std::vector<std::string> systemNames;
+	std::string gamePattern;
+	bool scrapeAll = false;
+	bool restart = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--scrape-systems") == 0 && i + 1 < argc)
+			systemNames = Utils::String::split(Utils::String::toLower(argv[++i]), ',');
+		else if (strcmp(argv[i], "--scrape-games") == 0 && i + 1 < argc)
+			gamePattern = argv[++i];
+		else if (strcmp(argv[i], "--scrape-all") == 0)
+			scrapeAll = true;
+		else if (strcmp(argv[i], "--scrape-restart") == 0)
+			restart = true;
+		else if (strcmp(argv[i], "--scrape-mock") == 0 && i + 1 < argc)
+		{
+			Settings::getInstance()->setString("Scraper", "Mock");
+			Settings::getInstance()->setString("ScraperMockPath", argv[++i]);
+		}
+	}
+
+	signal(SIGINT, handle_interrupt_signal);
+	signal(SIGTERM, handle_interrupt_signal);
 
 	//==================================================================================
-	//platforms
+	// selection
 	//==================================================================================
 
 	std::vector<SystemData*> systems;
+	for (auto system : SystemData::sSystemVector)
+	{
+		if (system->isGroupSystem() || system->getPlatformIds().empty() || system->hasPlatformId(PlatformIds::PLATFORM_IGNORE))
+			continue;
 
-	out << "You can scrape only specific platforms, or scrape all of them.\n";
-	out << "Would you like to scrape all platforms? (y/n)\n";
+		if (!systemNames.empty() && std::find(systemNames.cbegin(), systemNames.cend(), Utils::String::toLower(system->getName())) == systemNames.cend())
+			continue;
 
-	std::string system_choice;
-	std::getline(std::cin, system_choice);
-	
-	if(system_choice == "y" || system_choice == "Y")
+		systems.push_back(system);
+	}
+
+	if (systems.empty())
 	{
-		out << "Will scrape all platforms.\n";
-		for(auto i = SystemData::sSystemVector.cbegin(); i != SystemData::sSystemVector.cend(); i++)
-		{
-			out << "   " << (*i)->getName() << " (" << (*i)->getGameCount() << " games)\n";
-			systems.push_back(*i);
-		}
+		out << "error message=" << quote("no system to scrape") << "\n";
+		return 1;
+	}
 
-	}else{
-		std::string sys_name;
+	// A journal is only used again for the same selection
+	std::string selection = "systems=" + Utils::String::vectorToCommaString(systemNames) + " games=" + gamePattern + " all=" + (scrapeAll ? "1" : "0");
 
-		out << "Enter the names of the platforms you would like to scrape, one at a time.\n";
-		out << "Type nothing and press enter when you are ready to continue.\n";
+	std::set<std::string> journal;
 
-		do {
-			for(auto i = SystemData::sSystemVector.cbegin(); i != SystemData::sSystemVector.cend(); i++)
-			{
-				if(std::find(systems.cbegin(), systems.cend(), (*i)) != systems.cend())
-					out << " C ";
-				else
-					out << "   ";
+	if (!restart)
+	{
+		std::ifstream file(getJournalPath());
+		std::string line;
 
-				out << "\"" << (*i)->getName() << "\" (" << (*i)->getGameCount() << " games)\n";
-			}
+		if (file.is_open() && std::getline(file, line) && line == selection)
+			while (std::getline(file, line))
+				journal.insert(line);
+	}
+
+	std::queue<ScraperSearchParams> searches;
+	int skipped = 0;
+
+	for (auto system : systems)
+	{
+		for (auto game : system->getRootFolder()->getFilesRecursive(GAME))
+		{
+			if (!gamePattern.empty() && !matchWildcard(gamePattern.c_str(), game->getFileName().c_str()))
+				continue;
 
-			std::getline(std::cin, sys_name);
-			
-			if(sys_name.empty())
-				break;
+			if (!scrapeAll && !hasMissingMedias(game))
+				continue;
 
-			bool found = false;
-			for(auto i = SystemData::sSystemVector.cbegin(); i != SystemData::sSystemVector.cend(); i++)
+			if (journal.find(game->getPath()) != journal.cend())
 			{
-				if((*i)->getName() == sys_name)
-				{
-					systems.push_back(*i);
-					found = true;
-					break;
-				}
+				skipped++;
+				continue;
 			}
 
-			if(!found)
-				out << "System not found.\n";
+			ScraperSearchParams search;
+			search.system = system;
+			search.game = game;
+			search.overWriteMedias = scrapeAll;
+			searches.push(search);
+		}
+	}
 
-		} while(true);
+	int total = (int)searches.size();
+	out << "start systems=" << systems.size() << " total=" << total << " resumed=" << skipped << "\n" << std::flush;
+
+	// Start a new journal, or continue the current one
+	std::ofstream journalFile;
+	if (journal.empty())
+	{
+		journalFile.open(getJournalPath(), std::ios_base::out | std::ios_base::trunc);
+		journalFile << selection << "\n";
 	}
+	else
+		journalFile.open(getJournalPath(), std::ios_base::out | std::ios_base::app);
 
 	//==================================================================================
-	//manual mode
+	// scraping
 	//==================================================================================
 
-	out << "\n";
-	out << "You can let the scraper try to automatically choose the best result, or\n";
-	out << "you can manually approve each result. This \"manual mode\" is much more accurate.\n";
-	out << "It is highly recommended you use manual mode unless you have a very large collection.\n";
-	out << "Scrape in manual mode? (y/n)\n";
+	int scraped = 0;
+	int notFound = 0;
+	int errors = 0;
 
-	std::string manual_mode_str;
-	std::getline(std::cin, manual_mode_str);
+	unsigned int startTime = SDL_GetTicks();
+	unsigned int lastProgress = startTime;
+	unsigned long long startBytes = HttpReq::getDownloadedBytes();
 
-	bool manual_mode = false;
-
-	if(manual_mode_str == "y" || manual_mode_str == "Y")
+	auto printStats = [&](const char* tag)
 	{
-		manual_mode = true;
-		out << "Scraping in manual mode!\n";
-	}else{
-		out << "Scraping in automatic mode!\n";
-	}
+		int done = scraped + notFound + errors;
+		double minutes = (SDL_GetTicks() - startTime) / 60000.0;
 
-	//==================================================================================
-	//scraping
-	//==================================================================================
-	out << "\n";
-	out << "Alright, let's do this thing!\n";
-	out << "=============================\n";
+		out << tag << " done=" << done << " total=" << total << " scraped=" << scraped << " notfound=" << notFound << " errors=" << errors
+			<< " games_per_minute=" << std::fixed << std::setprecision(1) << (minutes > 0 ? done / minutes : 0.0)
+			<< " bytes=" << (HttpReq::getDownloadedBytes() - startBytes)
+			<< " elapsed=" << (SDL_GetTicks() - startTime) / 1000 << "\n" << std::flush;
+	};
 
-	/*
-	std::shared_ptr<Scraper> scraper = Settings::getInstance()->getScraper();
-	for(auto sysIt = systems.cbegin(); sysIt != systems.cend(); sysIt++)
-	{
-		std::vector<FileData*> files = (*sysIt)->getRootFolder()->getFilesRecursive(GAME);
+	std::string fatalError;
 
-		ScraperSearchParams params;
-		params.system = (*sysIt);
+	bool completed = ThreadedScraper::runBatch(searches, [&](const ScraperSearchParams& search, bool found, const std::string& error)
+	{
+		const char* status = "scraped";
 
-		for(auto gameIt = files.cbegin(); gameIt != files.cend(); gameIt++)
+		if (!error.empty())
+		{
+			status = "error";
+			errors++;
+		}
+		else if (found)
+			scraped++;
+		else
 		{
-			params.nameOverride = "";
-			params.game = *gameIt;
+			status = "notfound";
+			notFound++;
+		}
 
-			//print original search term
-			out << getCleanFileName(params.game->getPath()) << "...\n";
+		out << "game status=" << status << " system=" << search.system->getName() << " path=" << quote(search.game->getPath());
+		if (!error.empty())
+			out << " message=" << quote(error);
+		out << "\n";
 
-			//need to take into account filter_choice
-			if(filter_choice == FILTER_MISSING_IMAGES)
-			{
-				if(!params.game->metadata.get("image").empty()) //maybe should also check if the image file exists/is a URL
-				{
-					out << "   Skipping, metadata \"image\" entry is not empty.\n";
-					continue;
-				}
-			}
+		// Failed games are tried again when resuming
+		if (error.empty())
+			journalFile << search.game->getPath() << "\n" << std::flush;
 
-			//actually get some results
-			do {
-				std::vector<MetaDataList> mdls = scraper->getResults(params);
-
-				//no results
-				if(mdls.size() == 0)
-				{
-					if(manual_mode)
-					{
-						//in manual mode let the user enter a custom search
-						out << "   NO RESULTS FOUND! Enter a new name to search for, or nothing to skip.\n";
-
-						std::getline(std::cin, params.nameOverride);
-
-						if(params.nameOverride.empty())
-						{
-							out << "   Skipping...\n";
-							break;
-						}
-
-						continue;
-
-					}else{
-						out << "   NO RESULTS FOUND! Skipping...\n";
-						break;
-					}
-				}
-
-				//some results
-				if(manual_mode)
-				{
-					//print list of choices
-					for(unsigned int i = 0; i < mdls.size(); i++)
-					{
-						out << "   " << i << " - " << mdls.at(i).get("name") << "\n";
-					}
-
-					int choice = -1;
-					std::string choice_str;
-					
-					out << "Your choice: ";
-
-					std::getline(std::cin, choice_str);
-					std::stringstream choice_buff(choice_str); //convert to int
-					choice_buff >> choice;
-
-					if(choice >= 0 && choice < (int)mdls.size())
-					{
-						params.game->metadata = mdls.at(choice);
-						break;
-					}else{
-						out << "Invalid choice.\n";
-						continue;
-					}
-
-				}else{
-					//automatic mode
-					//always choose the first choice
-					out << "   name -> " << mdls.at(0).get("name") << "\n";
-					params.game->metadata = mdls.at(0);
-					break;
-				}
-
-			} while(true);
-
-			out << "===================\n";
+		if (SDL_GetTicks() - lastProgress >= PROGRESS_INTERVAL)
+		{
+			lastProgress = SDL_GetTicks();
+			printStats("progress");
 		}
-	}
+	}, fatalError);
 
-	out << "\n\n";
-	out << "Downloading boxart...\n";
+	if (sInterrupted)
+		LOG(LogInfo) << "Interrupt received during scrape...";
 
-	for(auto sysIt = systems.cbegin(); sysIt != systems.cend(); sysIt++)
-	{
-		std::vector<FileData*> files = (*sysIt)->getRootFolder()->getFilesRecursive(GAME);
+	journalFile.close();
 
-		for(auto gameIt = files.cbegin(); gameIt != files.cend(); gameIt++)
-		{
-			FileData* game = *gameIt;
-			const std::vector<MetaDataDecl>& mdd = game->metadata.getMDD();
-			for(auto i = mdd.cbegin(); i != mdd.cend(); i++)
-			{
-				std::string key = i->key;
-				std::string url = game->metadata.get(key);
-
-				if(i->type == MD_IMAGE_PATH && HttpReq::isUrl(url))
-				{
-					std::string urlShort = url.substr(0, url.length() > 35 ? 35 : url.length());
-					if(url.length() != urlShort.length()) urlShort += "...";
-
-					out << "   " << game->metadata.get("name") << " [from: " << urlShort << "]...\n";
-
-					ScraperSearchParams p;
-					p.game = game;
-					p.system = *sysIt;
-					game->metadata.set(key, downloadImage(url, getSaveAsPath(p, key, url)));
-					if(game->metadata.get(key).empty())
-					{
-						out << "     FAILED! Skipping.\n";
-						game->metadata.set(key, url); //result URL to what it was if download failed, retry some other time
-					}
-				}
-			}
-		}
-	}
+	printStats("summary");
+
+	if (!fatalError.empty())
+		out << "error message=" << quote(fatalError) << "\n";
 
+	// Merge the recovery files into the gamelists
+	for (auto system : systems)
+		updateGamelist(system, true);
 
-	out << "\n\n";
-	out << "==============================\n";
-	out << "SCRAPE COMPLETE!\n";
-	out << "==============================\n";
-	*/
+	FileHasher::saveCache();
 
-	out << "\n\n";
-	out << "ACTUALLY THIS IS STILL TODO\n";
+	if (completed)
+		Utils::FileSystem::removeFile(getJournalPath());
 
-	return 0;
+	out << "end status=" << (completed ? "completed" : "interrupted") << "\n" << std::flush;
+	return completed ? 0 : 1;
 }
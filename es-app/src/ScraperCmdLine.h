@@ -2,6 +2,6 @@
 #ifndef ES_APP_SCRAPER_CMD_LINE_H
 #define ES_APP_SCRAPER_CMD_LINE_H
 
-int run_scraper_cmdline();
+int run_scraper_cmdline(int argc, char* argv[]);
 
 #endif // ES_APP_SCRAPER_CMD_LINE_H
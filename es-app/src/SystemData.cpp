@@ -629,13 +629,16 @@ void SystemData::deleteSystems()
 	{
 		SystemData* pData = sSystemVector.at(i);
 
+		// Leave gamelist.xml complete : a tool rewriting it before the next start would make the journal obsolete
 		if (saveOnExit && !pData->mIsCollectionSystem)
-			updateGamelist(pData);
+			updateGamelist(pData, true);
 
 		delete pData;
 	}
 
 	sSystemVector.clear();
+
+	waitGamelistCompaction();
 }
 
 std::string SystemData::getConfigPath(bool forWrite)
@@ -736,7 +739,7 @@ bool SystemData::hasGamelist() const
 
 unsigned int SystemData::getGameCount() const
 {
-	return (unsigned int)mRootFolder->getFilesRecursive(GAME).size();
+	return (unsigned int)mRootFolder->countFiles(GAME);
 }
 
 SystemData* SystemData::getRandomSystem()
@@ -772,20 +775,22 @@ SystemData* SystemData::getRandomSystem()
 
 FileData* SystemData::getRandomGame()
 {
-	std::vector<FileData*> list = mRootFolder->getFilesRecursive(GAME, true);
-	unsigned int total = (int)list.size();
+	unsigned int total = (unsigned int)mRootFolder->countFiles(GAME, true);
 	int target = 0;
 	// get random number in range
 	if (total == 0)
 		return NULL;
 	target = (int)Math::round((std::rand() / (float)RAND_MAX) * (total - 1));
-	return list.at(target);
+
+	FileData* game = nullptr;
+	mRootFolder->visitFiles(GAME, true, [&game, &target](FileData* file) { game = file; return target-- > 0; });
+	return game;
 }
 
 int SystemData::getDisplayedGameCount()
 {
 	if (mGameCount < 0)
-		mGameCount = mRootFolder->getFilesRecursive(GAME, true).size();
+		mGameCount = (int)mRootFolder->countFiles(GAME, true);
 
 	return mGameCount;
 }
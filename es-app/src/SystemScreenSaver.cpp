@@ -11,6 +11,7 @@
 #include "FileFilterIndex.h"
 #include "Log.h"
 #include "PowerSaver.h"
+#include "Settings.h"
 #include "Sound.h"
 #include "SystemData.h"
 #include "components/ImageComponent.h"
@@ -23,21 +24,19 @@
 #include "ImageIO.h"
 
 #define FADE_TIME 			500
+#define INDEX_REFRESH_TIME	5000
 
 SystemScreenSaver::SystemScreenSaver(Window* window) :
 	mVideoScreensaver(NULL),
 	mImageScreensaver(NULL),
 	mWindow(window),
-	mVideosCounted(false),
-	mVideoCount(0),
-	mImagesCounted(false),
-	mImageCount(0),
 	mState(STATE_INACTIVE),
 	mOpacity(0.0f),
 	mTimer(0),
 	mSystemName(""),
 	mGameName(""),
 	mCurrentGame(NULL),
+	mIndexTimer(0),
 	mLoadingNext(false)
 {
 
@@ -47,6 +46,13 @@ SystemScreenSaver::SystemScreenSaver(Window* window) :
 		Utils::FileSystem::createDirectory(path);
 	srand((unsigned int)time(NULL));
 	mVideoChangeTime = 30000;
+
+	// Local art changes which games have medias
+	mSettingsListener = Settings::getInstance()->addChangeListener([](const std::string& name)
+	{
+		if (name == "LocalArt")
+			GameMediaIndex::onMediaChanged();
+	});
 }
 
 SystemScreenSaver::~SystemScreenSaver()
@@ -54,6 +60,8 @@ SystemScreenSaver::~SystemScreenSaver()
 	// Delete subtitle file, if existing
 	remove(getTitlePath().c_str());
 	mCurrentGame = NULL;
+
+	Settings::getInstance()->removeChangeListener(mSettingsListener);
 }
 
 bool SystemScreenSaver::allowSleep()
@@ -247,125 +255,50 @@ void SystemScreenSaver::renderScreenSaver()
 	}
 }
 
-unsigned long SystemScreenSaver::countGameListNodes(const char *nodeName)
+void SystemScreenSaver::resetCounts()
 {
-	unsigned long nodeCount = 0;
-	std::vector<SystemData*>::const_iterator it;
-	for (it = SystemData::sSystemVector.cbegin(); it != SystemData::sSystemVector.cend(); ++it)
-	{
-		// We only want nodes from game systems that are not collections
-		if (!(*it)->isGameSystem() || (*it)->isCollection())
-			continue;
-
-		FolderData* rootFileData = (*it)->getRootFolder();
-
-		std::vector<FileData*> allFiles = rootFileData->getFilesRecursive(GAME, true);
-		std::vector<FileData*>::const_iterator itf;  // declare an iterator to a vector of strings
-
-		for (itf=allFiles.cbegin() ; itf < allFiles.cend(); itf++) 
-		{
-			if ((strcmp(nodeName, "video") == 0 && (*itf)->getVideoPath() != "") ||
-				(strcmp(nodeName, "image") == 0 && (*itf)->getImagePath() != ""))
-			{
-				nodeCount++;
-			}
-		}
-	}
-	return nodeCount;
+	// The filters may have changed
+	GameMediaIndex::onMediaChanged();
 }
 
-void SystemScreenSaver::countVideos()
+std::string SystemScreenSaver::pickGameListNode(GameMediaIndex::MediaType type)
 {
-	if (!mVideosCounted)
-	{
-		mVideoCount = countGameListNodes("video");
-		mVideosCounted = true;
-	}
-}
+	mCurrentGame = NULL;
 
-void SystemScreenSaver::countImages()
-{
-	if (!mImagesCounted)
-	{
-		mImageCount = countGameListNodes("image");
-		mImagesCounted = true;
-	}
-}
+	GameMediaIndex::refresh(true);
 
-std::string SystemScreenSaver::pickGameListNode(unsigned long index, const char *nodeName)
-{
-	std::string path;
+	FileData* game = GameMediaIndex::pick(type, Settings::getInstance()->getBool("ScreenSaverShuffle"));
+	if (game == nullptr)
+		return "";
 
-	std::vector<SystemData*>::const_iterator it;
-	for (it = SystemData::sSystemVector.cbegin(); it != SystemData::sSystemVector.cend(); ++it)
+	std::string path = (type == GameMediaIndex::VIDEO ? game->getVideoPath() : game->getImagePath());
+	if (!Utils::FileSystem::exists(path))
 	{
-		// We only want nodes from game systems that are not collections
-		if (!(*it)->isGameSystem() || (*it)->isCollection())
-			continue;
-
-		FolderData* rootFileData = (*it)->getRootFolder();
-
-		FileType type = GAME;
-		std::vector<FileData*> allFiles = rootFileData->getFilesRecursive(type, true);
-		std::vector<FileData*>::const_iterator itf;  // declare an iterator to a vector of strings
-
-		for(itf=allFiles.cbegin() ; itf < allFiles.cend(); itf++) 
-		{
-			if ((strcmp(nodeName, "video") == 0 && (*itf)->getVideoPath() != "") ||
-				(strcmp(nodeName, "image") == 0 && (*itf)->getImagePath() != ""))
-			{
-				if (index-- <= 0)
-				{
-					// We have it
-					if (strcmp(nodeName, "video") == 0)
-						path = (*itf)->getVideoPath();
-					else if (strcmp(nodeName, "image") == 0)
-						path = (*itf)->getImagePath();
-
-					if (!Utils::FileSystem::exists(path))
-						continue;
+		GameMediaIndex::remove(game, type);
+		return "";
+	}
 
-					mSystemName = (*it)->getFullName();
-					mGameName = (*itf)->getName();
-					mCurrentGame = (*itf);
+	mSystemName = game->getSystem()->getFullName();
+	mGameName = game->getName();
+	mCurrentGame = game;
 
 #ifdef _RPI_
-					if (Settings::getInstance()->getBool("ScreenSaverOmxPlayer"))
-						if (Settings::getInstance()->getString("ScreenSaverGameInfo") != "never" && strcmp(nodeName, "video") == 0)
-							writeSubtitle(mGameName.c_str(), mSystemName.c_str(), (Settings::getInstance()->getString("ScreenSaverGameInfo") == "always"));
+	if (Settings::getInstance()->getBool("ScreenSaverOmxPlayer"))
+		if (Settings::getInstance()->getString("ScreenSaverGameInfo") != "never" && type == GameMediaIndex::VIDEO)
+			writeSubtitle(mGameName.c_str(), mSystemName.c_str(), (Settings::getInstance()->getString("ScreenSaverGameInfo") == "always"));
 #endif
 
-					return path;
-				}
-			}
-		}
-	}
-
-	return "";
+	return path;
 }
 
 std::string SystemScreenSaver::pickRandomVideo()
 {
-	countVideos();
-	mCurrentGame = NULL;
-	if (mVideoCount == 0)
-		return "";
-	
-	rand();
-	int video = (int)(((float)rand() / float(RAND_MAX)) * (float)mVideoCount);
-	return pickGameListNode(video, "video");
+	return pickGameListNode(GameMediaIndex::VIDEO);
 }
 
 std::string SystemScreenSaver::pickRandomGameListImage()
 {
-	countImages();
-	mCurrentGame = NULL;
-	if (mImageCount == 0)
-		return "";
-	
-	rand();
-	int image = (int)(((float)rand() / float(RAND_MAX)) * (float)mImageCount);
-	return pickGameListNode(image, "image");
+	return pickGameListNode(GameMediaIndex::IMAGE);
 }
 
 std::string SystemScreenSaver::pickRandomCustomImage()
@@ -445,6 +378,19 @@ void SystemScreenSaver::update(int deltaTime)
 		if (mTimer > mVideoChangeTime)
 			nextVideo();
 	}
+	else if (mState == STATE_INACTIVE)
+	{
+		// Keep the media lists up to date in the background, so that starting doesn't wait for a scan
+		mIndexTimer += deltaTime;
+		if (mIndexTimer > INDEX_REFRESH_TIME)
+		{
+			mIndexTimer = 0;
+
+			std::string behavior = Settings::getInstance()->getString("ScreenSaverBehavior");
+			if (behavior == "random video" || (behavior == "slideshow" && !Settings::getInstance()->getBool("SlideshowScreenSaverCustomImageSource")))
+				GameMediaIndex::refresh(false);
+		}
+	}
 
 	// If we have a loaded video then update it
 	if (mVideoScreensaver)
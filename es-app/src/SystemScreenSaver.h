@@ -3,6 +3,7 @@
 #define ES_APP_SYSTEM_SCREEN_SAVER_H
 
 #include "Window.h"
+#include "GameMediaIndex.h"
 #include "GuiComponent.h"
 #include "renderers/Renderer.h"
 
@@ -82,14 +83,10 @@ public:
 
 	virtual FileData* getCurrentGame();
 	virtual void launchGame();
-	inline virtual void resetCounts() { mVideosCounted = false; mImagesCounted = false; };
+	virtual void resetCounts();
 
 private:
-	unsigned long countGameListNodes(const char *nodeName);
-	void countVideos();
-	void countImages();
-
-	std::string pickGameListNode(unsigned long index, const char *nodeName);
+	std::string pickGameListNode(GameMediaIndex::MediaType type);
 	std::string pickRandomVideo();
 	std::string pickRandomGameListImage();
 	std::string pickRandomCustomImage();
@@ -102,11 +99,6 @@ private:
 	};
 
 private:
-	bool			mVideosCounted;
-	unsigned long		mVideoCount;	
-	bool			mImagesCounted;
-	unsigned long		mImageCount;
-
 	//VideoComponent*		mVideoScreensaver;
 	std::shared_ptr<VideoScreenSaver>		mVideoScreensaver;
 
@@ -121,6 +113,8 @@ private:
 	std::string		mGameName;
 	std::string		mSystemName;
 	int 			mVideoChangeTime;
+	int				mIndexTimer;
+	int				mSettingsListener;
 	
 	//std::shared_ptr<Sound>	mBackgroundAudio;
 	bool			mLoadingNext;
@@ -12,17 +12,20 @@
 #include <unordered_set>
 #include <queue>
 #include "ApiSystem.h"
+#include "FileHasher.h"
 #include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
 
 #define ICONINDEX _U("\uF1EC ")
 
 ThreadedHasher* ThreadedHasher::mInstance = nullptr;
-bool ThreadedHasher::mPaused = false;
+std::atomic<bool> ThreadedHasher::mPaused(false);
 
 ThreadedHasher::ThreadedHasher(Window* window, std::queue<FileData*> searchQueue)
 	: mWindow(window)
 {
 	mExit = false;
+	mProcessed = 0;
 
 	mSearchQueue = searchQueue;
 	mTotal = mSearchQueue.size();
@@ -47,45 +50,71 @@ std::string ThreadedHasher::formatGameName(FileData* game)
 	return "[" + game->getSystemName() + "] " + game->getName();
 }
 
-void ThreadedHasher::hashFile(FileData* fileData)
+void ThreadedHasher::applyHashes()
 {
-	std::string systemName = fileData->getSystemName();
+	std::vector<std::pair<FileData*, std::string>> hashes;
 
-	std::string idx = std::to_string(mTotal + 1 - mSearchQueue.size()) + "/" + std::to_string(mTotal);
-	int percent = 100 - (mSearchQueue.size() * 100 / mTotal);
-
-	
-	mWndNotification->updateText(formatGameName(fileData));
-	mWndNotification->updatePercent(percent);
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+		hashes.swap(mHashes);
+	}
 
-	auto crc = ApiSystem::getInstance()->getCRC32(fileData->getPath(), !fileData->isArcadeAsset());
-	if (!crc.empty())
+	for (auto hash : hashes)
 	{
-		fileData->setMetadata("crc32", Utils::String::toUpper(crc));
+		FileData* fileData = hash.first;
+
+		mWndNotification->updateText(formatGameName(fileData));
+		fileData->setMetadata("crc32", Utils::String::toUpper(hash.second));
 
 #ifndef _DEBUG
 		saveToGamelistRecovery(fileData);
 #endif
 	}
+
+	mWndNotification->updatePercent(mProcessed * 100 / mTotal);
 }
 
 void ThreadedHasher::run()
 {
-	while (!mExit && !mSearchQueue.empty())
+	// Hashing is mostly limited by the storage : one reader per core keeps it busy without making it seek too much
+	Utils::ThreadPool pool(1);
+
+	while (!mSearchQueue.empty())
 	{
-		if (mPaused)
+		FileData* fileData = mSearchQueue.front();
+		mSearchQueue.pop();
+
+		std::string path = fileData->getPath();
+		bool fromZipContents = !fileData->isArcadeAsset();
+
+		pool.queueWorkItem([this, fileData, path, fromZipContents]
 		{
 			while (!mExit && mPaused)
 			{
 				std::this_thread::yield();
 				std::this_thread::sleep_for(std::chrono::milliseconds(500));
 			}
-		}
 
-		hashFile(mSearchQueue.front());
-		mSearchQueue.pop();
+			if (!mExit)
+			{
+				// Unchanged files are answered by the hash cache without being read
+				auto crc = ApiSystem::getInstance()->getCRC32(path, fromZipContents);
+				if (!crc.empty())
+				{
+					std::unique_lock<std::mutex> lock(mLock);
+					mHashes.push_back(std::pair<FileData*, std::string>(fileData, crc));
+				}
+			}
+
+			mProcessed++;
+		});
 	}
 
+	pool.wait([this] { applyHashes(); }, 100);
+	applyHashes();
+
+	FileHasher::saveCache();
+
 	delete this;
 	ThreadedHasher::mInstance = nullptr;
 }
@@ -112,9 +141,13 @@ void ThreadedHasher::start(Window* window, bool forceAllGames, bool silent)
 		if (!sys->isNetplaySupported())
 			continue;
 
-		for (auto file : sys->getRootFolder()->getFilesRecursive(GAME))
+		sys->getRootFolder()->visitFiles(GAME, false, [&](FileData* file)
+		{
 			if (forceAllGames || file->getMetadata("crc32").empty())
 				searchQueue.push(file);
+
+			return true;
+		});
 	}
 
 	if (searchQueue.size() == 0)
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <thread>
 #include <queue>
+#include <vector>
 #include "components/AsyncNotificationComponent.h"
 
 class FileData;
@@ -20,7 +23,7 @@ private:
 	ThreadedHasher(Window* window, std::queue<FileData*> searchQueue);
 	~ThreadedHasher();
 
-	void hashFile(FileData* fileData);
+	void applyHashes();
 	std::string formatGameName(FileData* game);
 
 	std::queue<FileData*> mSearchQueue;
@@ -35,10 +38,15 @@ private:
 
 	std::thread* mHandle;
 
+	// Hashes are computed on a thread pool, then applied to the games by the hasher thread
+	std::mutex mLock;
+	std::vector<std::pair<FileData*, std::string>> mHashes;
+	std::atomic<int> mProcessed;
+
 	int mTotal;
-	bool mExit;
+	std::atomic<bool> mExit;
 
-	static bool mPaused;
+	static std::atomic<bool> mPaused;
 	static ThreadedHasher* mInstance;
 };
 
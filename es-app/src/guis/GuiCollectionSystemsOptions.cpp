@@ -224,6 +224,15 @@ void GuiCollectionSystemsOptions::addSystemsToMenu()
 
 	bool hasGroup = false;
 
+	// arcade systems are only listed when they have games : populate them together
+	std::vector<CollectionSystemData*> arcadeSystems;
+	for (auto& it : autoSystems)
+		if (!it.second.decl.displayIfEmpty && !it.second.isPopulated)
+			arcadeSystems.push_back(&it.second);
+
+	if (!arcadeSystems.empty())
+		CollectionSystemManager::get()->populateAutoCollections(arcadeSystems);
+
 	// add Auto Systems && preserve order
 	for (auto systemDecl : CollectionSystemManager::getSystemDecls())
 	{
@@ -235,9 +244,6 @@ void GuiCollectionSystemsOptions::addSystemsToMenu()
             autoOptionList->add(it->second.decl.longName, it->second.decl.name, it->second.isEnabled);
         else
         {
-            if (!it->second.isPopulated)
-                CollectionSystemManager::get()->populateAutoCollection(&(it->second));
-
 			if (it->second.system->getRootFolder()->getChildren().size() == 0)
                 continue;
 
@@ -63,6 +63,12 @@ GuiGeneralScreensaverOptions::GuiGeneralScreensaverOptions(Window* window, const
 	ss_controls->setState(Settings::getInstance()->getBool("ScreenSaverControls"));
 	addWithLabel(_("SCREENSAVER CONTROLS"), ss_controls);
 	addSaveFunc([ss_controls] { Settings::getInstance()->setBool("ScreenSaverControls", ss_controls->getState()); });
+
+	// Show every game once before repeating one - ScreenSaverShuffle
+	auto ss_shuffle = std::make_shared<SwitchComponent>(mWindow);
+	ss_shuffle->setState(Settings::getInstance()->getBool("ScreenSaverShuffle"));
+	addWithLabel(_("SHUFFLE WITHOUT REPEAT"), ss_shuffle);
+	addSaveFunc([ss_shuffle] { Settings::getInstance()->setBool("ScreenSaverShuffle", ss_shuffle->getState()); });
 }
 
 GuiGeneralScreensaverOptions::~GuiGeneralScreensaverOptions()
@@ -243,6 +243,12 @@ void GuiMenu::openScraperSettings()
 		s->addSaveFunc([scrape_ratings] { Settings::getInstance()->setBool("ScrapeRatings", scrape_ratings->getState()); });
 	}
 
+	// optimize images
+	auto optimize_images = std::make_shared<SwitchComponent>(mWindow);
+	optimize_images->setState(Settings::getInstance()->getBool("ScraperOptimizeImages"));
+	s->addWithLabel(_("OPTIMIZE DOWNLOADED IMAGES"), optimize_images);
+	s->addSaveFunc([optimize_images] { Settings::getInstance()->setBool("ScraperOptimizeImages", optimize_images->getState()); });
+
 	// scrape now
 	ComponentListRow row;
 	auto openScrapeNow = [this] 
@@ -531,6 +537,18 @@ void GuiMenu::openDeveloperSettings()
 	s->addWithLabel(_("OPTIMIZE VIDEO VRAM USE"), optimizeVideo);
 	s->addSaveFunc([optimizeVideo] { Settings::getInstance()->setBool("OptimizeVideo", optimizeVideo->getState()); });
 
+	// cachedLayers
+	auto cachedLayers = std::make_shared<SwitchComponent>(mWindow);
+	cachedLayers->setState(Settings::getInstance()->getBool("CachedLayers"));
+	s->addWithLabel(_("CACHE STATIC MENU LAYERS"), cachedLayers);
+	s->addSaveFunc([cachedLayers] { Settings::getInstance()->setBool("CachedLayers", cachedLayers->getState()); });
+
+	// videoPreviews
+	auto videoPreviews = std::make_shared<SwitchComponent>(mWindow);
+	videoPreviews->setState(Settings::getInstance()->getBool("VideoPreviews"));
+	s->addWithLabel(_("CREATE LOW RESOLUTION VIDEO PREVIEWS"), videoPreviews);
+	s->addSaveFunc([videoPreviews] { Settings::getInstance()->setBool("VideoPreviews", videoPreviews->getState()); });
+
 
 	// enable filters (ForceDisableFilters)
 	auto enable_filter = std::make_shared<SwitchComponent>(mWindow);
@@ -2330,7 +2348,6 @@ void GuiMenu::openUISettings()
 	{ 
 		if (Settings::getInstance()->setBool("ShowFilenames", hidden_files->getState()))
 		{
-			FileData::resetSettings();
 			s->setVariable("reloadCollections", true);
 			s->setVariable("reloadAll", true);
 		}
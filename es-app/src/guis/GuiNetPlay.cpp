@@ -172,20 +172,21 @@ FileData* GuiNetPlay::getFileData(std::string gameInfo, bool crc)
 		if (!sys->isNetplaySupported())
 			continue;
 
-		for (auto file : sys->getRootFolder()->getFilesRecursive(GAME))
+		FileData* found = nullptr;
+
+		sys->getRootFolder()->visitFiles(GAME, false, [&](FileData* file)
 		{
-			if (crc)
+			if (crc ? file->getMetadata("crc32") == gameInfo : Utils::FileSystem::getStem(file->getPath()) == gameInfo)
 			{
-				if (file->getMetadata("crc32") == gameInfo)
-					return file;
-
-				continue;
+				found = file;
+				return false;
 			}
-			
-			std::string stem = Utils::FileSystem::getStem(file->getPath());
-			if (stem == gameInfo)
-				return file;			
-		}
+
+			return true;
+		});
+
+		if (found != nullptr)
+			return found;
 	}
 
 	return nullptr;
@@ -25,26 +25,7 @@ GuiScraperStart::GuiScraperStart(Window* window) : GuiComponent(window),
 	mFilters->add(_("Only missing medias"), [this](SystemData*, FileData* g) -> bool 
 	{ 
 		mOverwriteMedias = false;
-
-		if (Settings::getInstance()->getString("Scraper") == "ScreenScraper")
-		{
-			if (!Settings::getInstance()->getString("ScrapperImageSrc").empty() && !Utils::FileSystem::exists(g->getMetadata().get("image")))
-				return true;
-
-			if (!Settings::getInstance()->getString("ScrapperThumbSrc").empty() && !Utils::FileSystem::exists(g->getMetadata().get("thumbnail")))
-				return true;
-
-			if (!Settings::getInstance()->getString("ScrapperLogoSrc").empty() && !Utils::FileSystem::exists(g->getMetadata().get("marquee")))
-				return true;
-
-			if (Settings::getInstance()->getBool("ScrapeVideos") && !Utils::FileSystem::exists(g->getMetadata().get("video")))
-				return true;
-
-			return false;
-		}
-		else
-			return !Utils::FileSystem::exists(g->getMetadata().get("image"));
-
+		return hasMissingMedias(g);
 	}, true);
 
 	mMenu.addWithLabel(_("FILTER"), mFilters); // batocera
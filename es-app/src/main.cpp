@@ -16,6 +16,9 @@
 #include "Settings.h"
 #include "SystemData.h"
 #include "SystemScreenSaver.h"
+#include "VideoPreviewCache.h"
+#include "HttpReq.h"
+#include "components/VideoVlcComponent.h"
 #include <SDL_events.h>
 #include <SDL_main.h>
 #include <SDL_timer.h>
@@ -26,8 +29,11 @@
 #include "ApiSystem.h"
 #include "AudioManager.h"
 #include "NetworkThread.h"
+#include "scrapers/ScraperCache.h"
 #include "scrapers/ThreadedScraper.h"
+#include "resources/ThemePack.h"
 #include "ThreadedHasher.h"
+#include "FileHasher.h"
 #include <FreeImage.h>
 #include "ImageIO.h"
 
@@ -38,6 +44,7 @@
 #endif
 
 bool scrape_cmdline = false;
+std::string theme_pack_cmdline;
 
 bool parseArgs(int argc, char* argv[])
 {
@@ -149,6 +156,15 @@ bool parseArgs(int argc, char* argv[])
 		}else if(strcmp(argv[i], "--scrape") == 0)
 		{
 			scrape_cmdline = true;
+		}else if(strcmp(argv[i], "--scrape-offline") == 0)
+		{
+			ScraperCache::setOffline(true);
+		}else if(strcmp(argv[i], "--scrape-systems") == 0 || strcmp(argv[i], "--scrape-games") == 0 || strcmp(argv[i], "--scrape-mock") == 0)
+		{
+			i++; // skip value, read by run_scraper_cmdline
+		}else if(strcmp(argv[i], "--build-theme-pack") == 0 && i + 1 < argc)
+		{
+			theme_pack_cmdline = argv[++i];
 		}else if(strcmp(argv[i], "--max-vram") == 0)
 		{
 			int maxVRAM = atoi(argv[i + 1]);
@@ -189,6 +205,13 @@ bool parseArgs(int argc, char* argv[])
 				"--no-splash			don't show the splash screen\n"
 				"--debug				more logging, show console on Windows\n"
 				"--scrape			scrape using command line interface\n"
+				"--scrape-offline		only use the cached scraper answers and the medias on disk, no network access\n"
+				"--scrape-systems [a,b,...]	only scrape these systems\n"
+				"--scrape-games [pattern]	only scrape the games matching a wildcard pattern\n"
+				"--scrape-all			scrape every game, not only the ones with missing medias\n"
+				"--scrape-restart		ignore the checkpoint journal of an interrupted scrape\n"
+				"--scrape-mock [path]		scrape with the canned answers of a local directory (benchmark)\n"
+				"--build-theme-pack [path]	pack the files of a theme set into its theme.pack, then quit\n"
 				"--windowed			not fullscreen, should be used with --resolution\n"
 				"--vsync [1/on or 0/off]		turn vsync on or off (default is on)\n"
 				"--max-vram [size]		Max VRAM to use in Mb before swapping. 0 for unlimited\n"
@@ -229,6 +252,7 @@ bool loadSystemConfigFile(Window* window, const char** errorString)
 	*errorString = NULL;
 
 	ImageIO::loadImageCache();
+	Utils::FileSystem::FileSystemCacheActivator::loadCache();
 
 	if(!SystemData::loadConfig(window))
 	{
@@ -360,6 +384,19 @@ int main(int argc, char* argv[])
 	//always close the log on exit
 	atexit(&onExit);
 
+	//build a theme pack then quit
+	if(!theme_pack_cmdline.empty())
+	{
+		std::string error;
+		if(!ThemePack::build(theme_pack_cmdline, error))
+		{
+			std::cout << "Unable to build the theme pack : " << error << "\n";
+			return 1;
+		}
+
+		return 0;
+	}
+
 	// Set locale
 	setLocale(argv[0]); // batocera
 
@@ -437,7 +474,7 @@ int main(int argc, char* argv[])
 	//run the command line scraper then quit
 	if(scrape_cmdline)
 	{
-		return run_scraper_cmdline();
+		return run_scraper_cmdline(argc, argv);
 	}
 
 	//dont generate joystick events while we're loading (hopefully fixes "automatically started emulator" bug)
@@ -567,6 +604,8 @@ int main(int argc, char* argv[])
 
 	ThreadedHasher::stop();
 	ThreadedScraper::stop();
+	ThreadedScraper::waitForStop(); // its requests and image threads go away below
+	stopImageProcessing();
 
 	while(window.peekGui() != ViewController::get())
 		delete window.peekGui();
@@ -574,7 +613,11 @@ int main(int argc, char* argv[])
 	if (SystemData::hasDirtySystems())
 		window.renderLoadingScreen(_("SAVING METADATAS. PLEASE WAIT..."));
 
+	VideoPreviewCache::deinit();
+	HttpReq::deinit();
 	ImageIO::saveImageCache();
+	Utils::FileSystem::FileSystemCacheActivator::saveCache();
+	FileHasher::saveCache();
 	MameNames::deinit();
 	CollectionSystemManager::deinit();
 	SystemData::deleteSystems();
@@ -585,6 +628,7 @@ int main(int argc, char* argv[])
 #endif
 
 	window.deinit();
+	VideoVlcComponent::deinit();
 
 	LOG(LogInfo) << "EmulationStation cleanly shutting down.";
 
@@ -356,12 +356,10 @@ void processGame(const Value& game, const Value& boxart, std::vector<ScraperSear
 } // namespace
 
   // Process should return false only when we reached a maximum scrap by minute, to retry
-bool TheGamesDBJSONRequest::process(HttpReq* request, std::vector<ScraperSearchResult>& results)
+bool TheGamesDBJSONRequest::process(const std::string& content, std::vector<ScraperSearchResult>& results)
 {
-	assert(request->status() == HttpReq::REQ_SUCCESS);
-
 	Document doc;
-	doc.Parse(request->getContent().c_str());
+	doc.Parse(content.c_str());
 
 	if (doc.HasParseError())
 	{
@@ -28,7 +28,13 @@ class TheGamesDBJSONRequest : public ScraperHttpRequest
 	}
 
   protected:
-	bool process(HttpReq* request, std::vector<ScraperSearchResult>& results) override;
+	// ctor for a GetGame request whose answer is given by the subclass
+	TheGamesDBJSONRequest(std::vector<ScraperSearchResult>& resultsWrite)
+		: ScraperHttpRequest(resultsWrite), mRequestQueue(nullptr)
+	{
+	}
+
+	bool process(const std::string& content, std::vector<ScraperSearchResult>& results) override;
 	bool isGameRequest() { return !mRequestQueue; }
 
 	std::queue<std::unique_ptr<ScraperRequest>>* mRequestQueue;
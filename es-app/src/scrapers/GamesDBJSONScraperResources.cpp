@@ -6,6 +6,7 @@
 #include "Log.h"
 
 #include "scrapers/GamesDBJSONScraperResources.h"
+#include "scrapers/ScraperCache.h"
 #include "utils/FileSystemUtil.h"
 
 
@@ -62,17 +63,21 @@ void TheGamesDBJSONRequestResources::prepare()
 		return;
 	}
 
+	// Offline : only the resources already on disk are used
+	bool offline = ScraperCache::isOffline();
+
 	if (loadResource(gamesdb_new_developers_map, "developers", genFilePath(DEVELOPERS_JSON_FILE)) &&
-		!gamesdb_developers_resource_request)
+		!offline && !gamesdb_developers_resource_request)
 	{
 		gamesdb_developers_resource_request = fetchResource(DEVELOPERS_ENDPOINT);
 	}
 	if (loadResource(gamesdb_new_publishers_map, "publishers", genFilePath(PUBLISHERS_JSON_FILE)) &&
-		!gamesdb_publishers_resource_request)
+		!offline && !gamesdb_publishers_resource_request)
 	{
 		gamesdb_publishers_resource_request = fetchResource(PUBLISHERS_ENDPOINT);
 	}
-	if (loadResource(gamesdb_new_genres_map, "genres", genFilePath(GENRES_JSON_FILE)) && !gamesdb_genres_resource_request)
+	if (loadResource(gamesdb_new_genres_map, "genres", genFilePath(GENRES_JSON_FILE)) &&
+		!offline && !gamesdb_genres_resource_request)
 	{
 		gamesdb_genres_resource_request = fetchResource(GENRES_ENDPOINT);
 	}
@@ -0,0 +1,139 @@
+#include "scrapers/MediaStore.h"
+
+#include "utils/FileSystemUtil.h"
+#include "FileHasher.h"
+#include "Log.h"
+#include "Settings.h"
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+static std::mutex sLock;
+static std::unordered_map<std::string, std::string> sIndex; // "size:md5" -> first path with this content
+static bool sLoaded = false;
+static std::atomic<int> sLinkCount(0); // makes the temporary names unique between the post-processing threads
+
+static std::string getIndexPath()
+{
+	return Utils::FileSystem::getEsConfigPath() + "/mediastore.index";
+}
+
+// Called with sLock held
+static void loadIndex()
+{
+	if (sLoaded)
+		return;
+
+	sLoaded = true;
+
+	int lines = 0;
+
+	{
+		std::ifstream file(getIndexPath());
+		if (!file.is_open())
+			return;
+
+		// key|path, the last line of a key wins
+		std::string line;
+		while (std::getline(file, line))
+		{
+			auto pos = line.find('|');
+			if (pos == std::string::npos)
+				continue;
+
+			sIndex[line.substr(0, pos)] = line.substr(pos + 1);
+			lines++;
+		}
+	}
+
+	// The file is append only : rewrite it once it's mostly made of replaced entries
+	if (lines > 64 && lines > (int)sIndex.size() * 2)
+	{
+		std::ofstream file(getIndexPath(), std::ios_base::out | std::ios_base::trunc);
+		for (auto item : sIndex)
+			file << item.first << "|" << item.second << "\n";
+	}
+}
+
+// Called with sLock held
+static void setIndex(const std::string& key, const std::string& path)
+{
+	sIndex[key] = path;
+
+	std::ofstream file(getIndexPath(), std::ios_base::out | std::ios_base::app);
+	file << key << "|" << path << "\n";
+}
+
+bool MediaStore::isEnabled()
+{
+	return Settings::getInstance()->getBool("ScraperMediaStore");
+}
+
+void MediaStore::add(const std::string& path)
+{
+	size_t size = Utils::FileSystem::getFileSize(path);
+	if (size == 0)
+		return;
+
+	// Hash outside the lock, medias are processed in parallel
+	std::string md5 = FileHasher::getMD5(path);
+	if (md5.empty())
+		return;
+
+	std::string key = std::to_string(size) + ":" + md5;
+	std::string existing;
+
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+		loadIndex();
+
+		auto it = sIndex.find(key);
+		if (it == sIndex.cend() || it->second == path)
+		{
+			if (it == sIndex.cend())
+				setIndex(key, path);
+
+			return;
+		}
+
+		existing = it->second;
+	}
+
+	// The first copy may have been removed or changed since. Hashes are cached, this doesn't read it again
+	if (Utils::FileSystem::getFileSize(existing) != size || FileHasher::getMD5(existing) != md5)
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+		setIndex(key, path);
+		return;
+	}
+
+	std::string linkId = Utils::FileSystem::getHardLinkId(path);
+	if (!linkId.empty() && linkId == Utils::FileSystem::getHardLinkId(existing))
+		return;
+
+	// Replace the file only once the link exists. Not ".tmp" : HttpReq downloads to that name
+	std::string tmpPath = path + ".mslink" + std::to_string(sLinkCount++);
+	Utils::FileSystem::removeFile(tmpPath);
+
+	if (!Utils::FileSystem::createHardLink(existing, tmpPath))
+	{
+		LOG(LogDebug) << "MediaStore : unable to link " << path << " to " << existing;
+		return;
+	}
+
+	if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		// Windows doesn't replace existing files
+		Utils::FileSystem::removeFile(path);
+
+		if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+		{
+			LOG(LogError) << "MediaStore : unable to replace " << path;
+			Utils::FileSystem::removeFile(tmpPath);
+			return;
+		}
+	}
+
+	LOG(LogDebug) << "MediaStore : " << path << " shares the content of " << existing;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef ES_APP_SCRAPERS_MEDIA_STORE_H
+#define ES_APP_SCRAPERS_MEDIA_STORE_H
+
+#include <string>
+
+// Content addressed index of the scraped medias, stored in ~/.emulationstation/mediastore.index.
+// Regional variants, multi-disc sets or placeholders often get the very same files : once downloaded, a media whose
+// content is already known is replaced by a hardlink to the first copy. Gamelists keep their paths, the disk space is
+// shared, and the texture cache loads hardlinked files only once.
+// On filesystems without hardlinks, files are left as they are. Off by default (ScraperMediaStore) : editing one hardlinked
+// media changes all of them.
+class MediaStore
+{
+public:
+	static bool isEnabled();
+
+	// Called from the image processing threads, once the file at path is final
+	static void add(const std::string& path);
+};
+
+#endif // ES_APP_SCRAPERS_MEDIA_STORE_H
@@ -0,0 +1,88 @@
+#include "scrapers/MockScraper.h"
+
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "FileData.h"
+#include "Log.h"
+#include "Settings.h"
+#include "SystemData.h"
+#include "math/Misc.h"
+#include <SDL_timer.h>
+#include <atomic>
+
+static std::atomic<int> sAnswerCount(0);
+
+static std::string getMockPath()
+{
+	return Utils::FileSystem::getGenericPath(Settings::getInstance()->getString("ScraperMockPath"));
+}
+
+void mock_generate_scraper_requests(const ScraperSearchParams& params,
+	std::queue< std::unique_ptr<ScraperRequest> >& requests,
+	std::vector<ScraperSearchResult>& results)
+{
+	std::string root = getMockPath();
+	std::string system = root + "/" + params.system->getName();
+
+	std::string name = params.nameOverride.empty() ? Utils::FileSystem::getStem(params.game->getPath()) : params.nameOverride;
+
+	for (auto path : { system + "/" + name, system + "/default", root + "/default" })
+	{
+		if (Utils::FileSystem::exists(path + ".xml"))
+		{
+			requests.push(std::unique_ptr<ScraperRequest>(new MockScreenScraperRequest(results, path + ".xml")));
+			return;
+		}
+
+		if (Utils::FileSystem::exists(path + ".json"))
+		{
+			requests.push(std::unique_ptr<ScraperRequest>(new MockGamesDBRequest(results, path + ".json")));
+			return;
+		}
+	}
+
+	LOG(LogDebug) << "MockScraper : no answer for " << params.game->getPath();
+}
+
+MockAnswer::MockAnswer(const std::string& path) : mPath(path)
+{
+	mReadyTime = SDL_GetTicks() + (unsigned int)Math::max(0, Settings::getInstance()->getInt("ScraperMockLatency"));
+
+	// Spread evenly rather than randomly, so that two runs give the same numbers
+	int rate = Math::max(0, Math::min(100, Settings::getInstance()->getInt("ScraperMockErrorRate")));
+	int index = sAnswerCount++;
+	mError = (index * rate) / 100 != ((index + 1) * rate) / 100;
+}
+
+bool MockAnswer::isReady()
+{
+	return (int)(SDL_GetTicks() - mReadyTime) >= 0;
+}
+
+std::string MockAnswer::getContent()
+{
+	std::string content = Utils::FileSystem::readAllText(mPath);
+	return Utils::String::replace(content, "%MOCKPATH%", "file://" + getMockPath());
+}
+
+void MockScreenScraperRequest::update()
+{
+	if (mStatus != ASYNC_IN_PROGRESS || !mAnswer.isReady())
+		return;
+
+	if (mAnswer.isError())
+		setError(HttpReq::REQ_IO_ERROR, "MockScraper : injected error");
+	else
+		processContent(mAnswer.getContent(), nullptr);
+}
+
+void MockGamesDBRequest::update()
+{
+	if (mStatus != ASYNC_IN_PROGRESS || !mAnswer.isReady())
+		return;
+
+	if (mAnswer.isError())
+		setError(HttpReq::REQ_IO_ERROR, "MockScraper : injected error");
+	else
+		processContent(mAnswer.getContent(), nullptr);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef ES_APP_SCRAPERS_MOCK_SCRAPER_H
+#define ES_APP_SCRAPERS_MOCK_SCRAPER_H
+
+#include "scrapers/GamesDBJSONScraper.h"
+#include "scrapers/ScreenScraper.h"
+
+// Offline scraper serving canned answers, to measure the scraping pipeline or check the parsers without the real services.
+//
+// Answers are read from the "ScraperMockPath" directory, the first existing file being used :
+//   <system>/<rom name without extension>.xml|.json, <system>/default.xml|.json, default.xml|.json
+// .xml files are ScreenScraper "jeuInfos" answers, .json files TheGamesDB "Games/ByGameName" answers, both are processed
+// by the real parsers. No file means the game isn't found. %MOCKPATH% in an answer is replaced by the file:// url of
+// the directory, so medias can be served locally through the regular download path.
+//
+// Every answer is delayed by "ScraperMockLatency" ms, and "ScraperMockErrorRate" % of them fail with a non fatal error.
+
+void mock_generate_scraper_requests(const ScraperSearchParams& params, std::queue< std::unique_ptr<ScraperRequest> >& requests,
+	std::vector<ScraperSearchResult>& results);
+
+class MockAnswer
+{
+public:
+	MockAnswer(const std::string& path);
+
+	bool isReady();
+	bool isError() { return mError; }
+	std::string getContent();
+
+private:
+	std::string mPath;
+	unsigned int mReadyTime;
+	bool mError;
+};
+
+class MockScreenScraperRequest : public ScreenScraperRequest
+{
+public:
+	MockScreenScraperRequest(std::vector<ScraperSearchResult>& resultsWrite, const std::string& path) : ScreenScraperRequest(resultsWrite), mAnswer(path) {}
+
+	void update() override;
+
+private:
+	MockAnswer mAnswer;
+};
+
+class MockGamesDBRequest : public TheGamesDBJSONRequest
+{
+public:
+	MockGamesDBRequest(std::vector<ScraperSearchResult>& resultsWrite, const std::string& path) : TheGamesDBJSONRequest(resultsWrite), mAnswer(path) {}
+
+	void update() override;
+
+private:
+	MockAnswer mAnswer;
+};
+
+#endif // ES_APP_SCRAPERS_MOCK_SCRAPER_H
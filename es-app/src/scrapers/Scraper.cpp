@@ -2,6 +2,8 @@
 
 #include "FileData.h"
 #include "GamesDBJSONScraper.h"
+#include "MediaStore.h"
+#include "MockScraper.h"
 #include "ScreenScraper.h"
 #include "Log.h"
 #include "Settings.h"
@@ -10,12 +12,26 @@
 #include <fstream>
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
+#include <SDL_timer.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
 
+#ifdef WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 // batocera
 const std::map<std::string, generate_scraper_requests_func> scraper_request_funcs {
 	{ "ScreenScraper", &screenscraper_generate_scraper_requests },
-	{ "TheGamesDB", &thegamesdb_generate_json_scraper_requests }
+	{ "TheGamesDB", &thegamesdb_generate_json_scraper_requests },
+	{ "Mock", &mock_generate_scraper_requests }
 };
 
 std::unique_ptr<ScraperSearchHandle> startScraperSearch(const ScraperSearchParams& params)
@@ -24,6 +40,9 @@ std::unique_ptr<ScraperSearchHandle> startScraperSearch(const ScraperSearchParam
 
 	std::unique_ptr<ScraperSearchHandle> handle(new ScraperSearchHandle());
 
+	// The Mock scraper serves its medias from a local directory
+	HttpReq::setFileUrlsAllowed(name == "Mock");
+
 	// Check if the Scraper in the settings still exists as a registered scraping source.
 	auto it = scraper_request_funcs.find(name);
 	if (it != scraper_request_funcs.end())
@@ -39,6 +58,10 @@ std::vector<std::string> getScraperList()
 	std::vector<std::string> list;
 	for(auto it = scraper_request_funcs.cbegin(); it != scraper_request_funcs.cend(); it++)
 	{
+		// Only offered when a directory of canned answers is configured
+		if (it->first == "Mock" && Settings::getInstance()->getString("ScraperMockPath").empty())
+			continue;
+
 		list.push_back(it->first);
 	}
 
@@ -51,6 +74,53 @@ bool isValidConfiguredScraper()
 	return scraper_request_funcs.find(name) != scraper_request_funcs.end();
 }
 
+bool hasMissingMedias(FileData* game)
+{
+	if (Settings::getInstance()->getString("Scraper") == "ScreenScraper")
+	{
+		if (!Settings::getInstance()->getString("ScrapperImageSrc").empty() && !Utils::FileSystem::exists(game->getMetadata().get("image")))
+			return true;
+
+		if (!Settings::getInstance()->getString("ScrapperThumbSrc").empty() && !Utils::FileSystem::exists(game->getMetadata().get("thumbnail")))
+			return true;
+
+		if (!Settings::getInstance()->getString("ScrapperLogoSrc").empty() && !Utils::FileSystem::exists(game->getMetadata().get("marquee")))
+			return true;
+
+		if (Settings::getInstance()->getBool("ScrapeVideos") && !Utils::FileSystem::exists(game->getMetadata().get("video")))
+			return true;
+
+		return false;
+	}
+
+	return !Utils::FileSystem::exists(game->getMetadata().get("image"));
+}
+
+int getScraperMaxSearches()
+{
+	// ScreenScraper gives the number of threads allowed to the account with each answer
+	if (Settings::getInstance()->getString("Scraper") == "ScreenScraper")
+		return ScreenScraperRequest::getMaxThreads();
+
+	return 2;
+}
+
+int getScraperMaxDownloads()
+{
+	// ScreenScraper medias are served by the API servers, and count in the same limit
+	if (Settings::getInstance()->getString("Scraper") == "ScreenScraper")
+		return ScreenScraperRequest::getMaxThreads();
+
+	return 4;
+}
+
+static std::atomic<int> sThrottleCount(0);
+
+int getScraperThrottleCount()
+{
+	return sThrottleCount;
+}
+
 // ScraperSearchHandle
 ScraperSearchHandle::ScraperSearchHandle()
 {
@@ -111,8 +181,44 @@ ScraperHttpRequest::ScraperHttpRequest(std::vector<ScraperSearchResult>& results
 	: ScraperRequest(resultsWrite)
 {
 	setStatus(ASYNC_IN_PROGRESS);
-	mRequest = new HttpReq(url);
+	mRequest = nullptr;
+	mRetryCount = 0;
+	mRetryTime = 0;
+	mUseCache = false;
+
+	if (ScraperCache::load(url, mCachedEntry))
+	{
+		if (ScraperCache::isFresh(mCachedEntry))
+		{
+			mUseCache = true;
+			return;
+		}
+
+		// Stale : the server only sends the answer again if it changed
+		if (!mCachedEntry.etag.empty())
+			mHeaders.push_back("If-None-Match: " + mCachedEntry.etag);
+
+		if (!mCachedEntry.lastModified.empty())
+			mHeaders.push_back("If-Modified-Since: " + mCachedEntry.lastModified);
+	}
+	else if (ScraperCache::isOffline())
+	{
+		LOG(LogDebug) << "ScraperHttpRequest : no cached answer for " << ScraperCache::getKey(url);
+		setStatus(ASYNC_DONE); // Same as not found
+		return;
+	}
+
+	mRequest = new HttpReq(url, "", mHeaders);
+}
+
+ScraperHttpRequest::ScraperHttpRequest(std::vector<ScraperSearchResult>& resultsWrite)
+	: ScraperRequest(resultsWrite)
+{
+	setStatus(ASYNC_IN_PROGRESS);
+	mRequest = nullptr;
 	mRetryCount = 0;
+	mRetryTime = 0;
+	mUseCache = false;
 }
 
 ScraperHttpRequest::~ScraperHttpRequest()
@@ -120,8 +226,85 @@ ScraperHttpRequest::~ScraperHttpRequest()
 	delete mRequest;	
 }
 
+bool ScraperHttpRequest::retryLater()
+{
+	mRetryCount++;
+	if (mRetryCount > 4)
+		return false;
+
+	sThrottleCount++;
+
+	LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Wait before Retrying";
+
+	// Don't sleep here : other searches may be running in the same thread
+	mRetryUrl = mRequest->getUrl();
+	mRetryTime = SDL_GetTicks() + (mRetryCount < 3 ? 5000 : 10000);
+
+	delete mRequest;
+	mRequest = nullptr;
+
+	setStatus(ASYNC_IN_PROGRESS);
+	return true;
+}
+
+void ScraperHttpRequest::processContent(const std::string& content, HttpReq* request)
+{
+	setStatus(ASYNC_DONE); // if process() has an error, status will be changed to ASYNC_ERROR
+
+	// process() returns false when the server asks to slow down
+	if (!process(content, mResults))
+	{
+		if (request != nullptr && mStatus == ASYNC_DONE)
+			retryLater();
+
+		return;
+	}
+
+	if (request == nullptr || mStatus != ASYNC_DONE)
+		return;
+
+	// Only valid answers are stored, a "304 Not Modified" may not repeat the validators
+	ScraperCache::Entry entry;
+	entry.date = time(NULL);
+	entry.etag = request->getResponseHeader("ETag");
+	entry.lastModified = request->getResponseHeader("Last-Modified");
+	entry.content = getCacheContent(content);
+
+	if (request->status() == HttpReq::REQ_304_NOTMODIFIED)
+	{
+		if (entry.etag.empty())
+			entry.etag = mCachedEntry.etag;
+
+		if (entry.lastModified.empty())
+			entry.lastModified = mCachedEntry.lastModified;
+	}
+
+	ScraperCache::save(request->getUrl(), entry);
+}
+
 void ScraperHttpRequest::update()
 {
+	if (mUseCache)
+	{
+		mUseCache = false;
+		processContent(mCachedEntry.content, nullptr);
+		return;
+	}
+
+	if (mStatus != ASYNC_IN_PROGRESS)
+		return;
+
+	if (mRequest == nullptr)
+	{
+		if ((int)(SDL_GetTicks() - mRetryTime) >= 0)
+		{
+			LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying";
+			mRequest = new HttpReq(mRetryUrl, "", mHeaders);
+		}
+
+		return;
+	}
+
 	HttpReq::Status status = mRequest->status();
 
 	// not ready yet
@@ -130,31 +313,21 @@ void ScraperHttpRequest::update()
 
 	if(status == HttpReq::REQ_SUCCESS)
 	{
-		setStatus(ASYNC_DONE); // if process() has an error, status will be changed to ASYNC_ERROR
-		process(mRequest, mResults);
+		processContent(mRequest->getContent(), mRequest);
+		return;
+	}
+
+	// The cached answer is still valid, store it again to restart its lifetime
+	if (status == HttpReq::REQ_304_NOTMODIFIED && !mHeaders.empty())
+	{
+		processContent(mCachedEntry.content, mRequest);
 		return;
 	}
 
 	if (status == HttpReq::REQ_429_TOOMANYREQUESTS)
 	{
-		mRetryCount++;
-		if (mRetryCount > 4)
-		{
+		if (!retryLater())
 			setStatus(ASYNC_DONE); // Ignore error
-			return;
-		}
-
-		setStatus(ASYNC_IN_PROGRESS);
-
-		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Wait before Retrying";
-
-		std::string url = mRequest->getUrl();
-		std::this_thread::sleep_for(std::chrono::seconds(mRetryCount < 3 ? 5 : 10));
-		
-		delete mRequest;
-		mRequest = new HttpReq(url);
-
-		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying";
 
 		return;
 	}
@@ -320,6 +493,17 @@ MDResolveHandle::MDResolveHandle(const ScraperSearchResult& result, const Scrape
 		}, "video", result.mdl.getName()));
 	}
 
+	// Offline : only the medias already on disk are used
+	if (ScraperCache::isOffline() && !mFuncs.empty())
+	{
+		LOG(LogDebug) << "MDResolveHandle : offline, " << mFuncs.size() << " media downloads skipped";
+
+		for (auto fc : mFuncs)
+			delete fc;
+
+		mFuncs.clear();
+	}
+
 	auto it = mFuncs.cbegin();
 	if (it == mFuncs.cend())
 		setStatus(ASYNC_DONE);
@@ -375,6 +559,116 @@ void MDResolveHandle::update()
 		setStatus(ASYNC_DONE);
 }
 
+// Image post-processing
+// Downloaded images are resized and optimized by a few low priority threads rather than by the thread polling the handles.
+// The queue is bounded : when it's full, downloads wait before being reported as done, which slows down the scraper.
+
+struct ImageProcessingJob
+{
+	ImageProcessingJob(const std::string& _path, int _maxWidth, int _maxHeight, bool _optimize) 
+		: path(_path), maxWidth(_maxWidth), maxHeight(_maxHeight), optimize(_optimize), done(false) { }
+
+	std::string path;
+	int maxWidth;
+	int maxHeight;
+	bool optimize;
+
+	std::atomic<bool> done;
+};
+
+static std::mutex								sImageLock;
+static std::condition_variable					sImageEvent;
+static std::deque<std::shared_ptr<ImageProcessingJob>> sImageJobs;
+static std::vector<std::thread*>				sImageThreads;
+static bool										sImageExit = false;
+
+static int getImageThreadCount()
+{
+	// Leave a core to the UI and the downloads
+	int cores = (int)std::thread::hardware_concurrency();
+	return Math::max(1, Math::min(2, cores - 1));
+}
+
+static void imageThreadProc()
+{
+	// Below the UI thread, so that a long scrape doesn't make it miss frames
+#ifdef WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+
+	while (true)
+	{
+		std::shared_ptr<ImageProcessingJob> job;
+
+		{
+			std::unique_lock<std::mutex> lock(sImageLock);
+			sImageEvent.wait(lock, [] { return sImageExit || !sImageJobs.empty(); });
+
+			if (sImageExit)
+				return;
+
+			job = sImageJobs.front();
+			sImageJobs.pop_front();
+		}
+
+		try { resizeImage(job->path, job->maxWidth, job->maxHeight, job->optimize); }
+		catch (...) {}
+
+		if (MediaStore::isEnabled())
+			MediaStore::add(job->path);
+
+		job->done = true;
+	}
+}
+
+// Returns false when the queue is full, the caller has to try again later
+static bool queueImageProcessing(const std::shared_ptr<ImageProcessingJob>& job)
+{
+	std::unique_lock<std::mutex> lock(sImageLock);
+
+	int threadCount = getImageThreadCount();
+	if ((int)sImageJobs.size() >= threadCount * 2)
+		return false;
+
+	// Threads run until stopImageProcessing()
+	while ((int)sImageThreads.size() < threadCount)
+		sImageThreads.push_back(new std::thread(imageThreadProc));
+
+	sImageJobs.push_back(job);
+	sImageEvent.notify_one();
+	return true;
+}
+
+void stopImageProcessing()
+{
+	std::vector<std::thread*> threads;
+
+	{
+		std::unique_lock<std::mutex> lock(sImageLock);
+		sImageExit = true;
+		threads.swap(sImageThreads);
+	}
+
+	sImageEvent.notify_all();
+
+	for (auto thread : threads)
+	{
+		thread->join();
+		delete thread;
+	}
+
+	std::unique_lock<std::mutex> lock(sImageLock);
+
+	// Jobs left in the queue are given up, their images are kept as downloaded
+	for (auto job : sImageJobs)
+		job->done = true;
+
+	sImageJobs.clear();
+	sImageExit = false;
+}
+
 std::unique_ptr<ImageDownloadHandle> downloadImageAsync(const std::string& url, const std::string& saveAs)
 {
 	return std::unique_ptr<ImageDownloadHandle>(new ImageDownloadHandle(url, saveAs, 
@@ -382,7 +676,7 @@ std::unique_ptr<ImageDownloadHandle> downloadImageAsync(const std::string& url,
 }
 
 ImageDownloadHandle::ImageDownloadHandle(const std::string& url, const std::string& path, int maxWidth, int maxHeight) : 
-	mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight)
+	mRetryCount(0), mRetryTime(0), mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight)
 {
 	mRequest = new HttpReq(url, path);
 }
@@ -394,39 +688,68 @@ ImageDownloadHandle::~ImageDownloadHandle()
 
 int ImageDownloadHandle::getPercent()
 {
-	if (mRequest->status() == HttpReq::REQ_IN_PROGRESS)
+	if (mProcessing != nullptr)
+		return 100;
+
+	if (mRequest != nullptr && mRequest->status() == HttpReq::REQ_IN_PROGRESS)
 		return mRequest->getPercent();
 
 	return -1;
 }
 
+bool ImageDownloadHandle::retryLater()
+{
+	mRetryCount++;
+	if (mRetryCount > 4)
+		return false;
+
+	sThrottleCount++;
+
+	LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Wait before Retrying";
+
+	mRetryUrl = mRequest->getUrl();
+	mRetryTime = SDL_GetTicks() + (mRetryCount < 3 ? 5000 : 10000);
+
+	delete mRequest;
+	mRequest = nullptr;
+
+	setStatus(ASYNC_IN_PROGRESS);
+	return true;
+}
+
 void ImageDownloadHandle::update()
 {
-	HttpReq::Status status = mRequest->status();
+	if (mStatus != ASYNC_IN_PROGRESS)
+		return;
+
+	if (mProcessing != nullptr)
+	{
+		if (mProcessing->done)
+			setStatus(ASYNC_DONE);
 
-	if (status == HttpReq::REQ_IN_PROGRESS)
 		return;
-	
-	if (status == HttpReq::REQ_429_TOOMANYREQUESTS)
+	}
+
+	if (mRequest == nullptr)
 	{
-		mRetryCount++;
-		if (mRetryCount > 4)
+		if ((int)(SDL_GetTicks() - mRetryTime) >= 0)
 		{
-			setStatus(ASYNC_DONE); // Ignore error
-			return;
+			LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying";
+			mRequest = new HttpReq(mRetryUrl, mSavePath);
 		}
 
-		setStatus(ASYNC_IN_PROGRESS);
-
-		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Wait before Retrying";
-
-		std::string url = mRequest->getUrl();
-		std::this_thread::sleep_for(std::chrono::seconds(mRetryCount < 3 ? 5 : 10));
+		return;
+	}
 
-		delete mRequest;
-		mRequest = new HttpReq(url, mSavePath);
+	HttpReq::Status status = mRequest->status();
 
-		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying";
+	if (status == HttpReq::REQ_IN_PROGRESS)
+		return;
+	
+	if (status == HttpReq::REQ_429_TOOMANYREQUESTS)
+	{
+		if (!retryLater())
+			setStatus(ASYNC_DONE); // Ignore error
 
 		return;
 	}
@@ -445,25 +768,52 @@ void ImageDownloadHandle::update()
 		return;
 	}
 
-	if (status == HttpReq::REQ_SUCCESS && mStatus == ASYNC_IN_PROGRESS)
+	// It's an image ?
+	std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(mSavePath));
+	bool isImage = (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".gif");
+
+	// gifs are only resized : the optimize pass has no settings for them, it would only re-encode them
+	bool optimize = isImage && ext != ".gif" && Settings::getInstance()->getBool("ScraperOptimizeImages");
+	bool resize = isImage && (mMaxWidth != 0 || mMaxHeight != 0 || optimize);
+
+	// Hashing for the media store is done by the same threads, videos included
+	if (resize || MediaStore::isEnabled())
 	{
-		// It's an image ?
-		std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(mSavePath));
-		if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".gif")
-		{
-			try { resizeImage(mSavePath, mMaxWidth, mMaxHeight); }
-			catch(...) { }
-		}
+		auto job = std::make_shared<ImageProcessingJob>(mSavePath, resize ? mMaxWidth : 0, resize ? mMaxHeight : 0, optimize);
+		if (queueImageProcessing(job))
+			mProcessing = job;
+
+		return;
 	}
 
 	setStatus(ASYNC_DONE);
 }
 
+// Returns true if all the pixels of a 32 bits image are opaque
+static bool isOpaque(FIBITMAP* image)
+{
+	if (FreeImage_GetBPP(image) != 32)
+		return false;
+
+	int width = (int)FreeImage_GetWidth(image);
+	int height = (int)FreeImage_GetHeight(image);
+
+	for (int y = 0; y < height; y++)
+	{
+		BYTE* pixel = FreeImage_GetScanLine(image, y);
+		for (int x = 0; x < width; x++, pixel += 4)
+			if (pixel[FI_RGBA_ALPHA] != 0xFF)
+				return false;
+	}
+
+	return true;
+}
+
 //you can pass 0 for width or height to keep aspect ratio
-bool resizeImage(const std::string& path, int maxWidth, int maxHeight)
+bool resizeImage(const std::string& path, int maxWidth, int maxHeight, bool optimize)
 {
 	// nothing to do
-	if(maxWidth == 0 && maxHeight == 0)
+	if(maxWidth == 0 && maxHeight == 0 && !optimize)
 		return true;
 
 	FREE_IMAGE_FORMAT format = FIF_UNKNOWN;
@@ -497,35 +847,75 @@ bool resizeImage(const std::string& path, int maxWidth, int maxHeight)
 		return true;
 	}
 
-	if(maxWidth == 0)
-		maxWidth = (int)((maxHeight / height) * width);
-	else if(maxHeight == 0)
-		maxHeight = (int)((maxWidth / width) * height);
-	
-	if (width <= maxWidth && height <= maxHeight)
+	bool resized = false;
+
+	if (maxWidth != 0 || maxHeight != 0)
+	{
+		if(maxWidth == 0)
+			maxWidth = (int)((maxHeight / height) * width);
+		else if(maxHeight == 0)
+			maxHeight = (int)((maxWidth / width) * height);
+
+		if (width > maxWidth || height > maxHeight)
+		{
+			FIBITMAP* imageRescaled = FreeImage_Rescale(image, maxWidth, maxHeight, FILTER_BILINEAR);
+			FreeImage_Unload(image);
+
+			if(imageRescaled == NULL)
+			{
+				LOG(LogError) << "Could not resize image! (not enough memory? invalid bitdepth?)";
+				return false;
+			}
+
+			image = imageRescaled;
+			resized = true;
+		}
+	}
+
+	// Encoding a jpeg again loses quality : only do it when it was resized
+	if (!resized && (!optimize || format != FIF_PNG))
 	{
 		FreeImage_Unload(image);
 		return true;
 	}
-		
-	FIBITMAP* imageRescaled = FreeImage_Rescale(image, maxWidth, maxHeight, FILTER_BILINEAR);
-	FreeImage_Unload(image);
 
-	if(imageRescaled == NULL)
+	int flags = 0;
+
+	if (optimize)
 	{
-		LOG(LogError) << "Could not resize image! (not enough memory? invalid bitdepth?)";
-		return false;
+		// ES doesn't use the metadata, and they can be bigger than a small picture
+		FREE_IMAGE_MDMODEL models[] = { FIMD_COMMENTS, FIMD_EXIF_MAIN, FIMD_EXIF_EXIF, FIMD_EXIF_GPS, FIMD_EXIF_MAKERNOTE, FIMD_EXIF_INTEROP, FIMD_IPTC, FIMD_XMP, FIMD_EXIF_RAW };
+		for (auto model : models)
+			FreeImage_SetMetadata(model, image, NULL, NULL);
+
+		FreeImage_DestroyICCProfile(image);
+
+		// An alpha channel without any transparency only wastes space
+		if (format == FIF_PNG && isOpaque(image))
+		{
+			FIBITMAP* image24 = FreeImage_ConvertTo24Bits(image);
+			if (image24 != NULL)
+			{
+				FreeImage_Unload(image);
+				image = image24;
+			}
+		}
+
+		if (format == FIF_PNG)
+			flags = PNG_Z_BEST_COMPRESSION;
+		else if (format == FIF_JPEG)
+			flags = JPEG_QUALITYGOOD | JPEG_OPTIMIZE;
 	}
 
 	bool saved = false;
 	
 	try
 	{
-		saved = (FreeImage_Save(format, imageRescaled, path.c_str()) != 0);
+		saved = (FreeImage_Save(format, image, path.c_str(), flags) != 0);
 	}
 	catch(...) { }
 
-	FreeImage_Unload(imageRescaled);
+	FreeImage_Unload(image);
 
 	if(!saved)
 		LOG(LogError) << "Failed to save resized image!";
@@ -5,6 +5,7 @@
 #include "AsyncHandle.h"
 #include "HttpReq.h"
 #include "MetaData.h"
+#include "scrapers/ScraperCache.h"
 #include <functional>
 #include <memory>
 #include <queue>
@@ -88,6 +89,7 @@ protected:
 };
 
 // a single HTTP request that needs to be processed to get the results
+// Answers are kept in the ScraperCache : a fresh cached answer is processed without any network access
 class ScraperHttpRequest : public ScraperRequest
 {
 public:
@@ -97,11 +99,29 @@ public:
 	virtual void update() override;
 
 protected:
-	virtual bool process(HttpReq* request, std::vector<ScraperSearchResult>& results) = 0;
+	// No transport : the subclass gives the answer to processContent itself
+	ScraperHttpRequest(std::vector<ScraperSearchResult>& resultsWrite);
+
+	virtual bool process(const std::string& content, std::vector<ScraperSearchResult>& results) = 0;
+	void processContent(const std::string& content, HttpReq* request);
+
+	// Content written to the cache : removes what is private to the account, it must still be accepted by process()
+	virtual std::string getCacheContent(const std::string& content) { return content; }
 
 private:
+	bool retryLater();
+
 	HttpReq* mRequest;
 	int	mRetryCount;
+
+	// Cached answer : processed at the first update when fresh, or kept until the server confirms it's still valid
+	bool mUseCache;
+	ScraperCache::Entry mCachedEntry;
+	std::vector<std::string> mHeaders;
+
+	// The request is recreated once mRetryTime is reached, without blocking the caller
+	std::string mRetryUrl;
+	unsigned int mRetryTime;
 };
 
 // a request to get a list of results
@@ -129,6 +149,16 @@ std::vector<std::string> getScraperList();
 // returns true if the scraper configured in the settings is still valid
 bool isValidConfiguredScraper();
 
+// returns true if one of the medias the configured scraper can download is missing for the game
+bool hasMissingMedias(FileData* game);
+
+// number of searches and media downloads the configured scraper allows to run concurrently
+int getScraperMaxSearches();
+int getScraperMaxDownloads();
+
+// number of "too many requests" answers received so far, concurrent scraping slows down when it grows
+int getScraperThrottleCount();
+
 typedef void (*generate_scraper_requests_func)(const ScraperSearchParams& params, std::queue< std::unique_ptr<ScraperRequest> >& requests, std::vector<ScraperSearchResult>& results);
 
 // -------------------------------------------------------------------------
@@ -191,6 +221,8 @@ private:
 	int mPercent;
 };
 
+struct ImageProcessingJob;
+
 class ImageDownloadHandle : public AsyncHandle
 {
 public:
@@ -202,12 +234,20 @@ public:
 	virtual int getPercent();
 
 private:
+	bool retryLater();
+
 	HttpReq* mRequest;
 	int	mRetryCount;
 
+	std::string mRetryUrl;
+	unsigned int mRetryTime;
+
 	std::string mSavePath;
 	int mMaxWidth;
 	int mMaxHeight;
+
+	// Set once the download is done, while the image is resized by the post-processing threads
+	std::shared_ptr<ImageProcessingJob> mProcessing;
 };
 
 //About the same as "~/.emulationstation/downloaded_images/[system_name]/[game_name].[url's extension]".
@@ -222,7 +262,11 @@ std::unique_ptr<MDResolveHandle> resolveMetaDataAssets(const ScraperSearchResult
 
 //You can pass 0 for maxWidth or maxHeight to automatically keep the aspect ratio.
 //Will overwrite the image at [path] with the new resized one.
+//With optimize, metadata are removed and the image is saved with the best compression.
 //Returns true if successful, false otherwise.
-bool resizeImage(const std::string& path, int maxWidth, int maxHeight);
+bool resizeImage(const std::string& path, int maxWidth, int maxHeight, bool optimize = false);
+
+// Joins the threads resizing the downloaded images. They are started again by the next download
+void stopImageProcessing();
 
 #endif // ES_APP_SCRAPERS_SCRAPER_H
@@ -0,0 +1,232 @@
+#include "scrapers/ScraperCache.h"
+
+#include "scrapers/md5.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "Log.h"
+#include "Settings.h"
+#include "math/Misc.h"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#define CACHE_FILE_HEADER	"ESCACHE1"
+
+// Query parameters identifying the user or the application rather than the request
+static const std::vector<std::string> sCredentialParameters = { "devid", "devpassword", "softname", "ssid", "sspassword", "apikey" };
+
+// Credentials naming the user : the key keeps a digest of their value, never the value itself
+static const std::vector<std::string> sUserParameters = { "ssid" };
+
+static std::mutex	sLock;
+static long long	sTotalSize = -1; // unknown until the cache folder is scanned
+
+bool ScraperCache::mOffline = false;
+
+bool ScraperCache::isEnabled()
+{
+	return mOffline || Settings::getInstance()->getInt("ScraperCacheDays") > 0;
+}
+
+std::string ScraperCache::getCachePath()
+{
+	return Utils::FileSystem::getEsConfigPath() + "/scrapercache";
+}
+
+std::string ScraperCache::getKey(const std::string& url)
+{
+	std::string address = url;
+	std::string query;
+
+	auto pos = url.find('?');
+	if (pos != std::string::npos)
+	{
+		address = url.substr(0, pos);
+		query = url.substr(pos + 1);
+	}
+
+	// Scheme and host are case insensitive
+	auto hostEnd = address.find('/', address.find("://") == std::string::npos ? 0 : address.find("://") + 3);
+	if (hostEnd == std::string::npos)
+		address = Utils::String::toLower(address);
+	else
+		address = Utils::String::toLower(address.substr(0, hostEnd)) + address.substr(hostEnd);
+
+	std::vector<std::string> parameters;
+	std::string user;
+
+	for (auto parameter : Utils::String::split(query, '&'))
+	{
+		if (parameter.empty())
+			continue;
+
+		auto equal = parameter.find('=');
+		std::string name = Utils::String::toLower(parameter.substr(0, equal));
+
+		if (equal != std::string::npos && std::find(sUserParameters.cbegin(), sUserParameters.cend(), name) != sUserParameters.cend())
+			user = MD5(Utils::String::toLower(parameter.substr(equal + 1))).hexdigest();
+
+		if (std::find(sCredentialParameters.cbegin(), sCredentialParameters.cend(), name) != sCredentialParameters.cend())
+			continue;
+
+		parameters.push_back(parameter);
+	}
+
+	// The order of the parameters doesn't change the answer
+	std::sort(parameters.begin(), parameters.end());
+
+	std::string key = address;
+	for (size_t i = 0; i < parameters.size(); i++)
+		key += (i == 0 ? "?" : "&") + parameters[i];
+
+	// Never sent : only separates the answers given to different accounts
+	if (!user.empty())
+		key += "#user=" + user;
+
+	return key;
+}
+
+std::string ScraperCache::getEntryPath(const std::string& url)
+{
+	return getCachePath() + "/" + MD5(getKey(url)).hexdigest() + ".cache";
+}
+
+bool ScraperCache::isFresh(const ScraperCache::Entry& entry)
+{
+	if (mOffline)
+		return true;
+
+	int days = Settings::getInstance()->getInt("ScraperCacheDays");
+	if (days <= 0)
+		return false;
+
+	return difftime(time(NULL), entry.date) < days * 86400.0;
+}
+
+bool ScraperCache::load(const std::string& url, ScraperCache::Entry& entry)
+{
+	if (!isEnabled())
+		return false;
+
+	std::string path = getEntryPath(url);
+	std::string key = getKey(url);
+
+	std::unique_lock<std::mutex> lock(sLock);
+
+	std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+	if (!file.is_open())
+		return false;
+
+	std::string header, entryKey, date;
+	if (!std::getline(file, header) || header != CACHE_FILE_HEADER)
+		return false;
+
+	// Different urls with the same hash are very unlikely, but would give wrong results
+	if (!std::getline(file, entryKey) || entryKey != key)
+		return false;
+
+	if (!std::getline(file, date) || !std::getline(file, entry.etag) || !std::getline(file, entry.lastModified))
+		return false;
+
+	entry.date = (time_t)atoll(date.c_str());
+
+	std::stringstream content;
+	content << file.rdbuf();
+	entry.content = content.str();
+
+	return true;
+}
+
+void ScraperCache::save(const std::string& url, const ScraperCache::Entry& entry)
+{
+	if (mOffline || Settings::getInstance()->getInt("ScraperCacheDays") <= 0)
+		return;
+
+	std::string path = getEntryPath(url);
+	std::string key = getKey(url);
+
+	std::unique_lock<std::mutex> lock(sLock);
+
+	if (!Utils::FileSystem::isDirectory(getCachePath()))
+		Utils::FileSystem::createDirectory(getCachePath());
+
+	size_t oldSize = Utils::FileSystem::getFileSize(path);
+
+	std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!file.is_open())
+	{
+		LOG(LogWarning) << "ScraperCache : unable to write " << path;
+		return;
+	}
+
+	// Header values are single lines : curl gives them without line breaks
+	file << CACHE_FILE_HEADER << "\n" << key << "\n" << (long long)entry.date << "\n" << entry.etag << "\n" << entry.lastModified << "\n";
+	file << entry.content;
+
+	long long size = (long long)file.tellp();
+	file.close();
+
+	if (sTotalSize >= 0)
+		sTotalSize += size - (long long)oldSize;
+
+	trim();
+}
+
+// Removes the entries the least recently received or revalidated, when the cache grows above its size limit
+// Called with sLock held
+void ScraperCache::trim()
+{
+	long long maxSize = (long long)Math::max(1, Settings::getInstance()->getInt("ScraperCacheMaxSize")) * 1024 * 1024;
+	if (sTotalSize >= 0 && sTotalSize <= maxSize)
+		return;
+
+	struct CacheFile
+	{
+		std::string path;
+		time_t		date;
+		long long	size;
+	};
+
+	std::vector<CacheFile> files;
+	long long totalSize = 0;
+
+	for (auto fi : Utils::FileSystem::getDirectoryFiles(getCachePath()))
+	{
+		if (fi.directory || Utils::FileSystem::getExtension(fi.path) != ".cache")
+			continue;
+
+		CacheFile file;
+		file.path = fi.path;
+		file.date = Utils::FileSystem::getFileModificationDate(fi.path).getTime();
+		file.size = (long long)Utils::FileSystem::getFileSize(fi.path);
+		files.push_back(file);
+
+		totalSize += file.size;
+	}
+
+	sTotalSize = totalSize;
+	if (sTotalSize <= maxSize)
+		return;
+
+	std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.date < b.date; });
+
+	// Leave some room, so trimming doesn't happen again with the next answer
+	long long targetSize = maxSize * 3 / 4;
+
+	int count = 0;
+	for (auto file : files)
+	{
+		if (sTotalSize <= targetSize)
+			break;
+
+		if (Utils::FileSystem::removeFile(file.path))
+		{
+			sTotalSize -= file.size;
+			count++;
+		}
+	}
+
+	LOG(LogInfo) << "ScraperCache : removed " << count << " entries";
+}
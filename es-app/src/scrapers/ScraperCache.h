@@ -0,0 +1,48 @@
+#pragma once
+#ifndef ES_APP_SCRAPERS_SCRAPER_CACHE_H
+#define ES_APP_SCRAPERS_SCRAPER_CACHE_H
+
+#include <string>
+#include <ctime>
+
+// Persistent cache of the scraper API answers, stored in ~/.emulationstation/scrapercache.
+// Entries are keyed by the request url, normalized and stripped from credentials, so re-scraping a system doesn't
+// query the servers again. Answers can depend on the account, so a digest of the user name is part of the key. Entries older than "ScraperCacheDays" are revalidated
+// with their ETag / Last-Modified validators, and the oldest ones are removed above "ScraperCacheMaxSize" Mb.
+class ScraperCache
+{
+public:
+	struct Entry
+	{
+		Entry() : date(0) { }
+
+		time_t		date; // when the answer was received or last revalidated
+		std::string etag;
+		std::string lastModified;
+		std::string content;
+	};
+
+	// Offline mode serves every request from the cache, whatever its age. The scraper doesn't use the network :
+	// medias are not downloaded either
+	static void setOffline(bool offline) { mOffline = offline; }
+	static bool isOffline() { return mOffline; }
+
+	static bool isEnabled();
+
+	static bool load(const std::string& url, Entry& entry);
+	static void save(const std::string& url, const Entry& entry);
+
+	// Returns true if the entry can be used without asking the server
+	static bool isFresh(const Entry& entry);
+
+	static std::string getKey(const std::string& url);
+
+private:
+	static std::string getCachePath();
+	static std::string getEntryPath(const std::string& url);
+	static void trim();
+
+	static bool mOffline;
+};
+
+#endif // ES_APP_SCRAPERS_SCRAPER_CACHE_H
@@ -10,16 +10,84 @@
 #include <pugixml/src/pugixml.hpp>
 #include <cstring>
 #include "SystemConf.h"
-#include "md5.h"
+#include "FileHasher.h"
 #include <thread>
 
 using namespace PlatformIds;
 
+std::atomic<int> ScreenScraperRequest::sMaxThreads(1);
+
+#define SSID_PLACEHOLDER		"#ssid#"
+#define SSPASSWORD_PLACEHOLDER	"#sspassword#"
+
 std::string ScreenScraperRequest::ensureUrl(const std::string url)
 {
-	return Utils::String::replace(
+	std::string ret = Utils::String::replace(
 		Utils::String::replace(url, " ", "%20") ,
 		"#screenscraperserveur#", "https://www.screenscraper.fr/");
+
+	// Urls of a cached answer : the credentials are those of the current account
+	if (ret.find(SSID_PLACEHOLDER) != std::string::npos)
+	{
+		ret = Utils::String::replace(ret, SSID_PLACEHOLDER, HttpReq::urlEncode(Settings::getInstance()->getString("ScreenScraperUser")));
+		ret = Utils::String::replace(ret, SSPASSWORD_PLACEHOLDER, HttpReq::urlEncode(Settings::getInstance()->getString("ScreenScraperPass")));
+	}
+
+	return ret;
+}
+
+// Removes the <name>...</name> elements
+static std::string removeXmlElement(const std::string& xml, const std::string& name)
+{
+	std::string ret = xml;
+
+	size_t start;
+	while ((start = ret.find("<" + name + ">")) != std::string::npos)
+	{
+		size_t end = ret.find("</" + name + ">", start);
+		if (end == std::string::npos)
+			break;
+
+		ret.erase(start, end + name.size() + 3 - start);
+	}
+
+	return ret;
+}
+
+// Replaces the value of the 'name' parameter in every url of the answer
+static std::string replaceUrlParameter(const std::string& xml, const std::string& name, const std::string& value)
+{
+	std::string ret = xml;
+
+	for (auto prefix : { "?", "&amp;", "&" })
+	{
+		std::string parameter = prefix + name + "=";
+
+		size_t pos = 0;
+		while ((pos = ret.find(parameter, pos)) != std::string::npos)
+		{
+			pos += parameter.size();
+
+			size_t end = ret.find_first_of("&<\"' ", pos);
+			if (end == std::string::npos)
+				end = ret.size();
+
+			ret.replace(pos, end - pos, value);
+			pos += value.size();
+		}
+	}
+
+	return ret;
+}
+
+std::string ScreenScraperRequest::getCacheContent(const std::string& content)
+{
+	// The answer describes the account and repeats the query, and the media urls hold the user credentials
+	std::string ret = removeXmlElement(content, "ssuser");
+	ret = removeXmlElement(ret, "commandRequested");
+	ret = replaceUrlParameter(ret, "ssid", SSID_PLACEHOLDER);
+	ret = replaceUrlParameter(ret, "sspassword", SSPASSWORD_PLACEHOLDER);
+	return ret;
 }
 
 
@@ -211,37 +279,9 @@ void screenscraper_generate_scraper_requests(const ScraperSearchParams& params,
 		int length = Utils::FileSystem::getFileSize(params.game->getFullPath());
 		if (length <= 131072 * 1024) // 128 Mb max
 		{
-			try
-			{
-				// 64 Kb blocks
-				#define MD5BUFFERSIZE 64 * 1024
-
-				char* buffer = new char[MD5BUFFERSIZE];
-				if (buffer)
-				{
-					size_t size;
-
-					FILE* file = fopen(params.game->getFullPath().c_str(), "rb");
-					if (file)
-					{
-						MD5 md5 = MD5();
-
-						while (size = fread(buffer, 1, MD5BUFFERSIZE, file))
-							md5.update(buffer, size);
-
-						md5.finalize();
-
-						std::string val = md5.hexdigest();
-						if (!val.empty())
-							path += "&md5=" + val;
-
-						fclose(file);
-					}
-
-					delete buffer;
-				}
-			}
-			catch (std::bad_alloc& ex) {}
+			std::string val = FileHasher::getMD5(params.game->getFullPath());
+			if (!val.empty())
+				path += "&md5=" + val;
 		}
 	}
 	else
@@ -284,12 +324,8 @@ void screenscraper_generate_scraper_requests(const ScraperSearchParams& params,
 }
 
 // Process should return false only when we reached a maximum scrap by minute, to retry
-bool ScreenScraperRequest::process(HttpReq* request, std::vector<ScraperSearchResult>& results)
+bool ScreenScraperRequest::process(const std::string& content, std::vector<ScraperSearchResult>& results)
 {
-	assert(request->status() == HttpReq::REQ_SUCCESS);
-
-	auto content = request->getContent();
-
 	pugi::xml_document doc;
 	pugi::xml_parse_result parseResult = doc.load(content.c_str());
 
@@ -385,6 +421,14 @@ void ScreenScraperRequest::processGame(const pugi::xml_document& xmldoc, std::ve
 	LOG(LogDebug) << "ScreenScraperRequest::processGame >>";
 
 	pugi::xml_node data = xmldoc.child("Data");
+
+	pugi::xml_node user = data.child("ssuser");
+	if (user && user.child("maxthreads"))
+	{
+		int maxThreads = user.child("maxthreads").text().as_int();
+		if (maxThreads > 0)
+			sMaxThreads = maxThreads;
+	}
 	if (data.child("jeux"))
 		data = data.child("jeux");
 
@@ -4,6 +4,7 @@
 
 #include "scrapers/Scraper.h"
 #include "EmulationStation.h"
+#include <atomic>
 
 namespace pugi { class xml_document; }
 
@@ -56,8 +57,15 @@ public:
 		ScreenScraperConfig() {};
 	} configuration;
 
+	// Threads allowed to the account, as returned by the last answer (1 until known)
+	static int getMaxThreads() { return sMaxThreads; }
+
 protected:
-	bool process(HttpReq* request, std::vector<ScraperSearchResult>& results) override;
+	// ctor for a GetGame request whose answer is given by the subclass
+	ScreenScraperRequest(std::vector<ScraperSearchResult>& resultsWrite) : ScraperHttpRequest(resultsWrite), mRequestQueue(nullptr) {}
+
+	bool process(const std::string& content, std::vector<ScraperSearchResult>& results) override;
+	std::string getCacheContent(const std::string& content) override;
 	std::string ensureUrl(const std::string url);
 
 	void processList(const pugi::xml_document& xmldoc, std::vector<ScraperSearchResult>& results);
@@ -66,6 +74,8 @@ protected:
 
 	std::queue< std::unique_ptr<ScraperRequest> >* mRequestQueue;
 
+	static std::atomic<int> sMaxThreads; // set from the scraper threads
+
 private:
 	std::vector<std::string>	getRipList(std::string imageSource);
 	pugi::xml_node				findMedia(pugi::xml_node media_list, std::vector<std::string> mediaNames, std::string region);
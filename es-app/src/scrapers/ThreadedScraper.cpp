@@ -6,31 +6,53 @@
 #include "guis/GuiMsgBox.h"
 #include "Gamelist.h"
 #include "Log.h"
+#include <SDL_timer.h>
 
 #define GUIICON _U("\uF03E ")
+#define THROTTLE_RECOVERY_DELAY	30000
 
 ThreadedScraper* ThreadedScraper::mInstance = nullptr;
 bool ThreadedScraper::mPaused = false;
 
+static std::mutex sInstanceLock;
+static std::condition_variable sInstanceGone; // notified when mInstance is cleared
+
 ThreadedScraper::ThreadedScraper(Window* window, const std::queue<ScraperSearchParams>& searches)
 	: mSearchQueue(searches), mWindow(window)
 {
 	mExit = false;
 	mTotal = (int) mSearchQueue.size();
+	mCompleted = 0;
+
+	mThrottleCount = getScraperThrottleCount();
+	mThrottlePenalty = 0;
+	mThrottleTime = 0;
 
-	mWndNotification = new AsyncNotificationComponent(window);
+	mHandle = nullptr;
+	mWndNotification = nullptr;
 
-	mWindow->registerNotificationComponent(mWndNotification);
-	search(mSearchQueue.front());
-	mHandle = new std::thread(&ThreadedScraper::run, this);	
+	if (mWindow != nullptr)
+	{
+		mWndNotification = new AsyncNotificationComponent(window);
+		mWindow->registerNotificationComponent(mWndNotification);
+	}
 }
 
 ThreadedScraper::~ThreadedScraper()
 {
-	mWindow->unRegisterNotificationComponent(mWndNotification);
-	delete mWndNotification;
+	if (mWndNotification != nullptr)
+	{
+		mWindow->unRegisterNotificationComponent(mWndNotification);
+		delete mWndNotification;
+	}
 
-	ThreadedScraper::mInstance = nullptr;
+	stopImageProcessing();
+
+	std::unique_lock<std::mutex> lock(sInstanceLock);
+	if (ThreadedScraper::mInstance == this)
+		ThreadedScraper::mInstance = nullptr;
+
+	sInstanceGone.notify_all();
 }
 
 std::string ThreadedScraper::formatGameName(FileData* game)
@@ -38,23 +60,11 @@ std::string ThreadedScraper::formatGameName(FileData* game)
 	return "["+game->getSystemName()+"] " + game->getName();
 }
 
-void ThreadedScraper::search(const ScraperSearchParams& params)
+void ThreadedScraper::search(ScrapeJob* job)
 {
-	LOG(LogDebug) << "ThreadedScraper::formatGameName";
-
-	std::string gameName = formatGameName(params.game);
-
-	LOG(LogInfo) << "ThreadedScraper::search >> " << gameName;
-
-	mCurrentAction = "";
-	mLastSearch = params;
-	mSearchHandle = startScraperSearch(params);
+	LOG(LogInfo) << "ThreadedScraper::search >> " << formatGameName(job->search.game);
 
-	std::string idx = std::to_string(mTotal + 1 - mSearchQueue.size()) + "/" + std::to_string(mTotal);
-
-	mWndNotification->updateTitle(GUIICON + _("SCRAPING") + "... " + idx);
-	mWndNotification->updateText(gameName, _("Searching")+"...");
-	mWndNotification->updatePercent(-1);
+	job->searchHandle = startScraperSearch(job->search);
 
 	LOG(LogDebug) << "ThreadedScraper::search <<";
 }
@@ -66,121 +76,249 @@ void ThreadedScraper::processError(int status, const std::string statusString)
 		status == HttpReq::REQ_403_BADLOGIN || status == HttpReq::REQ_401_FORBIDDEN)
 	{
 		mExit = true;
-		mWindow->postToUiThread([statusString](Window* w) { w->pushGui(new GuiMsgBox(w, _("SCRAPE FAILED") + " : " + statusString)); });
+		mFatalError = statusString;
+
+		if (mWindow != nullptr)
+			mWindow->postToUiThread([statusString](Window* w) { w->pushGui(new GuiMsgBox(w, _("SCRAPE FAILED") + " : " + statusString)); });
 	}
 	else
 		mErrors.push_back(statusString);
 }
 
-void ThreadedScraper::run()
+void ThreadedScraper::updateThrottling()
 {
-	while (!mExit && !mSearchQueue.empty())
+	int count = getScraperThrottleCount();
+	if (count != mThrottleCount)
 	{
-		if (mPaused)
+		int maxPenalty = Math::max(getScraperMaxSearches(), getScraperMaxDownloads()) - 1;
+
+		mThrottleCount = count;
+		mThrottlePenalty = Math::min(mThrottlePenalty + 1, maxPenalty);
+		mThrottleTime = SDL_GetTicks();
+
+		LOG(LogInfo) << "ThreadedScraper : too many requests, concurrency lowered by " << mThrottlePenalty;
+	}
+	else if (mThrottlePenalty > 0 && SDL_GetTicks() - mThrottleTime > THROTTLE_RECOVERY_DELAY)
+	{
+		mThrottlePenalty--;
+		mThrottleTime = SDL_GetTicks();
+	}
+}
+
+// Returns true when the job moved to another step
+bool ThreadedScraper::updateJob(ScrapeJob* job, int& searches, int& downloads, int maxDownloads, int maxRequests)
+{
+	if (job->done)
+		return false;
+
+	if (job->searchHandle)
+	{
+		auto status = job->searchHandle->status();
+		if (status == ASYNC_IN_PROGRESS)
+			return false;
+
+		auto results = job->searchHandle->getResults();
+		auto statusString = job->searchHandle->getStatusString();
+		auto httpCode = job->searchHandle->getErrorCode();
+
+		LOG(LogDebug) << "ThreadedScraper::SearchResponse : " << httpCode << " " << statusString;
+
+		searches--;
+		job->searchHandle.reset();
+
+		if (status == ASYNC_DONE && results.size() > 0)
 		{
-			while (!mExit && mPaused)
-			{
-				std::this_thread::yield();
-				std::this_thread::sleep_for(std::chrono::milliseconds(500));
-			}
+			job->result = results[0];
+			job->hasResult = true;
+			job->waitingMedias = job->result.hadMedia();
 		}
-
-		if (mSearchHandle && mSearchHandle->status() != ASYNC_IN_PROGRESS)
+		else if (status == ASYNC_ERROR)
 		{
-			auto status = mSearchHandle->status();
-			auto results = mSearchHandle->getResults();
-			auto statusString = mSearchHandle->getStatusString();
-			auto httpCode = mSearchHandle->getErrorCode();
+			job->error = statusString;
+			processError(httpCode, statusString);
+		}
 
-			LOG(LogDebug) << "ThreadedScraper::SearchResponse : " << httpCode << " " << statusString;
+		job->done = !job->waitingMedias;
+		return true;
+	}
 
-			mSearchHandle.reset();
+	if (job->waitingMedias)
+	{
+		if (downloads >= maxDownloads || searches + downloads >= maxRequests)
+			return false;
 
-			if (status == ASYNC_DONE)
-			{
-				if (results.size() > 0)
-				{
-					if (results[0].hadMedia())
-						processMedias(results[0]);
-					else
-						acceptResult(results[0]);
-				}
-			}
-			else if (status == ASYNC_ERROR)
-				processError(httpCode, statusString);				
-		}
+		LOG(LogDebug) << "ThreadedScraper::processMedias " << formatGameName(job->search.game);
 
-		if (mMDResolveHandle && mMDResolveHandle->status() != ASYNC_IN_PROGRESS)
-		{
-			auto status = mMDResolveHandle->status();
-			auto result = mMDResolveHandle->getResult();
-			auto statusString = mMDResolveHandle->getStatusString();
-			auto httpCode = mMDResolveHandle->getErrorCode();
+		downloads++;
+		job->waitingMedias = false;
+		job->resolveHandle = resolveMetaDataAssets(job->result, job->search);
+		return true;
+	}
 
-			LOG(LogDebug) << "ThreadedScraper::ResolveResponse : " << statusString;
+	if (job->resolveHandle)
+	{
+		auto status = job->resolveHandle->status();
+		if (status == ASYNC_IN_PROGRESS)
+			return false;
 
-			mCurrentAction = "";
-			mMDResolveHandle.reset();
+		auto statusString = job->resolveHandle->getStatusString();
+		auto httpCode = job->resolveHandle->getErrorCode();
 
-			if (status == ASYNC_DONE)
-				acceptResult(result);
-			else if (status == ASYNC_ERROR)
-				processError(httpCode, statusString);
-		}
+		LOG(LogDebug) << "ThreadedScraper::ResolveResponse : " << statusString;
 
-		if (mMDResolveHandle && mMDResolveHandle->status() == ASYNC_IN_PROGRESS)
+		if (status == ASYNC_DONE)
+			job->result = job->resolveHandle->getResult();
+		else
 		{
-			std::string action = mMDResolveHandle->getCurrentItem();
-			if (action != mCurrentAction)
-			{
-				mCurrentAction = action;
-				mWndNotification->updateText(formatGameName(mLastSearch.game), _("Downloading") + " " + mCurrentAction);
-			}
-
-			mWndNotification->updatePercent(mMDResolveHandle->getPercent());
+			job->hasResult = false;
+			job->error = statusString;
+			processError(httpCode, statusString);
 		}
 
-		if (mSearchHandle == nullptr && mMDResolveHandle == nullptr)
-		{
-			mSearchQueue.pop();
+		downloads--;
+		job->resolveHandle.reset();
+		job->done = true;
+		return true;
+	}
 
-			if (mSearchQueue.empty())
-			{
-				LOG(LogDebug) << "ThreadedScraper::finished";
-				break;
-			}
-			
-			search(mSearchQueue.front());
+	return false;
+}
+
+void ThreadedScraper::updateNotification()
+{
+	if (mWndNotification == nullptr)
+		return;
+
+	std::string idx = std::to_string(Math::min(mCompleted + 1, mTotal)) + "/" + std::to_string(mTotal);
+	mWndNotification->updateTitle(GUIICON + _("SCRAPING") + "... " + idx);
+
+	// Show the oldest game still in the pipeline, it's the one holding the commits back
+	for (auto& job : mJobs)
+	{
+		if (job->done)
+			continue;
+
+		std::string action = _("Searching") + "...";
+		int percent = -1;
+
+		if (job->resolveHandle)
+		{
+			action = _("Downloading") + " " + job->resolveHandle->getCurrentItem();
+			percent = job->resolveHandle->getPercent();
 		}
-		else
+
+		if (action != mCurrentAction)
 		{
-			std::this_thread::yield();
-			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			mCurrentAction = action;
+			mWndNotification->updateText(formatGameName(job->search.game), action);
 		}
+
+		mWndNotification->updatePercent(percent);
+		break;
 	}
+}
+
+void ThreadedScraper::run()
+{
+	process();
+
+	LOG(LogDebug) << "ThreadedScraper::finished";
 	
 	if (!mExit)
 		mWindow->displayNotificationMessage(GUIICON + _("SCRAPING FINISHED. REFRESH UPDATE GAMES LISTS TO APPLY CHANGES."));
 
 	delete this;
-	ThreadedScraper::mInstance = nullptr;
 }
 
-void ThreadedScraper::processMedias(ScraperSearchResult result)
+void ThreadedScraper::process()
 {
-	LOG(LogDebug) << "ThreadedScraper::processMedias >>";
-	mMDResolveHandle = resolveMetaDataAssets(result, mLastSearch);
-	LOG(LogDebug) << "ThreadedScraper::processMedias <<";
+	while (!mExit && (!mSearchQueue.empty() || !mJobs.empty()))
+	{
+		if (mPaused)
+		{
+			while (!mExit && mPaused)
+			{
+				std::this_thread::yield();
+				std::this_thread::sleep_for(std::chrono::milliseconds(500));
+			}
+		}
+
+		updateThrottling();
+
+		int maxSearches = Math::max(1, getScraperMaxSearches() - mThrottlePenalty);
+		int maxDownloads = Math::max(1, getScraperMaxDownloads() - mThrottlePenalty);
+
+		// Searches and downloads share the connections allowed by the scraper
+		int maxRequests = Math::max(maxSearches, maxDownloads);
+
+		int searches = 0;
+		int downloads = 0;
+		for (auto& job : mJobs)
+		{
+			if (job->searchHandle)
+				searches++;
+			else if (job->resolveHandle)
+				downloads++;
+		}
+
+		// Searches and downloads of all the games in flight progress together, media downloads are started in queue order
+		bool changed = false;
+		for (auto& job : mJobs)
+			if (updateJob(job.get(), searches, downloads, maxDownloads, maxRequests))
+				changed = true;
+
+		if (mExit)
+			break;
+
+		// Commit finished games in queue order
+		while (!mJobs.empty() && mJobs.front()->done)
+		{
+			if (mJobs.front()->hasResult)
+				acceptResult(mJobs.front()->search, mJobs.front()->result);
+
+			if (mOnGameDone != nullptr)
+				mOnGameDone(mJobs.front()->search, mJobs.front()->hasResult, mJobs.front()->error);
+
+			mJobs.pop_front();
+			mCompleted++;
+			changed = true;
+		}
+
+		// Bound the window so that a slow game doesn't let finished results pile up behind it
+		while (!mSearchQueue.empty() && searches < maxSearches && searches + downloads < maxRequests && (int)mJobs.size() < maxSearches + maxDownloads)
+		{
+			ScrapeJob* job = new ScrapeJob(mSearchQueue.front());
+			mSearchQueue.pop();
+
+			mJobs.push_back(std::unique_ptr<ScrapeJob>(job));
+			search(job);
+
+			searches++;
+			changed = true;
+		}
+
+		updateNotification();
+
+		// Sleep until a transfer completes, the timeout keeps the progress and the retry delays going
+		if (!changed)
+			HttpReq::waitAny(50);
+	}
 }
 
-void ThreadedScraper::acceptResult(const ScraperSearchResult& result)
+void ThreadedScraper::acceptResult(const ScraperSearchParams& search, const ScraperSearchResult& result)
 {
 	LOG(LogDebug) << "ThreadedScraper::acceptResult >>";
 
-	ScraperSearchParams& search = mSearchQueue.front();
-
 	auto game = search.game;
 
+	// Batch mode : there's no UI thread to protect
+	if (mWindow == nullptr)
+	{
+		game->getMetadata().importScrappedMetadata(result.mdl);
+		saveToGamelistRecovery(game);
+		return;
+	}
+
 	mWindow->postToUiThread([game, result](Window* w)
 	{
 		LOG(LogDebug) << "ThreadedScraper::importScrappedMetadata";
@@ -199,6 +337,24 @@ void ThreadedScraper::start(Window* window, const std::queue<ScraperSearchParams
 		return;
 
 	ThreadedScraper::mInstance = new ThreadedScraper(window, searches);
+	ThreadedScraper::mInstance->mHandle = new std::thread(&ThreadedScraper::run, ThreadedScraper::mInstance);
+}
+
+bool ThreadedScraper::runBatch(const std::queue<ScraperSearchParams>& searches, const GameDoneFunc& onGameDone, std::string& error)
+{
+	if (ThreadedScraper::mInstance != nullptr)
+		return false;
+
+	ThreadedScraper scraper(nullptr, searches);
+	scraper.mOnGameDone = onGameDone;
+
+	// Lets stop() interrupt the batch
+	ThreadedScraper::mInstance = &scraper;
+	scraper.process();
+	ThreadedScraper::mInstance = nullptr;
+
+	error = scraper.mFatalError;
+	return !scraper.mExit;
 }
 
 void ThreadedScraper::stop()
@@ -214,3 +370,9 @@ void ThreadedScraper::stop()
 	catch (...) {}
 }
 
+void ThreadedScraper::waitForStop()
+{
+	std::unique_lock<std::mutex> lock(sInstanceLock);
+	sInstanceGone.wait(lock, [] { return ThreadedScraper::mInstance == nullptr; });
+}
+
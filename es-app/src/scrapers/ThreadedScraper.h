@@ -1,5 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <thread>
 #include "Scraper.h"
 #include "components/AsyncNotificationComponent.h"
@@ -9,39 +14,75 @@ class ThreadedScraper
 public:
 	static void start(Window* window, const std::queue<ScraperSearchParams>& searches);
 	static void stop();
+	// Waits for the scraper thread to be gone, after stop()
+	static void waitForStop();
 	static bool isRunning() { return mInstance != nullptr; }
-	
+
 	static void pause() { mPaused = true; }
 	static void resume() { mPaused = false; }
 
+	typedef std::function<void(const ScraperSearchParams& search, bool scraped, const std::string& error)> GameDoneFunc;
+
+	// Scrapes on the calling thread, without any UI. Results are written to the gamelist recovery files as they come,
+	// and onGameDone is called once for each game, in queue order.
+	// Returns false when stopped, or on a blocking error (quota, login...) described by error.
+	static bool runBatch(const std::queue<ScraperSearchParams>& searches, const GameDoneFunc& onGameDone, std::string& error);
+
 private:
 	ThreadedScraper(Window* window, const std::queue<ScraperSearchParams>& searches);
 	~ThreadedScraper();
 
-	Window* mWindow;
+	// A game going through the pipeline : search, then media downloads, then commit
+	struct ScrapeJob
+	{
+		ScrapeJob(const ScraperSearchParams& params) : search(params), waitingMedias(false), done(false), hasResult(false) { }
+
+		ScraperSearchParams search;
+		std::unique_ptr<ScraperSearchHandle> searchHandle;
+		std::unique_ptr<MDResolveHandle> resolveHandle;
+		ScraperSearchResult result;
+		std::string error;
+
+		bool waitingMedias;
+		bool done;
+		bool hasResult;
+	};
+
+	Window* mWindow; // nullptr in batch mode
 	AsyncNotificationComponent* mWndNotification;
 	std::string		mCurrentAction;
 
 	std::vector<std::string> mErrors;
 
 	void run();
+	void process();
 
 	std::thread* mHandle;
 	std::queue<ScraperSearchParams> mSearchQueue;
 
-	ScraperSearchParams mLastSearch;
-	std::unique_ptr<ScraperSearchHandle> mSearchHandle;
-	std::unique_ptr<MDResolveHandle> mMDResolveHandle;
+	// Jobs in flight, in queue order. Results are committed from the front only, so gamelists are updated in order
+	std::deque<std::unique_ptr<ScrapeJob>> mJobs;
 
-	void search(const ScraperSearchParams& params);
-	void processMedias(ScraperSearchResult result);
-	void acceptResult(const ScraperSearchResult& result);
+	void search(ScrapeJob* job);
+	bool updateJob(ScrapeJob* job, int& searches, int& downloads, int maxDownloads, int maxRequests);
+	void acceptResult(const ScraperSearchParams& search, const ScraperSearchResult& result);
 	void processError(int status, const std::string statusString);
+	void updateThrottling();
+	void updateNotification();
 
 	std::string formatGameName(FileData* game);
 
+	GameDoneFunc mOnGameDone;
+	std::string mFatalError;
+
 	int mTotal;
-	bool mExit;
+	int mCompleted;
+	std::atomic<bool> mExit; // set by stop(), from the UI thread or a signal handler
+
+	// Concurrency is lowered each time the server answers "too many requests", and slowly raised back
+	int mThrottleCount;
+	int mThrottlePenalty;
+	unsigned int mThrottleTime;
 
 	static bool mPaused;
 	static ThreadedScraper* mInstance;
@@ -391,22 +391,23 @@ std::shared_ptr<IGameListView> ViewController::getGameListView(SystemData* syste
 
 		if (system->getTheme()->getDefaultView() != "basic")
 		{
-			std::vector<FileData*> files = system->getRootFolder()->getFilesRecursive(GAME | FOLDER);
-			for (auto it = files.cbegin(); it != files.cend(); it++)
+			system->getRootFolder()->visitFiles(GAME | FOLDER, false, [&](FileData* file)
 			{
-				if (!allowDetailedDowngrade && themeHasVideoView && !(*it)->getVideoPath().empty())
+				if (!allowDetailedDowngrade && themeHasVideoView && !file->getVideoPath().empty())
 				{
 					selectedViewType = VIDEO;
-					break;
+					return false;
 				}
-				else if (!(*it)->getThumbnailPath().empty())
+				else if (!file->getThumbnailPath().empty())
 				{
 					selectedViewType = DETAILED;
 
 					if (!themeHasVideoView)
-						break;
+						return false;
 				}
-			}
+
+				return true;
+			});
 		}
 	}
 
@@ -1,5 +1,6 @@
 #include "views/gamelist/BasicGameListView.h"
 
+#include "components/VideoVlcComponent.h"
 #include "utils/FileSystemUtil.h"
 #include "views/UIModeController.h"
 #include "views/ViewController.h"
@@ -277,3 +278,23 @@ std::vector<FileData*> BasicGameListView::getFileDataEntries()
 {
 	return mList.getObjects();	
 }
+
+void BasicGameListView::prerollAdjacentVideos()
+{
+	int size = mList.size();
+	if (size < 2)
+		return;
+
+	int cursor = mList.getCursorIndex();
+
+	for (int offset : { 1, -1 })
+	{
+		FileData* file = mList.getObjectAt((cursor + offset + size) % size);
+		if (file == nullptr || file->getType() != GAME)
+			continue;
+
+		std::string video = file->getVideoPath();
+		if (!video.empty())
+			VideoVlcComponent::prerollVideo(video);
+	}
+}
@@ -40,6 +40,9 @@ protected:
 	virtual void remove(FileData* game, bool deleteFile) override;
 	virtual void addPlaceholder();
 
+	// Prepares the videos of the entries around the cursor, so that they start without delay when selected
+	void prerollAdjacentVideos();
+
 	TextListComponent<FileData*> mList;
 };
 
@@ -364,6 +364,9 @@ void DetailedGameListView::updateInfoPanel()
 			if (!mVideo->setVideo(file->getVideoPath()))
 				mVideo->setDefaultVideo();
 
+			if (mVideo->isKindOf<VideoVlcComponent>())
+				prerollAdjacentVideos();
+
 			std::string snapShot = imagePath;
 
 			auto src = mVideo->getSnapshotSource();
@@ -301,6 +301,9 @@ void VideoGameListView::updateInfoPanel()
 			mVideo->setDefaultVideo();
 		}
 		mVideoPlaying = true;
+
+		if (mVideo->isKindOf<VideoVlcComponent>())
+			prerollAdjacentVideos();
 		
 		std::string snapShot = file->getThumbnailPath();
 
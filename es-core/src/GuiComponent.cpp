@@ -3,7 +3,9 @@
 #include "animations/Animation.h"
 #include "animations/AnimationController.h"
 #include "renderers/Renderer.h"
+#include "resources/RenderTexture.h"
 #include "Log.h"
+#include "Settings.h"
 #include "ThemeData.h"
 #include "Window.h"
 #include <algorithm>
@@ -12,7 +14,8 @@
 GuiComponent::GuiComponent(Window* window) : mWindow(window), mParent(NULL), mOpacity(255),
 	mPosition(Vector3f::Zero()), mOrigin(Vector2f::Zero()), mRotationOrigin(0.5, 0.5),
 	mSize(Vector2f::Zero()), mTransform(Transform4x4f::Identity()), mIsProcessing(false), mVisible(true),
-	mStaticExtra(false)
+	mStaticExtra(false), mRenderCacheEnabled(false), mRenderCacheDirty(true), mRenderCacheTrans(Transform4x4f::Identity()),
+	mRenderCacheGeneration(0)
 {
 	for(unsigned char i = 0; i < MAX_ANIMATIONS; i++)
 		mAnimationMap[i] = NULL;
@@ -31,6 +34,9 @@ GuiComponent::~GuiComponent()
 		getChild(i)->setParent(NULL);
 }
 
+static unsigned int sRenderCacheGeneration = 0;
+static SettingValue<bool> sCachedLayers("CachedLayers");
+
 bool GuiComponent::input(InputConfig* config, Input input)
 {
 	for(unsigned int i = 0; i < getChildCount(); i++)
@@ -42,7 +48,8 @@ bool GuiComponent::input(InputConfig* config, Input input)
 void GuiComponent::updateSelf(int deltaTime)
 {
 	for(unsigned char i = 0; i < MAX_ANIMATIONS; i++)
-		advanceAnimation(i, deltaTime);
+		if (advanceAnimation(i, deltaTime))
+			invalidate();
 }
 
 void GuiComponent::updateChildren(int deltaTime)
@@ -73,7 +80,110 @@ void GuiComponent::render(const Transform4x4f& parentTrans)
 void GuiComponent::renderChildren(const Transform4x4f& transform) const
 {
 	for(unsigned int i = 0; i < getChildCount(); i++)
-		TRYCATCH("GuiComponent::renderChildren", getChild(i)->render(transform))		
+		TRYCATCH("GuiComponent::renderChildren", getChild(i)->renderCached(transform))		
+}
+
+static void growRenderBounds(GuiComponent* cmp, const Transform4x4f& trans, Vector2f& topLeft, Vector2f& bottomRight)
+{
+	if (!cmp->isVisible())
+		return;
+
+	const Vector2f size = cmp->getSize();
+	const Vector3f corners[4] = { trans * Vector3f::Zero(), trans * Vector3f(size.x(), 0, 0), trans * Vector3f(0, size.y(), 0), trans * Vector3f(size.x(), size.y(), 0) };
+
+	for (auto corner : corners)
+	{
+		topLeft = Vector2f(Math::min(topLeft.x(), corner.x()), Math::min(topLeft.y(), corner.y()));
+		bottomRight = Vector2f(Math::max(bottomRight.x(), corner.x()), Math::max(bottomRight.y(), corner.y()));
+	}
+
+	for (unsigned int i = 0; i < cmp->getChildCount(); i++)
+	{
+		GuiComponent* child = cmp->getChild(i);
+		growRenderBounds(child, trans * child->getTransform(), topLeft, bottomRight);
+	}
+}
+
+void GuiComponent::renderCached(const Transform4x4f& parentTrans)
+{
+	if (!mRenderCacheEnabled || !isVisible() || Renderer::getScreenRotate() != 0 || !sCachedLayers)
+	{
+		render(parentTrans);
+		return;
+	}
+
+	// Nested layers and clipped areas are drawn directly
+	if (Renderer::isRenderingToTarget() || Renderer::isClippingEnabled())
+	{
+		render(parentTrans);
+		return;
+	}
+
+	if (mRenderCache == nullptr)
+		mRenderCache = RenderTexture::get();
+
+	Transform4x4f trans = parentTrans * getTransform();
+
+	bool moved = !(trans.r0() == mRenderCacheTrans.r0() && trans.r1() == mRenderCacheTrans.r1() && trans.r2() == mRenderCacheTrans.r2() && trans.r3() == mRenderCacheTrans.r3());
+
+	// Only capture once the subtree stayed unchanged for a whole frame, animated content would be recaptured every frame otherwise
+	if (mRenderCacheDirty || moved || mRenderCacheGeneration != sRenderCacheGeneration)
+	{
+		mRenderCacheDirty = false;
+		mRenderCacheTrans = trans;
+		mRenderCacheGeneration = sRenderCacheGeneration;
+		mRenderCache->invalidate();
+
+		render(parentTrans);
+		return;
+	}
+
+	if (!mRenderCache->isValid())
+	{
+		Vector2f topLeft(trans.translation().x(), trans.translation().y());
+		Vector2f bottomRight = topLeft;
+		growRenderBounds(this, trans, topLeft, bottomRight);
+
+		const int x = Math::max(0, (int)Math::floorf(topLeft.x()));
+		const int y = Math::max(0, (int)Math::floorf(topLeft.y()));
+		const int w = Math::min(Renderer::getScreenWidth(), (int)Math::ceilf(bottomRight.x())) - x;
+		const int h = Math::min(Renderer::getScreenHeight(), (int)Math::ceilf(bottomRight.y())) - y;
+
+		if (w <= 0 || h <= 0 || !mRenderCache->beginCapture(Renderer::Rect(x, y, w, h)))
+		{
+			render(parentTrans);
+			return;
+		}
+
+		render(parentTrans);
+		mRenderCache->endCapture();
+	}
+
+	mRenderCache->render();
+}
+
+void GuiComponent::setRenderCaching(bool enabled)
+{
+	if (mRenderCacheEnabled == enabled)
+		return;
+
+	mRenderCacheEnabled = enabled;
+	mRenderCacheDirty = true;
+
+	if (!enabled)
+		mRenderCache = nullptr;
+}
+
+void GuiComponent::invalidate()
+{
+	for (GuiComponent* cmp = this; cmp != nullptr; cmp = cmp->mParent)
+		if (cmp->mRenderCacheEnabled)
+			cmp->mRenderCacheDirty = true;
+}
+
+void GuiComponent::invalidateAll()
+{
+	sRenderCacheGeneration++;
 }
 
 Vector3f GuiComponent::getPosition() const
@@ -83,6 +193,9 @@ Vector3f GuiComponent::getPosition() const
 
 void GuiComponent::setPosition(float x, float y, float z)
 {
+	if (mPosition.x() != x || mPosition.y() != y || mPosition.z() != z)
+		invalidate();
+
 	mPosition = Vector3f(x, y, z);
 	onPositionChanged();
 }
@@ -94,6 +207,9 @@ Vector2f GuiComponent::getOrigin() const
 
 void GuiComponent::setOrigin(float x, float y)
 {
+	if (mOrigin.x() != x || mOrigin.y() != y)
+		invalidate();
+
 	mOrigin = Vector2f(x, y);
 	onOriginChanged();
 }
@@ -105,6 +221,9 @@ Vector2f GuiComponent::getRotationOrigin() const
 
 void GuiComponent::setRotationOrigin(float x, float y)
 {
+	if (mRotationOrigin.x() != x || mRotationOrigin.y() != y)
+		invalidate();
+
 	mRotationOrigin = Vector2f(x, y);
 }
 
@@ -115,6 +234,9 @@ Vector2f GuiComponent::getSize() const
 
 void GuiComponent::setSize(float w, float h)
 {
+	if (mSize.x() != w || mSize.y() != h)
+		invalidate();
+
 	mSize = Vector2f(w, h);
     onSizeChanged();
 }
@@ -126,6 +248,9 @@ float GuiComponent::getRotation() const
 
 void GuiComponent::setRotation(float rotation)
 {
+	if (mRotation != rotation)
+		invalidate();
+
 	mRotation = rotation;
 }
 
@@ -136,6 +261,9 @@ float GuiComponent::getScale() const
 
 void GuiComponent::setScale(float scale)
 {
+	if (mScale != scale)
+		invalidate();
+
 	mScale = scale;
 }
 
@@ -165,6 +293,9 @@ bool GuiComponent::isVisible() const
 }
 void GuiComponent::setVisible(bool visible)
 {
+	if (mVisible != visible)
+		invalidate();
+
 	mVisible = visible;
 }
 
@@ -183,6 +314,7 @@ void GuiComponent::addChild(GuiComponent* cmp)
 		cmp->getParent()->removeChild(cmp);
 
 	cmp->setParent(this);
+	invalidate();
 }
 
 void GuiComponent::removeChild(GuiComponent* cmp)
@@ -202,6 +334,7 @@ void GuiComponent::removeChild(GuiComponent* cmp)
 		if(*i == cmp)
 		{
 			mChildren.erase(i);
+			invalidate();
 			return;
 		}
 	}
@@ -210,6 +343,7 @@ void GuiComponent::removeChild(GuiComponent* cmp)
 void GuiComponent::clearChildren()
 {
 	mChildren.clear();
+	invalidate();
 }
 
 void GuiComponent::sortChildren()
@@ -217,6 +351,8 @@ void GuiComponent::sortChildren()
 	std::stable_sort(mChildren.begin(), mChildren.end(),  [](GuiComponent* a, GuiComponent* b) {
 		return b->getZIndex() > a->getZIndex();
 	});
+
+	invalidate();
 }
 
 unsigned int GuiComponent::getChildCount() const
@@ -250,6 +386,8 @@ void GuiComponent::setOpacity(unsigned char opacity)
 		return;
 
 	mOpacity = opacity;
+	invalidate();
+
 	for(auto it = mChildren.cbegin(); it != mChildren.cend(); it++)
 	{
 		(*it)->setOpacity(opacity);
@@ -14,6 +14,7 @@ class Animation;
 class AnimationController;
 class Font;
 class InputConfig;
+class RenderTexture;
 class ThemeData;
 class Window;
 
@@ -54,6 +55,9 @@ public:
 	//4. Tell your children to render, based on your component's transform - renderChildren(t).
 	virtual void render(const Transform4x4f& parentTrans);
 
+	// Renders through the offscreen layer when render caching is enabled, otherwise calls render(parentTrans).
+	void renderCached(const Transform4x4f& parentTrans);
+
 	Vector3f getPosition() const;
 	inline void setPosition(const Vector3f& offset) { setPosition(offset.x(), offset.y(), offset.z()); }
 	void setPosition(float x, float y, float z = 0.0f);
@@ -164,6 +168,14 @@ public:
 	bool isStaticExtra() const { return mStaticExtra; }
 	void setIsStaticExtra(bool value) { mStaticExtra = value; }
 
+	// A render cached component keeps its subtree in an offscreen texture until something in it changes
+	bool isRenderCachingEnabled() const { return mRenderCacheEnabled; }
+	void setRenderCaching(bool enabled);
+
+	// Tells the render cached ancestors that this component must be drawn again
+	void invalidate();
+	static void invalidateAll();
+
 protected:
 	void renderChildren(const Transform4x4f& transform) const;
 	void updateSelf(int deltaTime); // updates animations
@@ -191,6 +203,12 @@ protected:
 
 	bool mStaticExtra;
 
+	bool mRenderCacheEnabled;
+	bool mRenderCacheDirty;
+	Transform4x4f mRenderCacheTrans;
+	unsigned int mRenderCacheGeneration;
+	std::shared_ptr<RenderTexture> mRenderCache;
+
 public:
 	const static unsigned char MAX_ANIMATIONS = 4;
 
@@ -14,12 +14,27 @@
 #include <unistd.h>
 #endif
 
+#include <condition_variable>
+#include <list>
 #include <mutex>
-static std::mutex mMutex;
 
-CURLM* HttpReq::s_multi_handle = curl_multi_init();
+#define MAX_HOST_CONNECTIONS	4
+#define MAX_TOTAL_CONNECTIONS	16
+
+// The multi handle is only driven by the I/O thread. Other threads hand their requests over through the pending lists
+static std::mutex				sLock;
+static std::condition_variable	sWorkEvent;		// new requests to start or stop
+static std::condition_variable	sDoneEvent;		// a request completed or was removed from the multi handle
+static std::list<HttpReq*>		sPendingAdds;
+static std::list<HttpReq*>		sPendingRemoves;
+static std::list<HttpReq*>		sActive;		// handles currently in the multi handle
+static std::thread*				sThread = nullptr;
+static bool						sExit = false;
+static int						sCompletedCount = 0;
+static std::atomic<unsigned long long> sDownloadedBytes(0);
+static std::atomic<bool>		sFileUrlsAllowed(false);
 
-std::map<CURL*, HttpReq*> HttpReq::s_requests;
+CURLM* HttpReq::s_multi_handle = curl_multi_init();
 
 std::string HttpReq::urlEncode(const std::string &s)
 {
@@ -92,8 +107,8 @@ std::string _regGetString(HKEY hKey, const std::string &strPath, const std::stri
 }
 #endif
 
-HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
-	: mStatus(REQ_IN_PROGRESS), mHandle(NULL)
+HttpReq::HttpReq(const std::string& url, const std::string outputFilename, const std::vector<std::string>& headers)
+	: mStatus(REQ_IN_PROGRESS), mStreamError(false), mHandle(NULL), mHeaders(nullptr), mInMulti(false)
 {
 	mUrl = url;
 	mFilePath = outputFilename;
@@ -104,8 +119,7 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 
 	if(mHandle == NULL)
 	{
-		mStatus = REQ_IO_ERROR;
-		onError("curl_easy_init failed");
+		onError(REQ_IO_ERROR, "curl_easy_init failed");
 		return;
 	}
 
@@ -113,8 +127,7 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 	CURLcode err = curl_easy_setopt(mHandle, CURLOPT_URL, url.c_str());
 	if(err != CURLE_OK)
 	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
+		onError(REQ_IO_ERROR, curl_easy_strerror(err));
 		return;
 	}
 
@@ -122,8 +135,7 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 	err = curl_easy_setopt(mHandle, CURLOPT_FOLLOWLOCATION, 1L);
 	if(err != CURLE_OK)
 	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
+		onError(REQ_IO_ERROR, curl_easy_strerror(err));
 		return;
 	}
 
@@ -131,8 +143,15 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 	err = curl_easy_setopt(mHandle, CURLOPT_MAXREDIRS, 2L);
 	if(err != CURLE_OK)
 	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
+		onError(REQ_IO_ERROR, curl_easy_strerror(err));
+		return;
+	}
+
+	//set curl restrict protocols : an url given by a scraper answer mustn't read local files
+	err = curl_easy_setopt(mHandle, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS | (sFileUrlsAllowed ? CURLPROTO_FILE : 0));
+	if(err != CURLE_OK)
+	{
+		onError(REQ_IO_ERROR, curl_easy_strerror(err));
 		return;
 	}
 
@@ -140,8 +159,7 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 	err = curl_easy_setopt(mHandle, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS); 
 	if(err != CURLE_OK)
 	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
+		onError(REQ_IO_ERROR, curl_easy_strerror(err));
 		return;
 	}
 
@@ -149,8 +167,7 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 	err = curl_easy_setopt(mHandle, CURLOPT_WRITEFUNCTION, &HttpReq::write_content);
 	if(err != CURLE_OK)
 	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
+		onError(REQ_IO_ERROR, curl_easy_strerror(err));
 		return;
 	}
 
@@ -158,8 +175,7 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 	err = curl_easy_setopt(mHandle, CURLOPT_WRITEDATA, this);
 	if(err != CURLE_OK)
 	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
+		onError(REQ_IO_ERROR, curl_easy_strerror(err));
 		return;
 	}
 
@@ -167,8 +183,7 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 	err = curl_easy_setopt(mHandle, CURLOPT_USERAGENT, "Mozilla/5.0 (Windows NT x.y; Win64; x64; rv:10.0) Gecko/20100101 Firefox/10.0");
 	if (err != CURLE_OK)
 	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
+		onError(REQ_IO_ERROR, curl_easy_strerror(err));
 		return;
 	}
 
@@ -201,7 +216,27 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 	}
 #endif
 	
-	std::unique_lock<std::mutex> lock(mMutex);
+	// Reuse connections : keep them alive and wait for a HTTP/2 connection to the same host rather than opening a new one
+	curl_easy_setopt(mHandle, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(mHandle, CURLOPT_NOSIGNAL, 1L);
+#if LIBCURL_VERSION_NUM >= 0x072B00
+	curl_easy_setopt(mHandle, CURLOPT_PIPEWAIT, 1L);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072F00
+	curl_easy_setopt(mHandle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+#endif
+
+	curl_easy_setopt(mHandle, CURLOPT_PRIVATE, this);
+
+	// Keep response headers, callers may need validators like ETag or Last-Modified
+	curl_easy_setopt(mHandle, CURLOPT_HEADERFUNCTION, &HttpReq::write_header);
+	curl_easy_setopt(mHandle, CURLOPT_HEADERDATA, this);
+
+	for (auto header : headers)
+		mHeaders = curl_slist_append(mHeaders, header.c_str());
+
+	if (mHeaders != nullptr)
+		curl_easy_setopt(mHandle, CURLOPT_HTTPHEADER, mHeaders);
 
 	if (!mFilePath.empty())
 	{
@@ -212,26 +247,23 @@ HttpReq::HttpReq(const std::string& url, const std::string outputFilename)
 		mStream.open(mTempStreamPath, std::ios_base::out | std::ios_base::binary);
 		if (!mStream.is_open())
 		{
-			mStatus = REQ_IO_ERROR;
-			onError("IO Error (disk is Readonly ?)");
+			onError(REQ_IO_ERROR, "IO Error (disk is Readonly ?)");
 			return;
 		}
 
 		Utils::FileSystem::removeFile(outputFilename);
 	}
 
-	//add the handle to our multi
-	CURLMcode merr = curl_multi_add_handle(s_multi_handle, mHandle);
-	if(merr != CURLM_OK)
+	if (!startThread())
 	{
 		closeStream();
-
-		mStatus = REQ_IO_ERROR;
-		onError(curl_multi_strerror(merr));
+		onError(REQ_IO_ERROR, "HttpReq is shut down");
 		return;
 	}
 
-	s_requests[mHandle] = this;
+	std::unique_lock<std::mutex> lock(sLock);
+	sPendingAdds.push_back(this);
+	wakeUp();
 }
 
 void HttpReq::closeStream()
@@ -248,112 +280,280 @@ void HttpReq::closeStream()
 
 HttpReq::~HttpReq()
 {
-	std::unique_lock<std::mutex> lock(mMutex);
+	if (mHandle)
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+
+		sPendingAdds.remove(this);
+
+		// Let the I/O thread detach the handle, no callback may run on this object afterwards
+		if (mInMulti)
+		{
+			sPendingRemoves.push_back(this);
+			wakeUp();
+
+			sDoneEvent.wait(lock, [this] { return !mInMulti; });
+		}
+	}
 
 	closeStream();
 	
 	if (!mTempStreamPath.empty())
 		Utils::FileSystem::removeFile(mTempStreamPath);
 
-	if(mHandle)
+	if (mHandle)
+		curl_easy_cleanup(mHandle);
+
+	if (mHeaders != nullptr)
+		curl_slist_free_all(mHeaders);
+}
+
+void HttpReq::wakeUp()
+{
+	sWorkEvent.notify_one();
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+	curl_multi_wakeup(s_multi_handle);
+#endif
+}
+
+bool HttpReq::startThread()
+{
+	std::unique_lock<std::mutex> lock(sLock);
+	if (sExit)
+		return false;
+
+	if (sThread != nullptr)
+		return true;
+
+#if LIBCURL_VERSION_NUM >= 0x071E00
+	curl_multi_setopt(s_multi_handle, CURLMOPT_MAX_HOST_CONNECTIONS, (long)MAX_HOST_CONNECTIONS);
+	curl_multi_setopt(s_multi_handle, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)MAX_TOTAL_CONNECTIONS);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072B00
+	curl_multi_setopt(s_multi_handle, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+#endif
+
+	// Runs until deinit()
+	sThread = new std::thread(&HttpReq::threadProc);
+	return true;
+}
+
+void HttpReq::deinit()
+{
+	std::thread* thread = nullptr;
+
 	{
-		s_requests.erase(mHandle);
+		std::unique_lock<std::mutex> lock(sLock);
+		sExit = true;
+		thread = sThread;
+		wakeUp();
+	}
 
-		CURLMcode merr = curl_multi_remove_handle(s_multi_handle, mHandle);
+	if (thread == nullptr)
+		return;
 
-		if(merr != CURLM_OK)
-			LOG(LogError) << "Error removing curl_easy handle from curl_multi: " << curl_multi_strerror(merr);
+	thread->join();
+	delete thread;
 
-		curl_easy_cleanup(mHandle);
+	std::unique_lock<std::mutex> lock(sLock);
+	sThread = nullptr;
+}
+
+// Called on the I/O thread with sLock held : fails every request that hasn't completed yet
+void HttpReq::cancelAll()
+{
+	for (auto req : sPendingRemoves)
+	{
+		curl_multi_remove_handle(s_multi_handle, req->mHandle);
+		req->mInMulti = false;
+		sActive.remove(req);
+	}
+
+	sPendingRemoves.clear();
+
+	for (auto req : sActive)
+	{
+		curl_multi_remove_handle(s_multi_handle, req->mHandle);
+		req->mInMulti = false;
+		req->closeStream();
+		req->onError(REQ_IO_ERROR, "Request cancelled");
+	}
+
+	sActive.clear();
+
+	for (auto req : sPendingAdds)
+	{
+		req->closeStream();
+		req->onError(REQ_IO_ERROR, "Request cancelled");
 	}
+
+	sPendingAdds.clear();
+
+	sCompletedCount++;
+	sDoneEvent.notify_all();
 }
 
-HttpReq::Status HttpReq::status()
+void HttpReq::threadProc()
 {
-	std::unique_lock<std::mutex> lock(mMutex);
+	int running = 0;
 
-	if (mStatus == REQ_IN_PROGRESS)
+	while (true)
 	{
-		int handle_count;
-		CURLMcode merr = curl_multi_perform(s_multi_handle, &handle_count);
-		if (merr != CURLM_OK && merr != CURLM_CALL_MULTI_PERFORM)
 		{
-			closeStream();
+			std::unique_lock<std::mutex> lock(sLock);
 
-			mStatus = REQ_IO_ERROR;
-			onError(curl_multi_strerror(merr));
-			return mStatus;
-		}
+			if (running == 0)
+				sWorkEvent.wait(lock, [] { return sExit || !sPendingAdds.empty() || !sPendingRemoves.empty(); });
 
-		int msgs_left;
-		CURLMsg* msg;
-		while ((msg = curl_multi_info_read(s_multi_handle, &msgs_left)) != nullptr)
-		{
-			if (msg->msg == CURLMSG_DONE)
+			if (sExit)
+			{
+				cancelAll();
+				return;
+			}
+
+			if (!sPendingRemoves.empty())
 			{
-				HttpReq* req = s_requests[msg->easy_handle];
-				if (req == NULL)
+				for (auto req : sPendingRemoves)
 				{
-					LOG(LogError) << "Cannot find easy handle!";
-					continue;
+					curl_multi_remove_handle(s_multi_handle, req->mHandle);
+					req->mInMulti = false;
+					sActive.remove(req);
 				}
 
-				req->closeStream();
+				sPendingRemoves.clear();
+				sDoneEvent.notify_all();
+			}
 
-				if (req->mStatus == REQ_FILESTREAM_ERROR)
+			bool completed = false;
+
+			for (auto req : sPendingAdds)
+			{
+				CURLMcode merr = curl_multi_add_handle(s_multi_handle, req->mHandle);
+				if (merr == CURLM_OK)
 				{
-					std::string err = "File stream error (disk full ?)";
-					req->onError(err.c_str());
+					req->mInMulti = true;
+					sActive.push_back(req);
+				}
+				else
+				{
+					req->closeStream();
+					req->onError(REQ_IO_ERROR, curl_multi_strerror(merr));
+
+					// wait() and waitAny() must see it like any other completion
+					completed = true;
 				}
-				else if (msg->data.result == CURLE_OK)
+			}
+
+			sPendingAdds.clear();
+
+			CURLMcode merr = curl_multi_perform(s_multi_handle, &running);
+			if (merr != CURLM_OK && merr != CURLM_CALL_MULTI_PERFORM)
+				LOG(LogError) << "HttpReq : curl_multi_perform failed : " << curl_multi_strerror(merr);
+
+			int msgs_left;
+			CURLMsg* msg;
+			while ((msg = curl_multi_info_read(s_multi_handle, &msgs_left)) != nullptr)
+			{
+				if (msg->msg != CURLMSG_DONE)
+					continue;
+
+				HttpReq* req = nullptr;
+				curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&req);
+				if (req == nullptr)
 				{
-					int http_status_code;
-					curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &http_status_code);
-
-					if (http_status_code < 200 || http_status_code > 299)
-					{
-						std::string err;
-
-						if (http_status_code >= 400 && http_status_code < 499)
-						{
-							if (mFilePath.empty())
-								err = req->getContent();
-
-							req->mStatus = (Status)http_status_code;
-						}
-						else
-							req->mStatus = REQ_IO_ERROR;
-
-						if (err.empty())
-							err = "HTTP status " + std::to_string(http_status_code);
-
-						req->onError(err.c_str());
-					}
-					else
-					{
-						if (!mFilePath.empty())
-						{
-							if (std::rename(mTempStreamPath.c_str(), mFilePath.c_str()) == 0)
-								req->mStatus = REQ_SUCCESS;
-							else
-							{
-								req->mStatus = REQ_IO_ERROR;
-								req->onError("file rename failed");
-							}
-						}
-						else
-							req->mStatus = REQ_SUCCESS;
-					}
+					LOG(LogError) << "Cannot find easy handle!";
+					continue;
 				}
+
+				CURLcode result = msg->data.result;
+
+				curl_multi_remove_handle(s_multi_handle, req->mHandle);
+				req->mInMulti = false;
+				sActive.remove(req);
+				req->onTransferDone(result);
+
+				completed = true;
+			}
+
+			if (completed)
+			{
+				sCompletedCount++;
+				sDoneEvent.notify_all();
+			}
+
+			if (running == 0)
+				continue;
+		}
+
+		// Sleep until some socket activity, a timeout, or a new request
+#if LIBCURL_VERSION_NUM >= 0x074200
+		curl_multi_poll(s_multi_handle, nullptr, 0, 1000, nullptr);
+#else
+		curl_multi_wait(s_multi_handle, nullptr, 0, 10, nullptr);
+#endif
+	}
+}
+
+// Called on the I/O thread, with the handle removed from the multi handle
+void HttpReq::onTransferDone(CURLcode result)
+{
+	closeStream();
+
+	if (mStreamError)
+		onError(REQ_FILESTREAM_ERROR, "File stream error (disk full ?)");
+	else if (result == CURLE_OK)
+	{
+		long http_status_code = 0;
+		curl_easy_getinfo(mHandle, CURLINFO_RESPONSE_CODE, &http_status_code);
+
+		// file:// and other protocols without status codes
+		if (http_status_code == 0)
+			http_status_code = 200;
+
+		if (http_status_code == 304)
+			mStatus = REQ_304_NOTMODIFIED;
+		else if (http_status_code < 200 || http_status_code > 299)
+		{
+			std::string err;
+			Status status = REQ_IO_ERROR;
+
+			if (http_status_code >= 400 && http_status_code < 499)
+			{
+				if (mFilePath.empty())
+					err = mContent.str();
+
+				status = (Status)http_status_code;
+			}
+
+			if (err.empty())
+				err = "HTTP status " + std::to_string(http_status_code);
+
+			onError(status, err.c_str());
+		}
+		else
+		{
+			if (!mFilePath.empty())
+			{
+				if (std::rename(mTempStreamPath.c_str(), mFilePath.c_str()) == 0)
+					mStatus = REQ_SUCCESS;
 				else
 				{
-					req->mStatus = REQ_IO_ERROR;
-					req->onError(curl_easy_strerror(msg->data.result));
+					onError(REQ_IO_ERROR, "file rename failed");
 				}
 			}
+			else
+				mStatus = REQ_SUCCESS;
 		}
 	}
+	else
+	{
+		onError(REQ_IO_ERROR, curl_easy_strerror(result));
+	}
+}
 
+HttpReq::Status HttpReq::status()
+{
 	return mStatus;
 }
 
@@ -387,10 +587,17 @@ std::string HttpReq::getContent()
 	return "";
 }
 
-void HttpReq::onError(const char* msg)
+void HttpReq::setFileUrlsAllowed(bool allowed)
+{
+	sFileUrlsAllowed = allowed;
+}
+
+// The message is set before the status : a thread seeing the final status can read it
+void HttpReq::onError(Status status, const char* msg)
 {
 	mErrorMsg = msg;
-	LOG(LogError) << "HttpReq::onError (" + std::to_string(mStatus) << ") : " + mErrorMsg;
+	LOG(LogError) << "HttpReq::onError (" + std::to_string(status) << ") : " + mErrorMsg;
+	mStatus = status;
 }
 
 std::string HttpReq::getErrorMsg()
@@ -404,6 +611,8 @@ std::string HttpReq::getErrorMsg()
 size_t HttpReq::write_content(void* buff, size_t size, size_t nmemb, void* req_ptr)
 {
 	HttpReq* request = ((HttpReq*)req_ptr);
+
+	sDownloadedBytes += size * nmemb;
 		
 	if (request->mFilePath.empty())
 	{
@@ -422,18 +631,16 @@ size_t HttpReq::write_content(void* buff, size_t size, size_t nmemb, void* req_p
 
 		if (ss.rdstate() != std::ofstream::goodbit)
 		{
-			request->closeStream();			
-			request->mStatus = REQ_FILESTREAM_ERROR;
-			request->mErrorMsg = "IO ERROR (DISK FULL?)";		
+			request->closeStream();
+			request->mStreamError = true;
 
 			return 0;
 		}
 	}
 	catch(...)
 	{
-		request->closeStream();		
-		request->mStatus = REQ_FILESTREAM_ERROR;
-		request->mErrorMsg = "IO ERROR (DISK FULL?)";
+		request->closeStream();
+		request->mStreamError = true;
 
 		return 0;
 	}
@@ -453,10 +660,55 @@ size_t HttpReq::write_content(void* buff, size_t size, size_t nmemb, void* req_p
 	return nmemb;
 }
 
+//used as a curl callback, called once per header line
+size_t HttpReq::write_header(char* buff, size_t size, size_t nmemb, void* req_ptr)
+{
+	HttpReq* request = ((HttpReq*)req_ptr);
+
+	std::string line(buff, size * nmemb);
+	while (!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+		line.pop_back();
+
+	// Each response of a redirect chain starts with its status line, keep the last one only
+	if (line.compare(0, 5, "HTTP/") == 0)
+		request->mResponseHeaders.clear();
+
+	auto pos = line.find(':');
+	if (pos != std::string::npos)
+	{
+		std::string name = Utils::String::toLower(Utils::String::trim(line.substr(0, pos)));
+		request->mResponseHeaders[name] = Utils::String::trim(line.substr(pos + 1));
+	}
+
+	return size * nmemb;
+}
+
+std::string HttpReq::getResponseHeader(const std::string& name)
+{
+	auto it = mResponseHeaders.find(Utils::String::toLower(name));
+	if (it != mResponseHeaders.cend())
+		return it->second;
+
+	return "";
+}
+
 bool HttpReq::wait()
 {
-	while (status() == HttpReq::REQ_IN_PROGRESS)
-		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	std::unique_lock<std::mutex> lock(sLock);
+	sDoneEvent.wait(lock, [this] { return mStatus != REQ_IN_PROGRESS; });
+
+	return mStatus == REQ_SUCCESS;
+}
+
+unsigned long long HttpReq::getDownloadedBytes()
+{
+	return sDownloadedBytes;
+}
+
+bool HttpReq::waitAny(int timeout)
+{
+	std::unique_lock<std::mutex> lock(sLock);
 
-	return status() == HttpReq::REQ_SUCCESS;
+	int count = sCompletedCount;
+	return sDoneEvent.wait_for(lock, std::chrono::milliseconds(timeout), [count] { return sCompletedCount != count; });
 }
\ No newline at end of file
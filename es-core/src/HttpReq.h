@@ -3,13 +3,15 @@
 #define ES_CORE_HTTP_REQ_H
 
 #include <curl/curl.h>
+#include <atomic>
 #include <map>
 #include <sstream>
+#include <vector>
 #include <fstream>
 
 /* Usage:
  * HttpReq myRequest("www.google.com", "/index.html");
- * //for blocking behavior: while(myRequest.status() == HttpReq::REQ_IN_PROGRESS);
+ * //for blocking behavior: myRequest.wait();
  * //for non-blocking behavior: check if(myRequest.status() != HttpReq::REQ_IN_PROGRESS) in some sort of update method
  * 
  * //once one of those completes, the request is ready
@@ -22,12 +24,18 @@
  *
  * std::string content = myRequest.getContent();
  * //process contents...
+ *
+ * Transfers run on a dedicated thread driving a shared curl multi handle : polling status() is cheap and
+ * doesn't make the transfer progress. Connections are kept alive and reused, HTTP/2 streams are multiplexed.
+ *
+ * Extra request headers ("Name: value") can be given, e.g. for conditional requests. A "304 Not Modified"
+ * answer is reported as REQ_304_NOTMODIFIED and isn't considered as an error.
 */
 
 class HttpReq
 {
 public:
-	HttpReq(const std::string& url, const std::string outputFilename = "");
+	HttpReq(const std::string& url, const std::string outputFilename = "", const std::vector<std::string>& headers = std::vector<std::string>());
 	~HttpReq();
 
 	enum Status
@@ -37,6 +45,7 @@ public:
 		REQ_FILESTREAM_ERROR = 4,		
 
 		REQ_SUCCESS = 200,
+		REQ_304_NOTMODIFIED = 304,
 		REQ_400_BADREQUEST = 400,
 		REQ_401_FORBIDDEN = 401,
 		REQ_403_BADLOGIN = 403,
@@ -50,7 +59,7 @@ public:
 		REQ_430_TOOMANYFAILURES = 431
 	};
 
-	Status status(); //process any received data and return the status afterwards
+	Status status(); // returns the current status, doesn't block
 
 	std::string getErrorMsg();
 
@@ -65,25 +74,47 @@ public:
 	int getPosition() { return mPosition; }
 
 	std::string getUrl() { return mUrl; }
-	bool wait();
+
+	// Value of a response header, name is case insensitive. Empty if the server didn't send it
+	std::string getResponseHeader(const std::string& name);
+
+	bool wait(); // blocks until the request is complete, returns true if it succeeded
+
+	// Blocks until any request completes, or the timeout (ms) expires. Returns true if a request completed
+	static bool waitAny(int timeout);
+
+	// Total of the bytes received by all the requests since startup
+	static unsigned long long getDownloadedBytes();
+
+	// Cancels the running requests and joins the I/O thread. No request can be started afterwards
+	static void deinit();
+
+	// file:// urls are refused unless allowed, for the canned answers of the Mock scraper
+	static void setFileUrlsAllowed(bool allowed);
 
 private:
 	void closeStream();
+	void onTransferDone(CURLcode result);
 
 	static size_t write_content(void* buff, size_t size, size_t nmemb, void* req_ptr);
+	static size_t write_header(char* buff, size_t size, size_t nmemb, void* req_ptr);
 	//static int update_progress(void* req_ptr, double dlTotal, double dlNow, double ulTotal, double ulNow);
 
-	//god dammit libcurl why can't you have some way to check the status of an individual handle
-	//why do I have to handle ALL messages at once
-	static std::map<CURL*, HttpReq*> s_requests;
+	static bool startThread();
+	static void threadProc();
+	static void wakeUp();
+	static void cancelAll();
 
 	static CURLM* s_multi_handle;
 
-	void onError(const char* msg);
+	void onError(Status status, const char* msg);
 
 	CURL* mHandle;
+	struct curl_slist* mHeaders;
 
-	Status mStatus;
+	std::atomic<Status> mStatus; // stored last, once the request is done with
+	bool mStreamError; // set by the write callback, on the I/O thread
+	bool mInMulti; // owned by the I/O thread while true
 
 	// string steam mode
 	std::stringstream mContent;
@@ -96,6 +127,8 @@ private:
 	std::string mErrorMsg;
 	std::string mUrl;
 
+	std::map<std::string, std::string> mResponseHeaders; // lower case names
+
 	int mPercent;
 	double mPosition;
 };
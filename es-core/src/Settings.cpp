@@ -37,7 +37,7 @@ std::vector<const char*> settings_dont_save {
 	{ "ScreenRotate" }
 };
 
-Settings::Settings()
+Settings::Settings() : mNextListenerId(0)
 {
 	setDefaults();
 	loadFile();
@@ -125,9 +125,17 @@ void Settings::setDefaults()
 	mStringMap["ScrapperThumbSrc"] = "box-2D";
 	mStringMap["ScrapperLogoSrc"] = "wheel";
 	mBoolMap["ScrapeVideos"] = false;
+	mIntMap["ScraperCacheDays"] = 30; // 0 disables the scraper answers cache
+	mIntMap["ScraperCacheMaxSize"] = 64; // Mb
+	mBoolMap["ScraperOptimizeImages"] = false;
+	mBoolMap["ScraperMediaStore"] = false; // hardlink identical medias
+	mStringMap["ScraperMockPath"] = ""; // canned answers of the "Mock" scraper
+	mIntMap["ScraperMockLatency"] = 0; // ms
+	mIntMap["ScraperMockErrorRate"] = 0; // %
 
 	mBoolMap["ScreenSaverMarquee"] = true;
 	mBoolMap["ScreenSaverControls"] = true;
+	mBoolMap["ScreenSaverShuffle"] = false;
 	mStringMap["ScreenSaverGameInfo"] = "never";
 	mBoolMap["StretchVideoOnScreenSaver"] = false;
 	mStringMap["PowerSaverMode"] = "default"; // batocera
@@ -198,6 +206,8 @@ void Settings::setDefaults()
 	mBoolMap["PreloadUI"] = false;
 	mBoolMap["OptimizeVRAM"] = true;
 	mBoolMap["OptimizeVideo"] = true;
+	mBoolMap["CachedLayers"] = true;
+	mBoolMap["VideoPreviews"] = false;
 
 	mBoolMap["ShowFilenames"] = false;
 	
@@ -348,12 +358,48 @@ bool Settings::setMethodName(const std::string& name, type value) \
 		if (std::find(settings_dont_save.cbegin(), settings_dont_save.cend(), name) == settings_dont_save.cend()) \
 			mWasChanged = true; \
 \
+		onChanged(name); \
 		return true; \
 	} \
 	return false; \
 }
 
+void Settings::onChanged(const std::string& name)
+{
+	if (mListeners.empty())
+		return;
+
+	// A listener may remove itself
+	std::map<int, ChangeListener> listeners = mListeners;
+	for (auto& listener : listeners)
+		listener.second(name);
+}
+
+int Settings::addChangeListener(const ChangeListener& listener)
+{
+	int id = mNextListenerId++;
+	mListeners[id] = listener;
+	return id;
+}
+
+void Settings::removeChangeListener(int id)
+{
+	mListeners.erase(id);
+}
+
 SETTINGS_GETSET(bool, mBoolMap, getBool, setBool, false);
 SETTINGS_GETSET(int, mIntMap, getInt, setInt, 0);
 SETTINGS_GETSET(float, mFloatMap, getFloat, setFloat, 0.0f);
 SETTINGS_GETSET(const std::string&, mStringMap, getString, setString, mEmptyString);
+
+// The maps are only cleared when the settings are created, the address of a value never changes afterwards
+#define SETTINGS_SLOT(type, mapName) const type* Settings::getSlot(const std::string& name, const type*) \
+{ \
+	auto it = mapName.find(name); \
+	return it == mapName.cend() ? nullptr : &it->second; \
+}
+
+SETTINGS_SLOT(bool, mBoolMap);
+SETTINGS_SLOT(int, mIntMap);
+SETTINGS_SLOT(float, mFloatMap);
+SETTINGS_SLOT(std::string, mStringMap);
@@ -2,7 +2,10 @@
 #ifndef ES_CORE_SETTINGS_H
 #define ES_CORE_SETTINGS_H
 
+#include <atomic>
+#include <functional>
 #include <map>
+#include <string>
 
 //This is a singleton for storing settings.
 class Settings
@@ -26,9 +29,25 @@ public:
 
 	std::map<std::string, std::string>& getStringMap() { return mStringMap; }
 
+	// Called on the main thread with the name of each setting whose value changes
+	typedef std::function<void(const std::string& name)> ChangeListener;
+	int addChangeListener(const ChangeListener& listener);
+	void removeChangeListener(int id);
+
+	// Address of the value of an existing setting, which stays valid : see SettingValue
+	const bool* getSlot(const std::string& name, const bool*);
+	const int* getSlot(const std::string& name, const int*);
+	const float* getSlot(const std::string& name, const float*);
+	const std::string* getSlot(const std::string& name, const std::string*);
+
 private:
 	static Settings* sInstance;
 
+	void onChanged(const std::string& name);
+
+	std::map<int, ChangeListener> mListeners;
+	int mNextListenerId;
+
 	Settings();
 
 	//Clear everything and load default values.
@@ -47,4 +66,39 @@ private:
 	std::map<std::string, std::string> mDefaultStringMap;
 };
 
+// Direct access to a setting, for the code reading it often : declared once (usually static) with the setting name, it
+// finds the value in the settings on first use and then reads it in place, without building a string or searching a map.
+// A setting which doesn't exist yet reads as the default value of its type, and is looked up again on the next call.
+template<typename T>
+class SettingValue
+{
+public:
+	SettingValue(const char* name) : mName(name), mSlot(nullptr) { }
+
+	const T& get()
+	{
+		const T* slot = mSlot.load(std::memory_order_acquire);
+		if (slot == nullptr)
+		{
+			slot = Settings::getInstance()->getSlot(mName, slot);
+			if (slot == nullptr)
+				return sDefault;
+
+			mSlot.store(slot, std::memory_order_release);
+		}
+
+		return *slot;
+	}
+
+	inline operator const T&() { return get(); }
+
+private:
+	std::string mName;
+	std::atomic<const T*> mSlot;
+
+	static const T sDefault;
+};
+
+template<typename T> const T SettingValue<T>::sDefault = T();
+
 #endif // ES_CORE_SETTINGS_H
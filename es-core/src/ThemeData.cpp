@@ -4,6 +4,7 @@
 #include "components/TextComponent.h"
 #include "components/NinePatchComponent.h"
 #include "components/VideoVlcComponent.h"
+#include "resources/ThemePack.h"
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
 #include "Log.h"
@@ -335,6 +336,16 @@ unsigned int getHexColor(const char* str)
 	return val;
 }
 
+// From the theme pack when there is one
+static pugi::xml_parse_result loadXmlFile(pugi::xml_document& doc, const std::string& path)
+{
+	ResourceData data = ThemePack::getFileData(path);
+	if (data.ptr == nullptr)
+		return doc.load_file(path.c_str());
+
+	return doc.load_buffer(data.ptr.get(), data.length);
+}
+
 std::string ThemeData::resolvePlaceholders(const char* in)
 {
 	if (in == nullptr || in[0] == 0)
@@ -404,8 +415,13 @@ void ThemeData::loadFile(const std::string system, std::map<std::string, std::st
 	mVariables.insert(sysDataMap.cbegin(), sysDataMap.cend());
 	mVariables["lang"] = mLanguage;
 
+	// <theme set>/<system>/theme.xml
+	std::string systemFolder = Utils::FileSystem::getParent(path);
+	if (!system.empty() && Utils::FileSystem::getFileName(systemFolder) == system)
+		ThemePack::open(Utils::FileSystem::getParent(systemFolder));
+
 	pugi::xml_document doc;
-	pugi::xml_parse_result res = doc.load_file(path.c_str());
+	pugi::xml_parse_result res = loadXmlFile(doc, path);
 	if(!res)
 		throw error << "XML parsing error: \n    " << res.description();
 
@@ -595,7 +611,7 @@ void ThemeData::parseInclude(const pugi::xml_node& node)
 	mPaths.push_back(path);
 
 	pugi::xml_document includeDoc;
-	pugi::xml_parse_result result = includeDoc.load_file(path.c_str());
+	pugi::xml_parse_result result = loadXmlFile(includeDoc, path);
 	if (!result)
 	{
 		LOG(LogWarning) << "Error parsing file: \n    " << result.description() << "    from included file \"" << relPath << "\":\n    ";
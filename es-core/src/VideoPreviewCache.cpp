@@ -0,0 +1,209 @@
+#include "VideoPreviewCache.h"
+
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "Log.h"
+#include "Settings.h"
+#include <vlc/vlc.h>
+#include <SDL_timer.h>
+#include <atomic>
+#include <cstdio>
+#include <list>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#define MAX_PENDING_PREVIEWS	16
+#define TRANSCODE_TIMEOUT		300000
+
+static std::mutex				sLock;
+static std::list<std::string>	sQueue;
+static std::set<std::string>	sFailed;
+static std::thread*				sThread = nullptr;
+static bool						sRunning = false;
+static std::atomic<bool>		sAbort(false);
+static libvlc_instance_t*		sVLC = nullptr;
+
+bool VideoPreviewCache::isEnabled()
+{
+	return Settings::getInstance()->getBool("VideoPreviews");
+}
+
+std::string VideoPreviewCache::getPreviewPath(const std::string& videoPath)
+{
+	return Utils::FileSystem::getParent(videoPath) + "/" + Utils::FileSystem::getStem(videoPath) + ".preview.mp4";
+}
+
+// Quoted value of a sout chain option
+static std::string quoteChainValue(const std::string& value)
+{
+	std::string quoted = "'";
+	for (auto c : value)
+	{
+		if (c == '\'' || c == '\\')
+			quoted += '\\';
+
+		quoted += c;
+	}
+
+	return quoted + "'";
+}
+
+static bool transcode(const std::string& videoPath, const std::string& previewPath)
+{
+	if (sVLC == nullptr)
+	{
+		const char* args[] = { "--quiet", "--no-video-title-show" };
+		sVLC = libvlc_new(2, args);
+
+		if (sVLC == nullptr)
+			return false;
+	}
+
+	std::string tmpPath = previewPath + ".tmp";
+
+#ifdef WIN32
+	libvlc_media_t* media = libvlc_media_new_path(sVLC, Utils::String::replace(videoPath, "/", "\\").c_str());
+#else
+	libvlc_media_t* media = libvlc_media_new_path(sVLC, videoPath.c_str());
+#endif
+	if (media == nullptr)
+		return false;
+
+	// No display in the chain : VLC runs as fast as the encoder allows
+	std::string sout = ":sout=#transcode{vcodec=h264,venc=x264{preset=ultrafast,profile=baseline},vb=600,"
+		"maxwidth=" + std::to_string(VideoPreviewCache::MAX_WIDTH) + ",maxheight=" + std::to_string(VideoPreviewCache::MAX_HEIGHT) + ","
+		"acodec=mp4a,ab=64,channels=2,samplerate=44100}:std{access=file,mux=mp4,dst=" + quoteChainValue(tmpPath) + "}";
+
+	libvlc_media_add_option(media, sout.c_str());
+
+	libvlc_media_player_t* player = libvlc_media_player_new_from_media(media);
+	libvlc_media_release(media);
+
+	if (player == nullptr)
+		return false;
+
+	libvlc_media_player_play(player);
+
+	int start = SDL_GetTicks();
+	libvlc_state_t state = libvlc_NothingSpecial;
+
+	while (!sAbort && (int)SDL_GetTicks() - start < TRANSCODE_TIMEOUT)
+	{
+		state = libvlc_media_player_get_state(player);
+		if (state == libvlc_Ended || state == libvlc_Error)
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	libvlc_media_player_stop(player);
+	libvlc_media_player_release(player);
+
+	if (state != libvlc_Ended || Utils::FileSystem::getFileSize(tmpPath) == 0)
+	{
+		Utils::FileSystem::removeFile(tmpPath);
+		return false;
+	}
+
+	Utils::FileSystem::removeFile(previewPath);
+	return std::rename(tmpPath.c_str(), previewPath.c_str()) == 0;
+}
+
+static void transcodeThreadProc()
+{
+	while (true)
+	{
+		std::string videoPath;
+
+		{
+			std::unique_lock<std::mutex> lock(sLock);
+			if (sQueue.empty() || sAbort)
+			{
+				sRunning = false;
+				return;
+			}
+
+			videoPath = sQueue.front();
+			sQueue.pop_front();
+		}
+
+		LOG(LogDebug) << "VideoPreviewCache : transcoding " << videoPath;
+
+		if (!transcode(videoPath, VideoPreviewCache::getPreviewPath(videoPath)) && !sAbort)
+		{
+			LOG(LogWarning) << "VideoPreviewCache : unable to create the preview of " << videoPath;
+
+			std::unique_lock<std::mutex> lock(sLock);
+			sFailed.insert(videoPath);
+		}
+	}
+}
+
+std::string VideoPreviewCache::getPreview(const std::string& videoPath)
+{
+	std::string previewPath = getPreviewPath(videoPath);
+
+	// The preview is valid as long as the video wasn't replaced after its creation
+	if (Utils::FileSystem::exists(previewPath) && Utils::FileSystem::getFileModificationDate(previewPath) >= Utils::FileSystem::getFileModificationDate(videoPath))
+		return previewPath;
+
+	std::unique_lock<std::mutex> lock(sLock);
+
+	if (sFailed.find(videoPath) != sFailed.cend())
+		return "";
+
+	for (auto& path : sQueue)
+		if (path == videoPath)
+			return "";
+
+	sQueue.push_back(videoPath);
+	while (sQueue.size() > MAX_PENDING_PREVIEWS)
+		sQueue.pop_front();
+
+	if (!sRunning)
+	{
+		if (sThread != nullptr)
+		{
+			sThread->join();
+			delete sThread;
+		}
+
+		sAbort = false;
+		sRunning = true;
+		sThread = new std::thread(transcodeThreadProc);
+	}
+
+	return "";
+}
+
+void VideoPreviewCache::deinit()
+{
+	stop();
+
+	if (sVLC != nullptr)
+	{
+		libvlc_release(sVLC);
+		sVLC = nullptr;
+	}
+}
+
+void VideoPreviewCache::stop()
+{
+	std::thread* thread = nullptr;
+
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+		sQueue.clear();
+		sAbort = true;
+
+		thread = sThread;
+		sThread = nullptr;
+	}
+
+	if (thread != nullptr)
+	{
+		thread->join();
+		delete thread;
+	}
+}
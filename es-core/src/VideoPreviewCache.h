@@ -0,0 +1,29 @@
+#pragma once
+#ifndef ES_CORE_VIDEO_PREVIEW_CACHE_H
+#define ES_CORE_VIDEO_PREVIEW_CACHE_H
+
+#include <string>
+
+// Downscaled, low bitrate copies of the videos, transcoded in the background and stored next to the originals.
+// Video components showing a small picture play them instead of decoding full resolution snaps.
+class VideoPreviewCache
+{
+public:
+	static const int MAX_WIDTH = 640;
+	static const int MAX_HEIGHT = 480;
+
+	static bool isEnabled();
+
+	// Returns the preview if it is newer than the video, queues its creation and returns an empty string otherwise
+	static std::string getPreview(const std::string& videoPath);
+
+	// Aborts the running transcoding (ex: before launching a game), pending videos are queued again on their next use
+	static void stop();
+
+	// stop, then releases the VLC instance used for transcoding
+	static void deinit();
+
+	static std::string getPreviewPath(const std::string& videoPath);
+};
+
+#endif // ES_CORE_VIDEO_PREVIEW_CACHE_H
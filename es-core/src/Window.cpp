@@ -22,6 +22,14 @@
 #include "components/BatteryIndicatorComponent.h"
 #include "guis/GuiMsgBox.h"
 #include "components/VolumeInfoComponent.h"
+#include "Settings.h"
+
+// Read every frame
+static SettingValue<bool> sDrawFramerate("DrawFramerate");
+static SettingValue<bool> sDrawClock("DrawClock");
+static SettingValue<bool> sShowControllerActivity("ShowControllerActivity");
+static SettingValue<bool> sVolumePopup("VolumePopup");
+static SettingValue<int> sScreenSaverTime("ScreenSaverTime");
 
 Window::Window() : mNormalizeNextUpdate(false), mFrameTimeElapsed(0), mFrameCountElapsed(0), mAverageDeltaTime(10),
   mAllowSleep(true), mSleeping(false), mTimeSinceLastInput(0), mScreenSaver(NULL), mRenderScreenSaver(false), mInfoPopup(NULL), mClockElapsed(0) // batocera
@@ -223,6 +231,8 @@ void Window::deinit()
 
 void Window::textInput(const char* text)
 {
+	GuiComponent::invalidateAll();
+
 	if(peekGui())
 		peekGui()->textInput(text);
 }
@@ -269,6 +279,9 @@ void Window::input(InputConfig* config, Input input)
 	if (cancelScreenSaver())
 		return;
 
+	// Any input may change what the cached layers show
+	GuiComponent::invalidateAll();
+
 	if (config->getDeviceId() == DEVICE_KEYBOARD && input.value && input.id == SDLK_g && SDL_GetModState() & KMOD_LCTRL) // && Settings::getInstance()->getBool("Debug"))
 	{
 		// toggle debug grid with Ctrl-G
@@ -378,7 +391,7 @@ void Window::update(int deltaTime)
 	{
 		mAverageDeltaTime = mFrameTimeElapsed / mFrameCountElapsed;
 
-		if (Settings::getInstance()->getBool("DrawFramerate"))
+		if (sDrawFramerate.get())
 		{
 			std::stringstream ss;
 
@@ -401,7 +414,7 @@ void Window::update(int deltaTime)
 	}
 
 	/* draw the clock */ // batocera
-	if (Settings::getInstance()->getBool("DrawClock") && mClock) 
+	if (sDrawClock.get() && mClock) 
 	{
 		mClockElapsed -= deltaTime;
 		if (mClockElapsed <= 0)
@@ -492,17 +505,17 @@ void Window::render()
 		if(!mRenderedHelpPrompts)
 			mHelp->render(transform);
 
-	if(Settings::getInstance()->getBool("DrawFramerate") && mFrameDataText)
+	if(sDrawFramerate.get() && mFrameDataText)
 	{
 		Renderer::setMatrix(Transform4x4f::Identity());
 		mDefaultFonts.at(1)->renderTextCache(mFrameDataText.get());
 	}
 
     // clock // batocera
-	if (Settings::getInstance()->getBool("DrawClock") && mClock && (mGuiStack.size() < 2 || !Renderer::isSmallScreen()))
+	if (sDrawClock.get() && mClock && (mGuiStack.size() < 2 || !Renderer::isSmallScreen()))
 		mClock->render(transform);
 	
-	if (Settings::getInstance()->getBool("ShowControllerActivity") && mControllerActivity != nullptr && (mGuiStack.size() < 2 || !Renderer::isSmallScreen()))
+	if (sShowControllerActivity.get() && mControllerActivity != nullptr && (mGuiStack.size() < 2 || !Renderer::isSmallScreen()))
 		mControllerActivity->render(transform);
 
 	if (mBatteryIndicator != nullptr && (mGuiStack.size() < 2 || !Renderer::isSmallScreen()))
@@ -510,7 +523,7 @@ void Window::render()
 
 	Renderer::setMatrix(Transform4x4f::Identity());
 
-	unsigned int screensaverTime = (unsigned int)Settings::getInstance()->getInt("ScreenSaverTime");
+	unsigned int screensaverTime = (unsigned int)sScreenSaverTime.get();
 	if(mTimeSinceLastInput >= screensaverTime && screensaverTime != 0)
 		startScreenSaver();
 
@@ -526,7 +539,7 @@ void Window::render()
 	for (auto extra : mScreenExtras)
 		extra->render(transform);
 
-	if (mVolumeInfo && Settings::getInstance()->getBool("VolumePopup"))
+	if (mVolumeInfo && sVolumePopup.get())
 		mVolumeInfo->render(transform);
 
 	if(mTimeSinceLastInput >= screensaverTime && screensaverTime != 0)
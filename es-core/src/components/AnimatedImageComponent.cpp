@@ -76,6 +76,7 @@ void AnimatedImageComponent::update(int deltaTime)
 		}
 
 		mFrameAccumulator -= mFrames.at(mCurrentFrame).second;
+		invalidate();
 	}
 }
 
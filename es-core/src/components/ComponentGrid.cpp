@@ -379,6 +379,8 @@ void ComponentGrid::textInput(const char* text)
 
 void ComponentGrid::onCursorMoved(Vector2i from, Vector2i to)
 {
+	invalidate();
+
 	const GridEntry* cell = getCellAt(from);
 	if(cell)
 		cell->component->onFocusLost();
@@ -132,6 +132,8 @@ void ComponentList::update(int deltaTime)
 
 void ComponentList::onCursorChanged(const CursorState& state)
 {
+	invalidate();
+
 	// update the selector bar position
 	// in the future this might be animated
 	mSelectorBarOffset = 0;
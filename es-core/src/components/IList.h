@@ -154,6 +154,11 @@ public:
 		return mEntries.at(mCursor).object;
 	}
 
+	inline const UserData& getObjectAt(int index) const
+	{
+		return mEntries.at(index).object;
+	}
+
 	void setCursor(typename std::vector<Entry>::const_iterator& it)
 	{
 		assert(it != mEntries.cend());
@@ -1,5 +1,6 @@
 #include "components/ImageComponent.h"
 
+#include "resources/AnimatedTexture.h"
 #include "resources/TextureResource.h"
 #include "Log.h"
 #include "Settings.h"
@@ -34,6 +35,7 @@ ImageComponent::ImageComponent(Window* window, bool forceLoad, bool dynamic) : G
 	mRoundCorners = 0.0f;
 	mShowing = false;
 	mPlaylistTimer = 0;
+	mAnimationRendered = false;
 	updateColors();
 }
 
@@ -160,6 +162,7 @@ void ImageComponent::setImage(std::string path, bool tile, MaxSizeInfo maxSize)
 	TextureResource::cancelAsync(mLoadingTexture);
 	TextureResource::cancelAsync(mTexture);
 	mLoadingTexture.reset();
+	mAnimation.reset();
 
 	if (mPath.empty() || !ResourceManager::getInstance()->fileExists(mPath))
 	{
@@ -168,6 +171,11 @@ void ImageComponent::setImage(std::string path, bool tile, MaxSizeInfo maxSize)
 		else
 			mTexture = TextureResource::get(mDefaultPath, tile, mLinear, mForceLoad, mDynamic, true, maxSize.empty() ? nullptr : &maxSize);
 	} 
+	else if (AnimatedTexture::isAnimation(mPath))
+	{
+		mAnimation = std::make_shared<AnimatedTexture>(mPath, mLinear, maxSize.empty() ? nullptr : &maxSize);
+		mTexture = mAnimation->getTexture();
+	}
 	else
 	{
 		std::shared_ptr<TextureResource> texture = TextureResource::get(mPath, tile, mLinear, mForceLoad, mDynamic, true, maxSize.empty() ? nullptr : &maxSize);
@@ -188,6 +196,7 @@ void ImageComponent::setImage(const char* path, size_t length, bool tile)
 
 	mTexture = TextureResource::get("", tile);
 	mTexture->initFromMemory(path, length);
+	mAnimation.reset();
 	
 	resize();
 }
@@ -195,6 +204,7 @@ void ImageComponent::setImage(const char* path, size_t length, bool tile)
 void ImageComponent::setImage(const std::shared_ptr<TextureResource>& texture)
 {
 	mTexture = texture;
+	mAnimation.reset();
 	resize();
 }
 
@@ -317,6 +327,8 @@ void ImageComponent::setOpacity(unsigned char opacity)
 
 void ImageComponent::updateVertices()
 {
+	invalidate();
+
 	if(!mTexture)
 		return;
 
@@ -361,6 +373,8 @@ void ImageComponent::updateVertices()
 
 void ImageComponent::updateColors()
 {
+	invalidate();
+
 	float opacity = (mOpacity * (mFading ? mFadeOpacity / 255.0 : 1.0)) / 255.0;
 
 	const unsigned int color = Renderer::convertColor(mColorShift & 0xFFFFFF00 | (unsigned char)((mColorShift & 0xFF) * opacity));
@@ -384,6 +398,8 @@ void ImageComponent::render(const Transform4x4f& parentTrans)
 		resize();
 		updateColors();
 	}
+	else if (mLoadingTexture != nullptr)
+		invalidate();
 
 	Transform4x4f trans = parentTrans * getTransform();
 	
@@ -391,6 +407,8 @@ void ImageComponent::render(const Transform4x4f& parentTrans)
 	if (mRotation == 0 && !Renderer::isVisibleOnScreen(trans.translation().x(), trans.translation().y(), mSize.x(), mSize.y()))
 		return;
 
+	mAnimationRendered = true;
+
 	Renderer::setMatrix(trans);
 
 	if(mTexture && mOpacity > 0)
@@ -410,6 +428,7 @@ void ImageComponent::render(const Transform4x4f& parentTrans)
 		if (!mTexture->bind())
 		{
 			fadeIn(false);
+			invalidate();
 			return;
 		}
 
@@ -747,6 +766,22 @@ void ImageComponent::update(int deltaTime)
 			mPlaylistTimer = 0.0;
 		}
 	}
+
+	// Hidden or off-screen animations are paused, their decoding stops once the frame ring is full
+	if (mAnimation != nullptr && (mAnimationRendered || !mAnimation->hasFrame()))
+	{
+		bool firstFrame = !mAnimation->hasFrame();
+
+		mAnimationRendered = false;
+
+		if (mAnimation->update(deltaTime))
+		{
+			if (firstFrame)
+				resize();
+
+			invalidate();
+		}
+	}
 }
 
 bool ImageComponent::isTiled()
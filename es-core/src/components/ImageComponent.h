@@ -8,6 +8,7 @@
 #include "ImageIO.h"
 #include "resources/Font.h"
 
+class AnimatedTexture;
 class TextureResource;
 class MaxSizeInfo;
 
@@ -162,6 +163,10 @@ private:
 	std::shared_ptr<TextureResource> mLoadingTexture;
 	Vector4f	mPadding;
 
+	// Animated images stream their frames into mTexture, they only advance after having been rendered on screen
+	std::shared_ptr<AnimatedTexture> mAnimation;
+	bool		mAnimationRendered;
+
 	Alignment mHorizontalAlignment;
 	Alignment mVerticalAlignment;
 
@@ -15,6 +15,9 @@ MenuComponent::MenuComponent(Window* window,
 {
 	mMaxHeight = 0;
 
+	// menus only change on input, keep them in an offscreen layer between changes
+	setRenderCaching(true);
+
 	auto theme = ThemeData::getMenuTheme();
 
 	addChild(&mBackground);
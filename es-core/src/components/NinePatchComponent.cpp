@@ -41,11 +41,15 @@ void NinePatchComponent::update(int deltaTime)
 		mTimer += deltaTime;
 		if (mTimer >= 2 * mAnimateTiming)
 			mTimer = 0;
+
+		invalidate();
 	}
 }
 
 void NinePatchComponent::updateColors()
 {
+	invalidate();
+
 	if (mVertices == nullptr)
 		return;
 
@@ -73,6 +77,8 @@ void NinePatchComponent::updateColors()
 
 void NinePatchComponent::buildVertices()
 {
+	invalidate();
+
 	if(mTexture == nullptr)
 		return;
 
@@ -67,6 +67,7 @@ void ScrollableContainer::update(int deltaTime)
 {
 	if(mAutoScrollSpeed != 0)
 	{
+		invalidate();
 		mAutoScrollAccumulator += deltaTime;
 
 		//scale speed by our width! more text per line = slower scrolling
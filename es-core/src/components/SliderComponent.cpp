@@ -109,6 +109,7 @@ void SliderComponent::setValue(float value)
 	else if(mValue > mMax)
 		mValue = mMax;
 
+	invalidate();
 	onValueChanged();
 
 	if (mValueChanged)
@@ -78,11 +78,17 @@ void TextComponent::setColor(unsigned int color)
 //  Set the color of the background box
 void TextComponent::setBackgroundColor(unsigned int color)
 {
+	if (mBgColor != color)
+		invalidate();
+
 	mBgColor = color;
 }
 
 void TextComponent::setRenderBackground(bool render)
 {
+	if (mRenderBackground != render)
+		invalidate();
+
 	mRenderBackground = render;
 }
 
@@ -301,6 +307,7 @@ void TextComponent::calculateExtent()
 
 void TextComponent::onTextChanged()
 {
+	invalidate();
 	calculateExtent();
 
 	if(!mFont || mText.empty())
@@ -391,6 +398,8 @@ void TextComponent::update(int deltaTime)
 
 			if (mMarqueeOffset > (scrollLength - (limit - returnLength)))
 				mMarqueeOffset2 = (int)(mMarqueeOffset - (scrollLength + returnLength));
+
+			invalidate();
 		}
 	}
 	else
@@ -403,6 +412,8 @@ void TextComponent::update(int deltaTime)
 
 void TextComponent::onColorChanged()
 {
+	invalidate();
+
 	if(mTextCache)
 	{
 		auto color = mColor & 0xFFFFFF00 | (unsigned char)((mColor & 0xFF) * (mOpacity / 255.0));
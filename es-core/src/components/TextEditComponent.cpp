@@ -185,6 +185,9 @@ void TextEditComponent::update(int deltaTime)
 	if (mBlinkTime >= BLINKTIME)
 		mBlinkTime = 0;
 
+	if (mFocused)
+		invalidate();
+
 	updateCursorRepeat(deltaTime);
 	GuiComponent::update(deltaTime);
 }
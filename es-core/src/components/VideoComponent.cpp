@@ -376,6 +376,8 @@ void VideoComponent::update(int deltaTime)
 
 	if (mIsPlaying)
 	{
+		invalidate();
+
 		// If the video start is delayed and there is less than the fade time then set the image fade
 		// accordingly
 
@@ -5,6 +5,7 @@
 #include "utils/StringUtil.h"
 #include "PowerSaver.h"
 #include "Settings.h"
+#include "VideoPreviewCache.h"
 #include <vlc/vlc.h>
 #include <SDL_mutex.h>
 #include <cmath>
@@ -12,6 +13,9 @@
 #include "ThemeData.h"
 #include <SDL_timer.h>
 #include "AudioManager.h"
+#include <condition_variable>
+#include <list>
+#include <thread>
 
 #ifdef WIN32
 #include <codecvt>
@@ -23,6 +27,339 @@
 
 libvlc_instance_t* VideoVlcComponent::mVLC = NULL;
 
+#define MAX_PREROLLED_MEDIAS	4
+#define MAX_IDLE_PLAYERS		2
+
+// A media opened and parsed ahead of time by VideoVlcComponent::prerollVideo
+struct PrerolledMedia
+{
+	std::string			path;
+	libvlc_media_t*		media;
+	unsigned int		width;
+	unsigned int		height;
+	bool				hasAudio;
+};
+
+static std::mutex					sPrerollLock;
+static std::list<std::string>		sPrerollQueue;
+static std::list<PrerolledMedia>	sPrerolledMedias; // Most recent first
+static std::thread*					sPrerollThread = nullptr;
+static bool							sPrerollRunning = false;
+
+// Stopped media players waiting to be reused, only accessed from the main thread
+static std::vector<libvlc_media_player_t*> sIdlePlayers;
+
+static std::string getMediaPath(const std::string& videoPath)
+{
+#ifdef WIN32
+	return Utils::String::replace(videoPath, "/", "\\");
+#else
+	return videoPath;
+#endif
+}
+
+// Get the media metadata so we can find the aspect ratio
+static void parseMediaTracks(libvlc_media_t* media, unsigned int& width, unsigned int& height, bool& hasAudio)
+{
+	width = 0;
+	height = 0;
+	hasAudio = false;
+
+	libvlc_media_parse(media);
+
+	libvlc_media_track_t** tracks;
+	unsigned track_count = libvlc_media_tracks_get(media, &tracks);
+	for (unsigned track = 0; track < track_count; ++track)
+	{
+		if (tracks[track]->i_type == libvlc_track_audio)
+			hasAudio = true;
+		else if (tracks[track]->i_type == libvlc_track_video)
+		{
+			width = tracks[track]->video->i_width;
+			height = tracks[track]->video->i_height;
+
+			if (hasAudio)
+				break;
+		}
+	}
+	libvlc_media_tracks_release(tracks, track_count);
+}
+
+static void prerollThreadProc(libvlc_instance_t* vlc)
+{
+	while (true)
+	{
+		std::string path;
+
+		{
+			std::unique_lock<std::mutex> lock(sPrerollLock);
+			if (sPrerollQueue.empty())
+			{
+				sPrerollRunning = false;
+				return;
+			}
+
+			path = sPrerollQueue.front();
+			sPrerollQueue.pop_front();
+		}
+
+		PrerolledMedia item;
+		item.path = path;
+		item.media = libvlc_media_new_path(vlc, getMediaPath(path).c_str());
+		if (item.media == nullptr)
+			continue;
+
+		parseMediaTracks(item.media, item.width, item.height, item.hasAudio);
+
+		std::unique_lock<std::mutex> lock(sPrerollLock);
+		sPrerolledMedias.push_front(item);
+
+		while (sPrerolledMedias.size() > MAX_PREROLLED_MEDIAS)
+		{
+			libvlc_media_release(sPrerolledMedias.back().media);
+			sPrerolledMedias.pop_back();
+		}
+	}
+}
+
+// Returns a prerolled media, the caller becomes its owner
+static bool takePrerolledMedia(const std::string& path, PrerolledMedia& item)
+{
+	std::unique_lock<std::mutex> lock(sPrerollLock);
+
+	for (auto it = sPrerolledMedias.begin(); it != sPrerolledMedias.end(); ++it)
+	{
+		if (it->path == path)
+		{
+			item = *it;
+			sPrerolledMedias.erase(it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static libvlc_media_player_t* acquireMediaPlayer(libvlc_media_t* media)
+{
+	if (sIdlePlayers.empty())
+		return libvlc_media_player_new_from_media(media);
+
+	libvlc_media_player_t* player = sIdlePlayers.back();
+	sIdlePlayers.pop_back();
+	libvlc_media_player_set_media(player, media);
+	return player;
+}
+
+static void releaseMediaPlayer(libvlc_media_player_t* player)
+{
+	libvlc_media_player_stop(player);
+
+	// The next user of the player sets its own context
+	libvlc_video_set_callbacks(player, nullptr, nullptr, nullptr, nullptr);
+
+	if (sIdlePlayers.size() < MAX_IDLE_PLAYERS)
+	{
+		libvlc_media_player_set_media(player, nullptr);
+		sIdlePlayers.push_back(player);
+	}
+	else
+		libvlc_media_player_release(player);
+}
+
+// Pixel buffers VLC decodes into directly, frames are uploaded to the texture without going through the CPU.
+// The mappings are lost with renderer deinit, VLC is then moved back to the context frames.
+class VideoPixelBuffers : public IReloadable
+{
+public:
+	static std::shared_ptr<VideoPixelBuffers> create(VideoContext* context, unsigned int size)
+	{
+		if (!Renderer::supportsPixelBuffers())
+			return nullptr;
+
+		std::shared_ptr<VideoPixelBuffers> buffers = std::shared_ptr<VideoPixelBuffers>(new VideoPixelBuffers(context, size));
+
+		for (int i = 0; i < 2; i++)
+		{
+			buffers->mIds[i] = Renderer::createPixelBuffer(size);
+
+			unsigned char* pixels = buffers->mIds[i] == 0 ? nullptr : (unsigned char*)Renderer::mapPixelBuffer(buffers->mIds[i], size);
+			if (pixels == nullptr)
+			{
+				buffers->release();
+				return nullptr;
+			}
+
+			context->surfaces[i] = pixels;
+		}
+
+		ResourceManager::getInstance()->addReloadable(buffers);
+		return buffers;
+	}
+
+	virtual ~VideoPixelBuffers() { release(); }
+
+	bool isValid() const { return mIds[0] != 0 && mIds[1] != 0; }
+
+	// The frame mutex must be held by the caller
+	bool upload(int frame, const std::shared_ptr<TextureResource>& texture, size_t width, size_t height)
+	{
+		if (!isValid() || !texture->initFromPixelBuffer(mIds[frame], width, height))
+			return false;
+
+		// Hand VLC a fresh mapping, the previous storage stays alive until the upload completes
+		unsigned char* pixels = (unsigned char*)Renderer::mapPixelBuffer(mIds[frame], mSize);
+		if (pixels == nullptr)
+		{
+			int other = frame ^ 1;
+
+			std::unique_lock<std::mutex> lock(mContext->mutexes[other]);
+			mContext->surfaces[frame] = mContext->frames[frame];
+			mContext->surfaces[other] = mContext->frames[other];
+			destroy();
+			return true;
+		}
+
+		mContext->surfaces[frame] = pixels;
+		return true;
+	}
+
+	void release()
+	{
+		std::unique_lock<std::mutex> lock0(mContext->mutexes[0]);
+		std::unique_lock<std::mutex> lock1(mContext->mutexes[1]);
+
+		mContext->surfaces[0] = mContext->frames[0];
+		mContext->surfaces[1] = mContext->frames[1];
+		destroy();
+	}
+
+	virtual bool unload() { release(); return false; }
+	virtual void reload() { }
+
+private:
+	VideoPixelBuffers(VideoContext* context, unsigned int size) : mContext(context), mSize(size) { mIds[0] = 0; mIds[1] = 0; }
+
+	void destroy()
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			if (mIds[i] != 0)
+				Renderer::destroyPixelBuffer(mIds[i]);
+
+			mIds[i] = 0;
+		}
+	}
+
+	VideoContext*	mContext;
+	unsigned int	mSize;
+	unsigned int	mIds[2];
+};
+
+static size_t getI420PlaneSize(unsigned int width, unsigned int height, int plane)
+{
+	return plane == 0 ? (size_t)width * height : (size_t)((width + 1) / 2) * ((height + 1) / 2);
+}
+
+static size_t getI420Size(unsigned int width, unsigned int height)
+{
+	return getI420PlaneSize(width, height, 0) + 2 * getI420PlaneSize(width, height, 1);
+}
+
+// Y, U and V planes of I420 frames, converted to RGB by the renderer when drawn : a frame is uploaded with 12 bits
+// per pixel instead of 32, and VLC doesn't convert it. The textures are lost with renderer deinit, until the next frame
+class VideoYuvTextures : public IReloadable
+{
+public:
+	static std::shared_ptr<VideoYuvTextures> create()
+	{
+		if (!Renderer::supportsYuvTextures())
+			return nullptr;
+
+		std::shared_ptr<VideoYuvTextures> textures = std::shared_ptr<VideoYuvTextures>(new VideoYuvTextures());
+		ResourceManager::getInstance()->addReloadable(textures);
+		return textures;
+	}
+
+	virtual ~VideoYuvTextures() { release(); }
+
+	bool isLoaded() const { return mPlanes[0] != 0; }
+
+	// The frame mutex must be held by the caller
+	void upload(unsigned char* frame, unsigned int width, unsigned int height)
+	{
+		if (width != mWidth || height != mHeight)
+			release();
+
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned int planeWidth = i == 0 ? width : (width + 1) / 2;
+			unsigned int planeHeight = i == 0 ? height : (height + 1) / 2;
+
+			if (mPlanes[i] == 0)
+				mPlanes[i] = Renderer::createTexture(Renderer::Texture::ALPHA, true, false, planeWidth, planeHeight, frame);
+			else
+				Renderer::updateTexture(mPlanes[i], Renderer::Texture::ALPHA, 0, 0, planeWidth, planeHeight, frame);
+
+			frame += getI420PlaneSize(width, height, i);
+		}
+
+		mWidth = width;
+		mHeight = height;
+	}
+
+	void render(const Renderer::Vertex* vertices, unsigned int count)
+	{
+		if (isLoaded())
+			Renderer::drawYuvTriangleStrips(vertices, count, mPlanes);
+	}
+
+	virtual bool unload() { release(); return false; }
+	virtual void reload() { }
+
+private:
+	VideoYuvTextures() : mWidth(0), mHeight(0) { mPlanes[0] = 0; mPlanes[1] = 0; mPlanes[2] = 0; }
+
+	void release()
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			if (mPlanes[i] != 0)
+				Renderer::destroyTexture(mPlanes[i]);
+
+			mPlanes[i] = 0;
+		}
+
+		mWidth = 0;
+		mHeight = 0;
+	}
+
+	unsigned int	mPlanes[3];
+	unsigned int	mWidth;
+	unsigned int	mHeight;
+};
+
+// VLC asks for the format of the frames : I420 at the size of the context
+static unsigned setupI420Format(void** opaque, char* chroma, unsigned* width, unsigned* height, unsigned* pitches, unsigned* lines)
+{
+	struct VideoContext *c = (struct VideoContext *)*opaque;
+
+	memcpy(chroma, "I420", 4);
+	*width = c->width;
+	*height = c->height;
+
+	pitches[0] = c->width;
+	lines[0] = c->height;
+
+	for (int i = 1; i < 3; i++)
+	{
+		pitches[i] = (c->width + 1) / 2;
+		lines[i] = (c->height + 1) / 2;
+	}
+
+	return 1;
+}
+
 // VLC prepares to render a video frame.
 static void *lock(void *data, void **p_pixels) 
 {
@@ -32,7 +369,14 @@ static void *lock(void *data, void **p_pixels)
 	
 	c->mutexes[frame].lock();
 	c->hasFrame[frame] = false;
-	*p_pixels = c->surfaces[frame];
+	p_pixels[0] = c->surfaces[frame];
+
+	if (c->yuv)
+	{
+		p_pixels[1] = c->surfaces[frame] + getI420PlaneSize(c->width, c->height, 0);
+		p_pixels[2] = (unsigned char*)p_pixels[1] + getI420PlaneSize(c->width, c->height, 1);
+	}
+
 	return NULL; // Picture identifier, not needed here.
 }
 
@@ -211,7 +555,7 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 	{
 		// If video is still attached to the path & texture is initialized, we suppose it had just been stopped (onhide, ondisable, screensaver...)
 		// still render the last frame
-		if (mTexture != nullptr && !mVideoPath.empty() && mPlayingVideoPath == mVideoPath && mTexture->isLoaded())
+		if (mTexture != nullptr && !mVideoPath.empty() && mPlayingVideoPath == mVideoPath && (mYuvTextures != nullptr ? mYuvTextures->isLoaded() : mTexture->isLoaded()))
 			initFromPixels = false;
 		else
 			return;
@@ -257,7 +601,12 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 #endif
 			{
 				mContext.mutexes[frame].lock();
-				mTexture->initFromExternalPixels(mContext.surfaces[frame], mVideoWidth, mVideoHeight);
+
+				if (mContext.yuv && mYuvTextures != nullptr)
+					mYuvTextures->upload(mContext.surfaces[frame], mVideoWidth, mVideoHeight);
+				else if (mContext.pixelBuffers == nullptr || !mContext.pixelBuffers->upload(frame, mTexture, mVideoWidth, mVideoHeight))
+					mTexture->initFromExternalPixels(mContext.surfaces[frame], mVideoWidth, mVideoHeight);
+
 				mContext.hasFrame[frame] = false;
 				mContext.mutexes[frame].unlock();
 
@@ -337,7 +686,9 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 	for(int i = 0; i < 4; ++i)
 		vertices[i].pos.round();
 	
-	if (mTexture->bind())
+	bool yuv = (mYuvTextures != nullptr && mYuvTextures->isLoaded());
+
+	if (yuv || mTexture->bind())
 	{
 		Vector2f targetSizePos = (mTargetSize - mSize) * mOrigin * -1;
 
@@ -366,11 +717,15 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 			float radius = Math::max(size_x, size_y) * mRoundCorners;
 			Renderer::enableRoundCornerStencil(x, y, size_x, size_y, radius);
 
-			mTexture->bind();
+			if (!yuv)
+				mTexture->bind();
 		}
 
 		// Render it
-		Renderer::drawTriangleStrips(&vertices[0], 4);
+		if (yuv)
+			mYuvTextures->render(&vertices[0], 4);
+		else
+			Renderer::drawTriangleStrips(&vertices[0], 4);
 
 		if (mRoundCorners > 0)
 			Renderer::disableStencil();
@@ -387,13 +742,28 @@ void VideoVlcComponent::setupContext()
 	if (mContext.valid)
 		return;
 	
-	// Create an RGBA surface to render the video into
-	mContext.surfaces[0] = new unsigned char[mVideoWidth * mVideoHeight * 4];
-	mContext.surfaces[1] = new unsigned char[mVideoWidth * mVideoHeight * 4];
+	// Let the renderer convert I420 frames when it can
+	if (mYuvTextures == nullptr)
+		mYuvTextures = VideoYuvTextures::create();
+
+	mContext.yuv = (mYuvTextures != nullptr);
+	mContext.width = mVideoWidth;
+	mContext.height = mVideoHeight;
+
+	// Create a surface to render the video into
+	size_t frameSize = mContext.yuv ? getI420Size(mVideoWidth, mVideoHeight) : (size_t)mVideoWidth * mVideoHeight * 4;
+	mContext.frames[0] = new unsigned char[frameSize]();
+	mContext.frames[1] = new unsigned char[frameSize]();
+	mContext.surfaces[0] = mContext.frames[0];
+	mContext.surfaces[1] = mContext.frames[1];
 	mContext.hasFrame[0] = false;	
 	mContext.hasFrame[1] = false;
 	mContext.component = this;
 	mContext.valid = true;	
+
+	// Otherwise let VLC decode straight into pixel buffers when the renderer supports them
+	if (!mContext.yuv)
+		mContext.pixelBuffers = VideoPixelBuffers::create(&mContext, mVideoWidth * mVideoHeight * 4);
 	resize();	
 }
 
@@ -406,14 +776,20 @@ void VideoVlcComponent::freeContext()
 	{
 		// Release texture memory -> except if mDisable by topWindow ( ex: menu was poped )
 		mTexture = nullptr;
+		mYuvTextures = nullptr;
 	}
 
-	delete[] mContext.surfaces[0];
-	delete[] mContext.surfaces[1];
+	mContext.pixelBuffers = nullptr;
+
+	delete[] mContext.frames[0];
+	delete[] mContext.frames[1];
+	mContext.frames[0] = nullptr;
+	mContext.frames[1] = nullptr;
 	mContext.surfaces[0] = nullptr;
 	mContext.surfaces[1] = nullptr;	
 	mContext.hasFrame[0] = false;
 	mContext.hasFrame[1] = false;
+	mContext.yuv = false;
 	mContext.component = NULL;
 	mContext.valid = false;			
 }
@@ -468,6 +844,69 @@ void VideoVlcComponent::setupVLC(std::string subtitles)
 	delete[] theArgs;
 }
 
+void VideoVlcComponent::prerollVideo(const std::string& path)
+{
+	if (mVLC == nullptr || path.empty())
+		return;
+
+	std::unique_lock<std::mutex> lock(sPrerollLock);
+
+	for (auto& item : sPrerolledMedias)
+		if (item.path == path)
+			return;
+
+	for (auto& item : sPrerollQueue)
+		if (item == path)
+			return;
+
+	// Only the latest requests matter, the list may have moved a lot since the older ones
+	sPrerollQueue.push_back(path);
+	while (sPrerollQueue.size() > MAX_PREROLLED_MEDIAS)
+		sPrerollQueue.pop_front();
+
+	if (sPrerollRunning)
+		return;
+
+	if (sPrerollThread != nullptr)
+	{
+		sPrerollThread->join();
+		delete sPrerollThread;
+	}
+
+	sPrerollRunning = true;
+	sPrerollThread = new std::thread(prerollThreadProc, mVLC);
+}
+
+void VideoVlcComponent::deinit()
+{
+	std::thread* thread = nullptr;
+
+	{
+		std::unique_lock<std::mutex> lock(sPrerollLock);
+		sPrerollQueue.clear();
+
+		thread = sPrerollThread;
+		sPrerollThread = nullptr;
+	}
+
+	// The thread ends once its current media is parsed
+	if (thread != nullptr)
+	{
+		thread->join();
+		delete thread;
+	}
+
+	for (auto& item : sPrerolledMedias)
+		libvlc_media_release(item.media);
+
+	sPrerolledMedias.clear();
+
+	for (auto player : sIdlePlayers)
+		libvlc_media_player_release(player);
+
+	sIdlePlayers.clear();
+}
+
 void VideoVlcComponent::handleLooping()
 {
 	if (mIsPlaying && mMediaPlayer)
@@ -534,19 +973,49 @@ void VideoVlcComponent::startVideo()
 	mVideoWidth = 0;
 	mVideoHeight = 0;
 
-#ifdef WIN32
-	std::string path(Utils::String::replace(mVideoPath, "/", "\\"));
-#else
-	std::string path(mVideoPath);
-#endif
+	std::string path(getMediaPath(mVideoPath));
+
+	// Small pictures don't need the full resolution video, play its downscaled preview when it's ready
+	bool usePreview = false;
+	if (VideoPreviewCache::isEnabled() && !mTargetSize.empty() && mTargetSize.x() <= VideoPreviewCache::MAX_WIDTH && mTargetSize.y() <= VideoPreviewCache::MAX_HEIGHT)
+	{
+		std::string preview = VideoPreviewCache::getPreview(mVideoPath);
+		if (!preview.empty())
+		{
+			path = getMediaPath(preview);
+			usePreview = true;
+		}
+	}
+
 	// Make sure we have a video path
 	if (mVLC && (path.size() > 0))
 	{
 		// Set the video that we are going to be playing so we don't attempt to restart it
 		mPlayingVideoPath = mVideoPath;
 
-		// Open the media
-		mMedia = libvlc_media_new_path(mVLC, path.c_str());
+		bool hasAudioTrack = false;
+
+		// Open the media, unless it has already been prerolled
+		PrerolledMedia prerolled;
+		if (!usePreview && takePrerolledMedia(mVideoPath, prerolled))
+		{
+			mMedia = prerolled.media;
+			mVideoWidth = prerolled.width;
+			mVideoHeight = prerolled.height;
+			hasAudioTrack = prerolled.hasAudio;
+		}
+		else
+		{
+			mMedia = libvlc_media_new_path(mVLC, path.c_str());
+			if (mMedia)
+			{
+				unsigned int width, height;
+				parseMediaTracks(mMedia, width, height, hasAudioTrack);
+				mVideoWidth = width;
+				mVideoHeight = height;
+			}
+		}
+
 		if (mMedia)
 		{			
 			// use : vlc long-help
@@ -565,28 +1034,6 @@ void VideoVlcComponent::startVideo()
 			if (mPlaylist != nullptr && mConfig.startDelay == 0 && !mConfig.showSnapshotDelay && !mConfig.showSnapshotNoVideo)
 				libvlc_media_add_option(mMedia, ":start-time=0.7");			
 
-			bool hasAudioTrack = false;
-
-			unsigned track_count;
-			// Get the media metadata so we can find the aspect ratio
-			libvlc_media_parse(mMedia);
-			libvlc_media_track_t** tracks;
-			track_count = libvlc_media_tracks_get(mMedia, &tracks);
-			for (unsigned track = 0; track < track_count; ++track)
-			{
-				if (tracks[track]->i_type == libvlc_track_audio)
-					hasAudioTrack = true;
-				else if (tracks[track]->i_type == libvlc_track_video)
-				{
-					mVideoWidth = tracks[track]->video->i_width;
-					mVideoHeight = tracks[track]->video->i_height;		
-
-					if (hasAudioTrack)
-						break;
-				}
-			}
-			libvlc_media_tracks_release(tracks, track_count);
-
 			// Make sure we found a valid video track
 			if ((mVideoWidth > 0) && (mVideoHeight > 0))
 			{			
@@ -618,20 +1065,30 @@ void VideoVlcComponent::startVideo()
 				PowerSaver::pause();
 				setupContext();
 
-				// Setup the media player
-				mMediaPlayer = libvlc_media_player_new_from_media(mMedia);
+				// Setup the media player, players are recycled as their creation is costly
+				mMediaPlayer = acquireMediaPlayer(mMedia);
 			
 				if (hasAudioTrack)
 				{
 					if (!Settings::getInstance()->getBool("VideoAudio"))
 						libvlc_audio_set_mute(mMediaPlayer, 1);
 					else
+					{
+						libvlc_audio_set_mute(mMediaPlayer, 0);
 						AudioManager::setVideoPlaying(true);
+					}
 				}
 
-				libvlc_media_player_play(mMediaPlayer);
+				// Before playing : a recycled player still knows the context and the size of its previous user
 				libvlc_video_set_callbacks(mMediaPlayer, lock, unlock, display, (void*)&mContext);
-				libvlc_video_set_format(mMediaPlayer, "RGBA", (int)mVideoWidth, (int)mVideoHeight, (int)mVideoWidth * 4);
+				if (mContext.yuv)
+					libvlc_video_set_format_callbacks(mMediaPlayer, setupI420Format, nullptr);
+				else
+				{
+					libvlc_video_set_format_callbacks(mMediaPlayer, nullptr, nullptr);
+					libvlc_video_set_format(mMediaPlayer, "RGBA", (int)mVideoWidth, (int)mVideoHeight, (int)mVideoWidth * 4);
+				}
+				libvlc_media_player_play(mMediaPlayer);
 				/*
 				if (true) // test wait video stream
 				{
@@ -676,8 +1133,7 @@ void VideoVlcComponent::stopVideo()
 	// Release the media player so it stops calling back to us
 	if (mMediaPlayer)
 	{
-		libvlc_media_player_stop(mMediaPlayer);
-		libvlc_media_player_release(mMediaPlayer);
+		releaseMediaPlayer(mMediaPlayer);
 		mMediaPlayer = NULL;
 	}
 
@@ -9,24 +9,38 @@ struct libvlc_instance_t;
 struct libvlc_media_t;
 struct libvlc_media_player_t;
 
+class VideoPixelBuffers;
+class VideoYuvTextures;
+
 struct VideoContext 
 {
 	VideoContext()
 	{
 		surfaces[0] = nullptr;
 		surfaces[1] = nullptr;
+		frames[0] = nullptr;
+		frames[1] = nullptr;
 		component = nullptr;
 		valid = false;
 		hasFrame[0] = false;
 		hasFrame[1] = false;
 		surfaceId = 0;
+		yuv = false;
+		width = 0;
+		height = 0;
 	}
 
 	int					surfaceId;
-	unsigned char*		surfaces[2];	
+	unsigned char*		surfaces[2];	// where VLC decodes : mapped pixel buffers when available, frames otherwise
+	unsigned char*		frames[2];
+	bool				yuv;			// I420 frames, planes one after another, instead of RGBA
+	unsigned int		width;
+	unsigned int		height;
 	std::mutex			mutexes[2];
 	bool				hasFrame[2];
 
+	std::shared_ptr<VideoPixelBuffers> pixelBuffers;
+
 	VideoComponent*		component;
 	bool				valid;	
 };
@@ -57,6 +71,12 @@ class VideoVlcComponent : public VideoComponent
 public:
 	static void setupVLC(std::string subtitles);
 
+	// Opens and parses a video in the background so that starting it later doesn't block on libvlc
+	static void prerollVideo(const std::string& path);
+
+	// Stops the preroll thread, releases the prerolled medias and the idle players
+	static void deinit();
+
 	VideoVlcComponent(Window* window, std::string subtitles="");
 	virtual ~VideoVlcComponent();
 
@@ -105,6 +125,7 @@ private:
 	libvlc_media_player_t*			mMediaPlayer;
 	VideoContext					mContext;
 	std::shared_ptr<TextureResource> mTexture;
+	std::shared_ptr<VideoYuvTextures> mYuvTextures; // replaces mTexture when the renderer converts YUV
 
 	std::string					    mSubtitlePath;
 	std::string					    mSubtitleTmpFile;
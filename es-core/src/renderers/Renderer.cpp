@@ -15,6 +15,19 @@ namespace Renderer
 	static std::stack<Rect> clipStack;
 	static std::stack<Rect> nativeClipStack;
 
+	struct RenderTarget
+	{
+		RenderTarget(const unsigned int _frameBuffer, const Rect& _area) : frameBuffer(_frameBuffer), area(_area) { }
+
+		unsigned int frameBuffer;
+		Rect         area;
+
+	}; // RenderTarget
+
+	static std::stack<RenderTarget> targetStack;
+	static Rect                     screenViewport   = Rect(0, 0, 0, 0);
+	static Transform4x4f            screenProjection = Transform4x4f::Identity();
+
 	static SDL_Window*      sdlWindow          = nullptr;
 	static int              windowWidth        = 0;
 	static int              windowHeight       = 0;
@@ -177,6 +190,9 @@ namespace Renderer
 			break;
 		}
 
+		screenViewport   = viewport;
+		screenProjection = projection;
+
 		setViewport(viewport);
 		setProjection(projection);
 		swapBuffers();
@@ -191,6 +207,71 @@ namespace Renderer
 
 	} // deinit
 
+	static Rect toTargetRect(const Rect& _box)
+	{
+		if(targetStack.empty())
+			return _box;
+
+		// setScissor works in window coordinates, move the box into the framebuffer space
+		const Rect& area = targetStack.top().area;
+		return Rect(_box.x - screenOffsetX - area.x, _box.y - screenOffsetY - area.y + windowHeight - area.h, _box.w, _box.h);
+
+	} // toTargetRect
+
+	static void applyRenderTarget()
+	{
+		if(targetStack.empty())
+		{
+			bindFrameBuffer(0);
+			setViewport(screenViewport);
+			setProjection(screenProjection);
+		}
+		else
+		{
+			const RenderTarget& target = targetStack.top();
+			Transform4x4f       projection = Transform4x4f::Identity();
+
+			projection.orthoProjection((float)target.area.x, (float)(target.area.x + target.area.w), (float)(target.area.y + target.area.h), (float)target.area.y, -1.0, 1.0);
+
+			bindFrameBuffer(target.frameBuffer);
+			setViewport(Rect(0, windowHeight - target.area.h, target.area.w, target.area.h));
+			setProjection(projection);
+		}
+
+		if(clipStack.empty()) setScissor(Rect(0, 0, 0, 0));
+		else                  setScissor(toTargetRect(clipStack.top()));
+
+	} // applyRenderTarget
+
+	bool pushRenderTarget(const unsigned int _frameBuffer, const Rect& _area)
+	{
+		// the screen projection is only replicated for unrotated displays
+		if(_frameBuffer == 0 || screenRotate != 0 || _area.w <= 0 || _area.h <= 0)
+			return false;
+
+		targetStack.push(RenderTarget(_frameBuffer, _area));
+		applyRenderTarget();
+		clearFrameBuffer();
+
+		return true;
+
+	} // pushRenderTarget
+
+	void popRenderTarget()
+	{
+		if(targetStack.empty())
+		{
+			LOG(LogError) << "Tried to popRenderTarget while the stack was empty!";
+			return;
+		}
+
+		targetStack.pop();
+		applyRenderTarget();
+
+	} // popRenderTarget
+
+	bool isRenderingToTarget() { return !targetStack.empty(); }
+
 	void pushClipRect(const Vector2i& _pos, const Vector2i& _size)
 	{
 		Rect box(_pos.x(), _pos.y(), _size.x(), _size.y());
@@ -222,7 +303,7 @@ namespace Renderer
 		clipStack.push(box);
 		nativeClipStack.push(Rect(_pos.x(), _pos.y(), _size.x(), _size.y()));
 
-		setScissor(box);
+		setScissor(toTargetRect(box));
 
 	} // pushClipRect
 
@@ -238,7 +319,7 @@ namespace Renderer
 		nativeClipStack.pop();
 
 		if(clipStack.empty()) setScissor(Rect(0, 0, 0, 0));
-		else                  setScissor(clipStack.top());
+		else                  setScissor(toTargetRect(clipStack.top()));
 
 	} // popClipRect
 
@@ -88,6 +88,18 @@ namespace Renderer
 	void         destroyTexture    (const unsigned int _texture);
 	void         updateTexture     (const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data);
 	void         bindTexture       (const unsigned int _texture);
+	bool         supportsFrameBuffers();
+	unsigned int createFrameBuffer (const unsigned int _texture);
+	void         destroyFrameBuffer(const unsigned int _frameBuffer);
+	void         bindFrameBuffer   (const unsigned int _frameBuffer);
+	void         clearFrameBuffer  ();
+	bool         supportsPixelBuffers();
+	unsigned int createPixelBuffer (const unsigned int _size);
+	void         destroyPixelBuffer(const unsigned int _pixelBuffer);
+	void*        mapPixelBuffer    (const unsigned int _pixelBuffer, const unsigned int _size);
+	void         updateTextureFromPixelBuffer(const unsigned int _texture, const unsigned int _pixelBuffer, const Texture::Type _type, const unsigned int _width, const unsigned int _height);
+	bool         supportsYuvTextures();
+	void         drawYuvTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const unsigned int* _planes); // Y, U and V ALPHA textures
 	void         drawLines         (const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA);
 	void         drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA);
 	void         setProjection     (const Transform4x4f& _projection);
@@ -103,6 +115,11 @@ namespace Renderer
 	bool         isSmallScreen      ();
 	unsigned int mixColors(unsigned int first, unsigned int second, float percent);
 
+	// Redirects rendering into a framebuffer. _area is the screen rectangle mapped onto the framebuffer texture
+	bool         pushRenderTarget   (const unsigned int _frameBuffer, const Rect& _area);
+	void         popRenderTarget    ();
+	bool         isRenderingToTarget();
+
 
 	void drawRoundRect(float x, float y, float w, float h, float radius, unsigned int color, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA);
 
@@ -13,6 +13,66 @@ namespace Renderer
 {
 	static SDL_GLContext sdlContext = nullptr;
 
+	static PFNGLGENFRAMEBUFFERSEXTPROC        glGenFramebuffersEXTPtr        = nullptr;
+	static PFNGLDELETEFRAMEBUFFERSEXTPROC     glDeleteFramebuffersEXTPtr     = nullptr;
+	static PFNGLBINDFRAMEBUFFEREXTPROC        glBindFramebufferEXTPtr        = nullptr;
+	static PFNGLFRAMEBUFFERTEXTURE2DEXTPROC   glFramebufferTexture2DEXTPtr   = nullptr;
+	static PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC glCheckFramebufferStatusEXTPtr = nullptr;
+	static PFNGLBLENDFUNCSEPARATEPROC         glBlendFuncSeparatePtr         = nullptr;
+
+	static bool frameBufferBound = false;
+
+	static PFNGLGENBUFFERSPROC                glGenBuffersPtr                = nullptr;
+	static PFNGLDELETEBUFFERSPROC             glDeleteBuffersPtr             = nullptr;
+	static PFNGLBINDBUFFERPROC                glBindBufferPtr                = nullptr;
+	static PFNGLBUFFERDATAPROC                glBufferDataPtr                = nullptr;
+	static PFNGLMAPBUFFERPROC                 glMapBufferPtr                 = nullptr;
+	static PFNGLUNMAPBUFFERPROC               glUnmapBufferPtr               = nullptr;
+
+	static PFNGLCREATESHADERPROC              glCreateShaderPtr              = nullptr;
+	static PFNGLSHADERSOURCEPROC              glShaderSourcePtr              = nullptr;
+	static PFNGLCOMPILESHADERPROC             glCompileShaderPtr             = nullptr;
+	static PFNGLGETSHADERIVPROC               glGetShaderivPtr               = nullptr;
+	static PFNGLDELETESHADERPROC              glDeleteShaderPtr              = nullptr;
+	static PFNGLCREATEPROGRAMPROC             glCreateProgramPtr             = nullptr;
+	static PFNGLATTACHSHADERPROC              glAttachShaderPtr              = nullptr;
+	static PFNGLLINKPROGRAMPROC               glLinkProgramPtr               = nullptr;
+	static PFNGLGETPROGRAMIVPROC              glGetProgramivPtr              = nullptr;
+	static PFNGLDELETEPROGRAMPROC             glDeleteProgramPtr             = nullptr;
+	static PFNGLUSEPROGRAMPROC                glUseProgramPtr                = nullptr;
+	static PFNGLGETUNIFORMLOCATIONPROC        glGetUniformLocationPtr        = nullptr;
+	static PFNGLUNIFORM1IPROC                 glUniform1iPtr                 = nullptr;
+	static PFNGLACTIVETEXTUREPROC             glActiveTexturePtr             = nullptr;
+
+	static unsigned int yuvProgram = 0;
+
+	// Video frames are drawn from their I420 planes, converted to RGB with the BT.601 limited range matrix
+	static const char* yuvVertexShader =
+		"#version 110\n"
+		"varying vec2 texCoord;\n"
+		"varying vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"	texCoord = gl_MultiTexCoord0.xy;\n"
+		"	color = gl_Color;\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+		"}\n";
+
+	static const char* yuvFragmentShader =
+		"#version 110\n"
+		"uniform sampler2D yPlane;\n"
+		"uniform sampler2D uPlane;\n"
+		"uniform sampler2D vPlane;\n"
+		"varying vec2 texCoord;\n"
+		"varying vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"	float y = 1.164 * (texture2D(yPlane, texCoord).a - 0.0625);\n"
+		"	float u = texture2D(uPlane, texCoord).a - 0.5;\n"
+		"	float v = texture2D(vPlane, texCoord).a - 0.5;\n"
+		"	gl_FragColor = vec4(y + 1.596 * v, y - 0.392 * u - 0.813 * v, y + 2.017 * u, 1.0) * color;\n"
+		"}\n";
+
 	static GLenum convertBlendFactor(const Blend::Factor _blendFactor)
 	{
 		switch(_blendFactor)
@@ -32,6 +92,80 @@ namespace Renderer
 
 	} // convertBlendFactor
 
+	static void setBlendFunc(const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		// Layers are captured with premultiplied alpha, so the alpha channel accumulates coverage like the screen does
+		if(frameBufferBound)
+			glBlendFuncSeparatePtr(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor), GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		else
+			glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+
+	} // setBlendFunc
+
+	static unsigned int compileShader(const GLenum _type, const char* _source)
+	{
+		unsigned int shader = glCreateShaderPtr(_type);
+		glShaderSourcePtr(shader, 1, &_source, nullptr);
+		glCompileShaderPtr(shader);
+
+		GLint compiled = GL_FALSE;
+		glGetShaderivPtr(shader, GL_COMPILE_STATUS, &compiled);
+		if(compiled != GL_TRUE)
+		{
+			glDeleteShaderPtr(shader);
+			return 0;
+		}
+
+		return shader;
+
+	} // compileShader
+
+	static unsigned int createYuvProgram()
+	{
+		if(glCreateShaderPtr == nullptr || glShaderSourcePtr == nullptr || glCompileShaderPtr == nullptr || glGetShaderivPtr == nullptr ||
+			glDeleteShaderPtr == nullptr || glCreateProgramPtr == nullptr || glAttachShaderPtr == nullptr || glLinkProgramPtr == nullptr ||
+			glGetProgramivPtr == nullptr || glDeleteProgramPtr == nullptr || glUseProgramPtr == nullptr || glGetUniformLocationPtr == nullptr ||
+			glUniform1iPtr == nullptr || glActiveTexturePtr == nullptr)
+			return 0;
+
+		unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, yuvVertexShader);
+		unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, yuvFragmentShader);
+
+		unsigned int program = 0;
+
+		if(vertexShader != 0 && fragmentShader != 0)
+		{
+			program = glCreateProgramPtr();
+			glAttachShaderPtr(program, vertexShader);
+			glAttachShaderPtr(program, fragmentShader);
+			glLinkProgramPtr(program);
+
+			GLint linked = GL_FALSE;
+			glGetProgramivPtr(program, GL_LINK_STATUS, &linked);
+			if(linked != GL_TRUE)
+			{
+				glDeleteProgramPtr(program);
+				program = 0;
+			}
+		}
+
+		// the program keeps them alive
+		if(vertexShader != 0)   glDeleteShaderPtr(vertexShader);
+		if(fragmentShader != 0) glDeleteShaderPtr(fragmentShader);
+
+		if(program != 0)
+		{
+			glUseProgramPtr(program);
+			glUniform1iPtr(glGetUniformLocationPtr(program, "yPlane"), 0);
+			glUniform1iPtr(glGetUniformLocationPtr(program, "uPlane"), 1);
+			glUniform1iPtr(glGetUniformLocationPtr(program, "vPlane"), 2);
+			glUseProgramPtr(0);
+		}
+
+		return program;
+
+	} // createYuvProgram
+
 	static GLenum convertTextureType(const Texture::Type _type)
 	{
 		switch(_type)
@@ -90,10 +224,89 @@ namespace Renderer
 		LOG(LogInfo) << "Checking available OpenGL extensions...";
 		LOG(LogInfo) << " ARB_texture_non_power_of_two: " << (glExts.find("ARB_texture_non_power_of_two") != std::string::npos ? "ok" : "MISSING");
 
+		if(glExts.find("GL_EXT_framebuffer_object") != std::string::npos)
+		{
+			glGenFramebuffersEXTPtr        = (PFNGLGENFRAMEBUFFERSEXTPROC)SDL_GL_GetProcAddress("glGenFramebuffersEXT");
+			glDeleteFramebuffersEXTPtr     = (PFNGLDELETEFRAMEBUFFERSEXTPROC)SDL_GL_GetProcAddress("glDeleteFramebuffersEXT");
+			glBindFramebufferEXTPtr        = (PFNGLBINDFRAMEBUFFEREXTPROC)SDL_GL_GetProcAddress("glBindFramebufferEXT");
+			glFramebufferTexture2DEXTPtr   = (PFNGLFRAMEBUFFERTEXTURE2DEXTPROC)SDL_GL_GetProcAddress("glFramebufferTexture2DEXT");
+			glCheckFramebufferStatusEXTPtr = (PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC)SDL_GL_GetProcAddress("glCheckFramebufferStatusEXT");
+		}
+
+		// Core since OpenGL 1.4
+		glBlendFuncSeparatePtr = (PFNGLBLENDFUNCSEPARATEPROC)SDL_GL_GetProcAddress("glBlendFuncSeparate");
+
+		LOG(LogInfo) << " EXT_framebuffer_object: " << (supportsFrameBuffers() ? "ok" : "MISSING");
+
+		if(glExts.find("GL_ARB_pixel_buffer_object") != std::string::npos)
+		{
+			glGenBuffersPtr    = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
+			glDeleteBuffersPtr = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress("glDeleteBuffers");
+			glBindBufferPtr    = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
+			glBufferDataPtr    = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+			glMapBufferPtr     = (PFNGLMAPBUFFERPROC)SDL_GL_GetProcAddress("glMapBuffer");
+			glUnmapBufferPtr   = (PFNGLUNMAPBUFFERPROC)SDL_GL_GetProcAddress("glUnmapBuffer");
+		}
+
+		LOG(LogInfo) << " ARB_pixel_buffer_object: " << (supportsPixelBuffers() ? "ok" : "MISSING");
+
+		// Core since OpenGL 2.0
+		glCreateShaderPtr       = (PFNGLCREATESHADERPROC)SDL_GL_GetProcAddress("glCreateShader");
+		glShaderSourcePtr       = (PFNGLSHADERSOURCEPROC)SDL_GL_GetProcAddress("glShaderSource");
+		glCompileShaderPtr      = (PFNGLCOMPILESHADERPROC)SDL_GL_GetProcAddress("glCompileShader");
+		glGetShaderivPtr        = (PFNGLGETSHADERIVPROC)SDL_GL_GetProcAddress("glGetShaderiv");
+		glDeleteShaderPtr       = (PFNGLDELETESHADERPROC)SDL_GL_GetProcAddress("glDeleteShader");
+		glCreateProgramPtr      = (PFNGLCREATEPROGRAMPROC)SDL_GL_GetProcAddress("glCreateProgram");
+		glAttachShaderPtr       = (PFNGLATTACHSHADERPROC)SDL_GL_GetProcAddress("glAttachShader");
+		glLinkProgramPtr        = (PFNGLLINKPROGRAMPROC)SDL_GL_GetProcAddress("glLinkProgram");
+		glGetProgramivPtr       = (PFNGLGETPROGRAMIVPROC)SDL_GL_GetProcAddress("glGetProgramiv");
+		glDeleteProgramPtr      = (PFNGLDELETEPROGRAMPROC)SDL_GL_GetProcAddress("glDeleteProgram");
+		glUseProgramPtr         = (PFNGLUSEPROGRAMPROC)SDL_GL_GetProcAddress("glUseProgram");
+		glGetUniformLocationPtr = (PFNGLGETUNIFORMLOCATIONPROC)SDL_GL_GetProcAddress("glGetUniformLocation");
+		glUniform1iPtr          = (PFNGLUNIFORM1IPROC)SDL_GL_GetProcAddress("glUniform1i");
+		glActiveTexturePtr      = (PFNGLACTIVETEXTUREPROC)SDL_GL_GetProcAddress("glActiveTexture");
+
+		yuvProgram = createYuvProgram();
+
+		LOG(LogInfo) << " YUV video shader: " << (supportsYuvTextures() ? "ok" : "MISSING");
+
 	} // createContext
 
 	void destroyContext()
 	{
+		glGenFramebuffersEXTPtr        = nullptr;
+		glDeleteFramebuffersEXTPtr     = nullptr;
+		glBindFramebufferEXTPtr        = nullptr;
+		glFramebufferTexture2DEXTPtr   = nullptr;
+		glCheckFramebufferStatusEXTPtr = nullptr;
+
+		glGenBuffersPtr                = nullptr;
+		glDeleteBuffersPtr             = nullptr;
+		glBindBufferPtr                = nullptr;
+		glBufferDataPtr                = nullptr;
+		glMapBufferPtr                 = nullptr;
+		glUnmapBufferPtr               = nullptr;
+
+		if(yuvProgram != 0)
+			glDeleteProgramPtr(yuvProgram);
+
+		yuvProgram = 0;
+
+		glCreateShaderPtr       = nullptr;
+		glShaderSourcePtr       = nullptr;
+		glCompileShaderPtr      = nullptr;
+		glGetShaderivPtr        = nullptr;
+		glDeleteShaderPtr       = nullptr;
+		glCreateProgramPtr      = nullptr;
+		glAttachShaderPtr       = nullptr;
+		glLinkProgramPtr        = nullptr;
+		glGetProgramivPtr       = nullptr;
+		glDeleteProgramPtr      = nullptr;
+		glUseProgramPtr         = nullptr;
+		glGetUniformLocationPtr = nullptr;
+		glUniform1iPtr          = nullptr;
+		glActiveTexturePtr      = nullptr;
+
 		SDL_GL_DeleteContext(sdlContext);
 		sdlContext = nullptr;
 
@@ -153,10 +366,180 @@ namespace Renderer
 
 	} // bindTexture
 
+	bool supportsFrameBuffers()
+	{
+		return glGenFramebuffersEXTPtr != nullptr && glDeleteFramebuffersEXTPtr != nullptr && glBindFramebufferEXTPtr != nullptr &&
+			glFramebufferTexture2DEXTPtr != nullptr && glCheckFramebufferStatusEXTPtr != nullptr &&
+			glBlendFuncSeparatePtr != nullptr;
+
+	} // supportsFrameBuffers
+
+	unsigned int createFrameBuffer(const unsigned int _texture)
+	{
+		if(!supportsFrameBuffers())
+			return 0;
+
+		unsigned int frameBuffer;
+
+		glGenFramebuffersEXTPtr(1, &frameBuffer);
+		glBindFramebufferEXTPtr(GL_FRAMEBUFFER_EXT, frameBuffer);
+		glFramebufferTexture2DEXTPtr(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, _texture, 0);
+
+		const GLenum status = glCheckFramebufferStatusEXTPtr(GL_FRAMEBUFFER_EXT);
+		glBindFramebufferEXTPtr(GL_FRAMEBUFFER_EXT, 0);
+
+		if(status != GL_FRAMEBUFFER_COMPLETE_EXT)
+		{
+			LOG(LogWarning) << "Framebuffer is incomplete (" << status << ")";
+			glDeleteFramebuffersEXTPtr(1, &frameBuffer);
+			return 0;
+		}
+
+		return frameBuffer;
+
+	} // createFrameBuffer
+
+	void destroyFrameBuffer(const unsigned int _frameBuffer)
+	{
+		if(supportsFrameBuffers())
+			glDeleteFramebuffersEXTPtr(1, &_frameBuffer);
+
+	} // destroyFrameBuffer
+
+	void bindFrameBuffer(const unsigned int _frameBuffer)
+	{
+		if(supportsFrameBuffers())
+		{
+			glBindFramebufferEXTPtr(GL_FRAMEBUFFER_EXT, _frameBuffer);
+			frameBufferBound = _frameBuffer != 0;
+		}
+
+	} // bindFrameBuffer
+
+	void clearFrameBuffer()
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+
+	} // clearFrameBuffer
+
+	bool supportsPixelBuffers()
+	{
+		return glGenBuffersPtr != nullptr && glDeleteBuffersPtr != nullptr && glBindBufferPtr != nullptr &&
+			glBufferDataPtr != nullptr && glMapBufferPtr != nullptr && glUnmapBufferPtr != nullptr;
+
+	} // supportsPixelBuffers
+
+	unsigned int createPixelBuffer(const unsigned int _size)
+	{
+		if(!supportsPixelBuffers())
+			return 0;
+
+		unsigned int pixelBuffer;
+
+		glGenBuffersPtr(1, &pixelBuffer);
+		glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER_ARB, pixelBuffer);
+		glBufferDataPtr(GL_PIXEL_UNPACK_BUFFER_ARB, _size, nullptr, GL_STREAM_DRAW);
+		glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+
+		return pixelBuffer;
+
+	} // createPixelBuffer
+
+	void destroyPixelBuffer(const unsigned int _pixelBuffer)
+	{
+		// deleting a mapped buffer unmaps it
+		if(supportsPixelBuffers())
+			glDeleteBuffersPtr(1, &_pixelBuffer);
+
+	} // destroyPixelBuffer
+
+	void* mapPixelBuffer(const unsigned int _pixelBuffer, const unsigned int _size)
+	{
+		if(!supportsPixelBuffers())
+			return nullptr;
+
+		glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER_ARB, _pixelBuffer);
+
+		// orphan the previous storage so a pending upload from it doesn't stall the mapping
+		glBufferDataPtr(GL_PIXEL_UNPACK_BUFFER_ARB, _size, nullptr, GL_STREAM_DRAW);
+		void* pixels = glMapBufferPtr(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY);
+
+		glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+
+		return pixels;
+
+	} // mapPixelBuffer
+
+	void updateTextureFromPixelBuffer(const unsigned int _texture, const unsigned int _pixelBuffer, const Texture::Type _type, const unsigned int _width, const unsigned int _height)
+	{
+		if(!supportsPixelBuffers())
+			return;
+
+		glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER_ARB, _pixelBuffer);
+		glUnmapBufferPtr(GL_PIXEL_UNPACK_BUFFER_ARB);
+
+		// with a bound unpack buffer the data pointer is an offset into it, the copy runs asynchronously
+		glBindTexture(GL_TEXTURE_2D, _texture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, convertTextureType(_type), GL_UNSIGNED_BYTE, nullptr);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+
+	} // updateTextureFromPixelBuffer
+
+	bool supportsYuvTextures()
+	{
+		return yuvProgram != 0;
+
+	} // supportsYuvTextures
+
+	void drawYuvTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const unsigned int* _planes)
+	{
+		if(yuvProgram == 0)
+			return;
+
+		// unit 0 is left active
+		for(int i = 2; i >= 0; i--)
+		{
+			glActiveTexturePtr(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, _planes[i]);
+		}
+
+		glUseProgramPtr(yuvProgram);
+
+		glEnable(GL_BLEND);
+		setBlendFunc(Blend::SRC_ALPHA, Blend::ONE_MINUS_SRC_ALPHA);
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
+		glVertexPointer(  2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].pos);
+		glTexCoordPointer(2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].tex);
+		glColorPointer(   4, GL_UNSIGNED_BYTE, sizeof(Vertex), &_vertices[0].col);
+
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVertices);
+
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+
+		glDisable(GL_BLEND);
+
+		glUseProgramPtr(0);
+
+		for(int i = 2; i >= 0; i--)
+		{
+			glActiveTexturePtr(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+	} // drawYuvTriangleStrips
+
 	void drawLines(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
 	{
 		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		setBlendFunc(_srcBlendFactor, _dstBlendFactor);
 
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -179,7 +562,7 @@ namespace Renderer
 	void drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
 	{
 		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		setBlendFunc(_srcBlendFactor, _dstBlendFactor);
 
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -313,7 +696,7 @@ namespace Renderer
 		glEnable(GL_MULTISAMPLE);
 
 		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		setBlendFunc(_srcBlendFactor, _dstBlendFactor);
 
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -6,6 +6,7 @@
 #include "Settings.h"
 
 #include <GLES/gl.h>
+#include <GLES/glext.h>
 #include <SDL.h>
 #include <vector>
 
@@ -13,6 +14,15 @@ namespace Renderer
 {
 	static SDL_GLContext sdlContext = nullptr;
 
+	static PFNGLGENFRAMEBUFFERSOESPROC        glGenFramebuffersOESPtr        = nullptr;
+	static PFNGLDELETEFRAMEBUFFERSOESPROC     glDeleteFramebuffersOESPtr     = nullptr;
+	static PFNGLBINDFRAMEBUFFEROESPROC        glBindFramebufferOESPtr        = nullptr;
+	static PFNGLFRAMEBUFFERTEXTURE2DOESPROC   glFramebufferTexture2DOESPtr   = nullptr;
+	static PFNGLCHECKFRAMEBUFFERSTATUSOESPROC glCheckFramebufferStatusOESPtr = nullptr;
+	static PFNGLBLENDFUNCSEPARATEOESPROC      glBlendFuncSeparateOESPtr      = nullptr;
+
+	static bool frameBufferBound = false;
+
 	static GLenum convertBlendFactor(const Blend::Factor _blendFactor)
 	{
 		switch(_blendFactor)
@@ -32,6 +42,16 @@ namespace Renderer
 
 	} // convertBlendFactor
 
+	static void setBlendFunc(const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		// Layers are captured with premultiplied alpha, so the alpha channel accumulates coverage like the screen does
+		if(frameBufferBound)
+			glBlendFuncSeparateOESPtr(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor), GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		else
+			glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+
+	} // setBlendFunc
+
 	static GLenum convertTextureType(const Texture::Type _type)
 	{
 		switch(_type)
@@ -87,10 +107,30 @@ namespace Renderer
 		LOG(LogInfo) << "Checking available OpenGL extensions...";
 		LOG(LogInfo) << " ARB_texture_non_power_of_two: " << (glExts.find("ARB_texture_non_power_of_two") != std::string::npos ? "ok" : "MISSING");
 
+		if(glExts.find("GL_OES_framebuffer_object") != std::string::npos)
+		{
+			glGenFramebuffersOESPtr        = (PFNGLGENFRAMEBUFFERSOESPROC)SDL_GL_GetProcAddress("glGenFramebuffersOES");
+			glDeleteFramebuffersOESPtr     = (PFNGLDELETEFRAMEBUFFERSOESPROC)SDL_GL_GetProcAddress("glDeleteFramebuffersOES");
+			glBindFramebufferOESPtr        = (PFNGLBINDFRAMEBUFFEROESPROC)SDL_GL_GetProcAddress("glBindFramebufferOES");
+			glFramebufferTexture2DOESPtr   = (PFNGLFRAMEBUFFERTEXTURE2DOESPROC)SDL_GL_GetProcAddress("glFramebufferTexture2DOES");
+			glCheckFramebufferStatusOESPtr = (PFNGLCHECKFRAMEBUFFERSTATUSOESPROC)SDL_GL_GetProcAddress("glCheckFramebufferStatusOES");
+		}
+
+		if(glExts.find("GL_OES_blend_func_separate") != std::string::npos)
+			glBlendFuncSeparateOESPtr = (PFNGLBLENDFUNCSEPARATEOESPROC)SDL_GL_GetProcAddress("glBlendFuncSeparateOES");
+
+		LOG(LogInfo) << " OES_framebuffer_object: " << (supportsFrameBuffers() ? "ok" : "MISSING");
+
 	} // createContext
 
 	void destroyContext()
 	{
+		glGenFramebuffersOESPtr        = nullptr;
+		glDeleteFramebuffersOESPtr     = nullptr;
+		glBindFramebufferOESPtr        = nullptr;
+		glFramebufferTexture2DOESPtr   = nullptr;
+		glCheckFramebufferStatusOESPtr = nullptr;
+
 		SDL_GL_DeleteContext(sdlContext);
 		sdlContext = nullptr;
 
@@ -150,10 +190,109 @@ namespace Renderer
 
 	} // bindTexture
 
+	bool supportsFrameBuffers()
+	{
+		return glGenFramebuffersOESPtr != nullptr && glDeleteFramebuffersOESPtr != nullptr && glBindFramebufferOESPtr != nullptr &&
+			glFramebufferTexture2DOESPtr != nullptr && glCheckFramebufferStatusOESPtr != nullptr &&
+			glBlendFuncSeparateOESPtr != nullptr;
+
+	} // supportsFrameBuffers
+
+	unsigned int createFrameBuffer(const unsigned int _texture)
+	{
+		if(!supportsFrameBuffers())
+			return 0;
+
+		unsigned int frameBuffer;
+
+		glGenFramebuffersOESPtr(1, &frameBuffer);
+		glBindFramebufferOESPtr(GL_FRAMEBUFFER_OES, frameBuffer);
+		glFramebufferTexture2DOESPtr(GL_FRAMEBUFFER_OES, GL_COLOR_ATTACHMENT0_OES, GL_TEXTURE_2D, _texture, 0);
+
+		const GLenum status = glCheckFramebufferStatusOESPtr(GL_FRAMEBUFFER_OES);
+		glBindFramebufferOESPtr(GL_FRAMEBUFFER_OES, 0);
+
+		if(status != GL_FRAMEBUFFER_COMPLETE_OES)
+		{
+			LOG(LogWarning) << "Framebuffer is incomplete (" << status << ")";
+			glDeleteFramebuffersOESPtr(1, &frameBuffer);
+			return 0;
+		}
+
+		return frameBuffer;
+
+	} // createFrameBuffer
+
+	void destroyFrameBuffer(const unsigned int _frameBuffer)
+	{
+		if(supportsFrameBuffers())
+			glDeleteFramebuffersOESPtr(1, &_frameBuffer);
+
+	} // destroyFrameBuffer
+
+	void bindFrameBuffer(const unsigned int _frameBuffer)
+	{
+		if(supportsFrameBuffers())
+		{
+			glBindFramebufferOESPtr(GL_FRAMEBUFFER_OES, _frameBuffer);
+			frameBufferBound = _frameBuffer != 0;
+		}
+
+	} // bindFrameBuffer
+
+	void clearFrameBuffer()
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+
+	} // clearFrameBuffer
+
+	// GLES 1.0 has no pixel buffer objects, textures are updated from client memory
+
+	bool supportsPixelBuffers()
+	{
+		return false;
+
+	} // supportsPixelBuffers
+
+	unsigned int createPixelBuffer(const unsigned int /*_size*/)
+	{
+		return 0;
+
+	} // createPixelBuffer
+
+	void destroyPixelBuffer(const unsigned int /*_pixelBuffer*/)
+	{
+
+	} // destroyPixelBuffer
+
+	void* mapPixelBuffer(const unsigned int /*_pixelBuffer*/, const unsigned int /*_size*/)
+	{
+		return nullptr;
+
+	} // mapPixelBuffer
+
+	void updateTextureFromPixelBuffer(const unsigned int /*_texture*/, const unsigned int /*_pixelBuffer*/, const Texture::Type /*_type*/, const unsigned int /*_width*/, const unsigned int /*_height*/)
+	{
+
+	} // updateTextureFromPixelBuffer
+
+	// No shaders : videos are decoded to RGBA
+
+	bool supportsYuvTextures()
+	{
+		return false;
+
+	} // supportsYuvTextures
+
+	void drawYuvTriangleStrips(const Vertex* /*_vertices*/, const unsigned int /*_numVertices*/, const unsigned int* /*_planes*/)
+	{
+
+	} // drawYuvTriangleStrips
+
 	void drawLines(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
 	{
 		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		setBlendFunc(_srcBlendFactor, _dstBlendFactor);
 
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -176,7 +315,7 @@ namespace Renderer
 	void drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
 	{
 		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		setBlendFunc(_srcBlendFactor, _dstBlendFactor);
 
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -308,7 +447,7 @@ namespace Renderer
 		bindTexture(0);
 
 		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		setBlendFunc(_srcBlendFactor, _dstBlendFactor);
 
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
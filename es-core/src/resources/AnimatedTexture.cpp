@@ -0,0 +1,270 @@
+#include "resources/AnimatedTexture.h"
+
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "Log.h"
+#include <FreeImage.h>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+#define ANIMATION_FRAMES_BUDGET	(8 * 1024 * 1024)
+#define MIN_DECODED_FRAMES		2
+#define MAX_DECODED_FRAMES		6
+#define DEFAULT_FRAME_DELAY		100
+
+struct DecodedFrame
+{
+	unsigned char*	data;
+	size_t			width;
+	size_t			height;
+	int				delay;
+};
+
+struct AnimationDecoder
+{
+	AnimationDecoder(const std::string& _path, MaxSizeInfo* _maxSize) : path(_path), memory(nullptr), bitmap(nullptr),
+		frameCount(0), nextFrame(0), maxFrames(1), decoding(false), finished(false), failed(false), aborted(false)
+	{
+		if (_maxSize != nullptr)
+			maxSize = *_maxSize;
+	}
+
+	~AnimationDecoder()
+	{
+		for (auto frame : frames)
+			delete[] frame.data;
+
+		if (bitmap != nullptr)
+			FreeImage_CloseMultiBitmap(bitmap);
+
+		if (memory != nullptr)
+			FreeImage_CloseMemory(memory);
+	}
+
+	bool open()
+	{
+		const ResourceData& data = ResourceManager::getInstance()->getFileData(path);
+		if (data.ptr == nullptr || data.length == 0)
+			return false;
+
+		// FreeImage reads the pages from the memory stream, keep the file content alive with it
+		fileData = data.ptr;
+		memory = FreeImage_OpenMemory((BYTE*)fileData.get(), (DWORD)data.length);
+		if (memory == nullptr)
+			return false;
+
+		// GIF_PLAYBACK composes each page with the previous ones, as a browser would display them
+		bitmap = FreeImage_LoadMultiBitmapFromMemory(FIF_GIF, memory, GIF_PLAYBACK);
+		if (bitmap == nullptr)
+			return false;
+
+		frameCount = FreeImage_GetPageCount(bitmap);
+		return frameCount > 0;
+	}
+
+	bool decodeFrame(DecodedFrame& frame)
+	{
+		FIBITMAP* page = FreeImage_LockPage(bitmap, nextFrame);
+		if (page == nullptr)
+			return false;
+
+		frame.delay = DEFAULT_FRAME_DELAY;
+
+		FITAG* tag = nullptr;
+		if (FreeImage_GetMetadata(FIMD_ANIMATION, page, "FrameTime", &tag) && tag != nullptr)
+			frame.delay = *(const int*)FreeImage_GetTagValue(tag);
+
+		// Like browsers do, consider very short delays as unset
+		if (frame.delay <= 10)
+			frame.delay = DEFAULT_FRAME_DELAY;
+
+		FIBITMAP* fiBitmap = FreeImage_ConvertTo32Bits(page);
+		FreeImage_UnlockPage(bitmap, page, false);
+
+		if (fiBitmap == nullptr)
+			return false;
+
+		frame.width = FreeImage_GetWidth(fiBitmap);
+		frame.height = FreeImage_GetHeight(fiBitmap);
+
+		if (!maxSize.empty() && (frame.width > maxSize.x() || frame.height > maxSize.y()))
+		{
+			Vector2i sz = ImageIO::adjustPictureSize(Vector2i(frame.width, frame.height), Vector2i(maxSize.x(), maxSize.y()), maxSize.externalZoom());
+			if (sz.x() != frame.width || sz.y() != frame.height)
+			{
+				FIBITMAP* imageRescaled = FreeImage_Rescale(fiBitmap, sz.x(), sz.y(), FILTER_BOX);
+				if (imageRescaled != nullptr)
+				{
+					FreeImage_Unload(fiBitmap);
+					fiBitmap = imageRescaled;
+
+					frame.width = FreeImage_GetWidth(fiBitmap);
+					frame.height = FreeImage_GetHeight(fiBitmap);
+				}
+			}
+		}
+
+		frame.data = new unsigned char[frame.width * frame.height * 4];
+
+		int w = (int)frame.width;
+
+		for (int y = (int)frame.height; --y >= 0; )
+		{
+			unsigned int* argb = (unsigned int*)FreeImage_GetScanLine(fiBitmap, y);
+			unsigned int* abgr = (unsigned int*)(frame.data + (y * frame.width * 4));
+			for (int x = w; --x >= 0;)
+			{
+				unsigned int c = argb[x];
+				abgr[x] = (c & 0xFF00FF00) | ((c & 0xFF) << 16) | ((c >> 16) & 0xFF);
+			}
+		}
+
+		FreeImage_Unload(fiBitmap);
+
+		nextFrame = (nextFrame + 1) % frameCount;
+		return true;
+	}
+
+	// Runs on a texture loader thread, fills the ring then exits. Only one run is active at a time.
+	void run()
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (aborted || frames.size() >= maxFrames)
+				{
+					decoding = false;
+					return;
+				}
+			}
+
+			DecodedFrame frame;
+			if ((bitmap == nullptr && !open()) || !decodeFrame(frame))
+			{
+				LOG(LogError) << "AnimatedTexture : unable to decode " << path;
+
+				std::unique_lock<std::mutex> lock(mutex);
+				failed = true;
+				decoding = false;
+				return;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			frames.push_back(frame);
+
+			// Keep as many frames ahead as the budget allows, a single frame image is decoded only once
+			if (frameCount == 1)
+				finished = true;
+			else
+			{
+				size_t frameSize = std::max((size_t)1, frame.width * frame.height * 4);
+				maxFrames = std::min((size_t)frameCount, std::max((size_t)MIN_DECODED_FRAMES, std::min((size_t)MAX_DECODED_FRAMES, ANIMATION_FRAMES_BUDGET / frameSize)));
+			}
+
+			if (finished)
+			{
+				decoding = false;
+				return;
+			}
+		}
+	}
+
+	std::mutex					mutex;
+	std::string					path;
+	MaxSizeInfo					maxSize;
+
+	std::shared_ptr<unsigned char> fileData;
+	FIMEMORY*					memory;
+	FIMULTIBITMAP*				bitmap;
+	int							frameCount;
+	int							nextFrame;
+
+	std::deque<DecodedFrame>	frames;
+	size_t						maxFrames;
+
+	bool						decoding;
+	bool						finished;
+	bool						failed;
+	bool						aborted;
+};
+
+bool AnimatedTexture::isAnimation(const std::string& path)
+{
+	return Utils::String::toLower(Utils::FileSystem::getExtension(path)) == ".gif";
+}
+
+AnimatedTexture::AnimatedTexture(const std::string& path, bool linear, MaxSizeInfo* maxSize) : mFrameData(nullptr), mFrameDelay(0), mFrameTime(0)
+{
+	mTexture = TextureResource::get("", false, linear);
+	mDecoder = std::make_shared<AnimationDecoder>(path, maxSize);
+
+	decodeAhead();
+}
+
+AnimatedTexture::~AnimatedTexture()
+{
+	{
+		// A running decoding job keeps the decoder alive, tell it to exit early
+		std::unique_lock<std::mutex> lock(mDecoder->mutex);
+		mDecoder->aborted = true;
+	}
+
+	if (mFrameData != nullptr)
+		delete[] mFrameData;
+}
+
+void AnimatedTexture::decodeAhead()
+{
+	std::unique_lock<std::mutex> lock(mDecoder->mutex);
+	if (mDecoder->decoding || mDecoder->finished || mDecoder->failed || mDecoder->frames.size() >= mDecoder->maxFrames)
+		return;
+
+	mDecoder->decoding = true;
+
+	std::shared_ptr<AnimationDecoder> decoder = mDecoder;
+	TextureResource::runAsync([decoder] { decoder->run(); });
+}
+
+bool AnimatedTexture::update(int deltaTime)
+{
+	mFrameTime += deltaTime;
+
+	if (mFrameData != nullptr && mFrameTime < mFrameDelay)
+		return false;
+
+	DecodedFrame frame;
+
+	{
+		std::unique_lock<std::mutex> lock(mDecoder->mutex);
+		if (mDecoder->frames.empty())
+		{
+			lock.unlock();
+
+			// The decoder is late : hold the current frame rather than skipping the next ones
+			mFrameTime = std::min(mFrameTime, mFrameDelay);
+			decodeAhead();
+			return false;
+		}
+
+		frame = mDecoder->frames.front();
+		mDecoder->frames.pop_front();
+	}
+
+	mTexture->initFromExternalPixels(frame.data, frame.width, frame.height);
+
+	if (mFrameData != nullptr)
+	{
+		delete[] mFrameData;
+		mFrameTime = std::min(mFrameTime - mFrameDelay, frame.delay);
+	}
+	else
+		mFrameTime = 0;
+
+	mFrameData = frame.data;
+	mFrameDelay = frame.delay;
+
+	decodeAhead();
+	return true;
+}
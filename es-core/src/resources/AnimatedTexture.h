@@ -0,0 +1,41 @@
+#pragma once
+#ifndef ES_CORE_RESOURCES_ANIMATED_TEXTURE_H
+#define ES_CORE_RESOURCES_ANIMATED_TEXTURE_H
+
+#include "resources/TextureResource.h"
+#include <memory>
+#include <string>
+
+struct AnimationDecoder;
+
+// A texture playing an animated GIF.
+// Frames are decoded ahead on the texture loader threads into a small ring, sized by a memory budget,
+// and uploaded one at a time into a single streamed texture as their delay expires.
+class AnimatedTexture
+{
+public:
+	static bool isAnimation(const std::string& path);
+
+	AnimatedTexture(const std::string& path, bool linear, MaxSizeInfo* maxSize = nullptr);
+	~AnimatedTexture();
+
+	const std::shared_ptr<TextureResource>& getTexture() { return mTexture; }
+
+	// Advances the animation, returns true when a new frame was uploaded.
+	// Decoding only progresses while the owner calls it : not calling it when hidden pauses the animation.
+	bool update(int deltaTime);
+
+	bool hasFrame() const { return mFrameData != nullptr; }
+
+private:
+	void decodeAhead();
+
+	std::shared_ptr<TextureResource>	mTexture;
+	std::shared_ptr<AnimationDecoder>	mDecoder;
+
+	unsigned char*	mFrameData;
+	int				mFrameDelay;
+	int				mFrameTime;
+};
+
+#endif // ES_CORE_RESOURCES_ANIMATED_TEXTURE_H
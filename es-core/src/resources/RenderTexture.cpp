@@ -0,0 +1,142 @@
+#include "resources/RenderTexture.h"
+
+#include "math/Transform4x4f.h"
+#include "resources/TextureResource.h"
+#include "Log.h"
+#include "Settings.h"
+
+size_t RenderTexture::sTotalMemUsage = 0;
+
+std::shared_ptr<RenderTexture> RenderTexture::get()
+{
+	std::shared_ptr<RenderTexture> tex = std::shared_ptr<RenderTexture>(new RenderTexture());
+	ResourceManager::getInstance()->addReloadable(tex);
+	return tex;
+}
+
+RenderTexture::RenderTexture() : mTexture(0), mFrameBuffer(0), mWidth(0), mHeight(0), mArea(0, 0, 0, 0), mValid(false), mCapturing(false)
+{
+}
+
+RenderTexture::~RenderTexture()
+{
+	release();
+}
+
+size_t RenderTexture::getTotalMemUsage()
+{
+	return sTotalMemUsage;
+}
+
+bool RenderTexture::allocate(int _width, int _height)
+{
+	if (mFrameBuffer != 0 && mWidth == _width && mHeight == _height)
+		return true;
+
+	release();
+
+	if (!Renderer::supportsFrameBuffers())
+		return false;
+
+	// Layers share the texture budget, never push textures out of VRAM to make room for a cache
+	size_t size = (size_t)_width * _height * 4;
+	size_t maxSize = (size_t)Settings::getInstance()->getInt("MaxVRAM") * 1024 * 1024;
+	if (TextureResource::getTotalMemUsage() + size > maxSize)
+		return false;
+
+	mTexture = Renderer::createTexture(Renderer::Texture::RGBA, false, false, _width, _height, nullptr);
+	if (mTexture == 0)
+		return false;
+
+	mFrameBuffer = Renderer::createFrameBuffer(mTexture);
+	if (mFrameBuffer == 0)
+	{
+		Renderer::destroyTexture(mTexture);
+		mTexture = 0;
+		return false;
+	}
+
+	mWidth = _width;
+	mHeight = _height;
+	sTotalMemUsage += size;
+	return true;
+}
+
+void RenderTexture::release()
+{
+	if (mFrameBuffer != 0)
+	{
+		Renderer::destroyFrameBuffer(mFrameBuffer);
+		mFrameBuffer = 0;
+	}
+
+	if (mTexture != 0)
+	{
+		Renderer::destroyTexture(mTexture);
+		mTexture = 0;
+
+		sTotalMemUsage -= (size_t)mWidth * mHeight * 4;
+	}
+
+	mWidth = 0;
+	mHeight = 0;
+	mValid = false;
+}
+
+bool RenderTexture::beginCapture(const Renderer::Rect& _area)
+{
+	if (mCapturing || !allocate(_area.w, _area.h))
+		return false;
+
+	if (!Renderer::pushRenderTarget(mFrameBuffer, _area))
+		return false;
+
+	mArea = _area;
+	mCapturing = true;
+	return true;
+}
+
+void RenderTexture::endCapture()
+{
+	if (!mCapturing)
+		return;
+
+	Renderer::popRenderTarget();
+	mCapturing = false;
+	mValid = true;
+}
+
+void RenderTexture::render()
+{
+	if (!mValid || mTexture == 0)
+		return;
+
+	const float        x = (float)mArea.x;
+	const float        y = (float)mArea.y;
+	const float        w = (float)mArea.w;
+	const float        h = (float)mArea.h;
+	const unsigned int color = Renderer::convertColor(0xFFFFFFFF);
+
+	// The framebuffer is filled bottom-up, flip the texture coordinates
+	Renderer::Vertex vertices[4];
+	vertices[0] = { { x,     y     }, { 0.0f, 1.0f }, color };
+	vertices[1] = { { x,     y + h }, { 0.0f, 0.0f }, color };
+	vertices[2] = { { x + w, y     }, { 1.0f, 1.0f }, color };
+	vertices[3] = { { x + w, y + h }, { 1.0f, 0.0f }, color };
+
+	Renderer::setMatrix(Transform4x4f::Identity());
+	Renderer::bindTexture(mTexture);
+
+	// Captured colors are already multiplied by their alpha
+	Renderer::drawTriangleStrips(&vertices[0], 4, Renderer::Blend::ONE, Renderer::Blend::ONE_MINUS_SRC_ALPHA);
+}
+
+bool RenderTexture::unload()
+{
+	release();
+	return false;
+}
+
+void RenderTexture::reload()
+{
+}
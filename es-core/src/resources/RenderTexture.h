@@ -0,0 +1,49 @@
+#pragma once
+#ifndef ES_CORE_RESOURCES_RENDER_TEXTURE_H
+#define ES_CORE_RESOURCES_RENDER_TEXTURE_H
+
+#include "renderers/Renderer.h"
+#include "resources/ResourceManager.h"
+#include <memory>
+
+// An offscreen texture components can render into and draw back as a single quad.
+// The GL objects are released with renderer deinit and recreated on the next capture.
+class RenderTexture : public IReloadable
+{
+public:
+	static std::shared_ptr<RenderTexture> get();
+	virtual ~RenderTexture();
+
+	// Redirects rendering into the texture, _area is the screen rectangle to capture
+	bool beginCapture(const Renderer::Rect& _area);
+	void endCapture();
+
+	// Draws the captured content back where it was captured
+	void render();
+
+	bool isValid() const { return mValid; }
+	void invalidate() { mValid = false; }
+
+	virtual bool unload();
+	virtual void reload();
+
+	static size_t getTotalMemUsage(); // returns the VRAM used by all render textures (in bytes)
+
+private:
+	RenderTexture();
+
+	bool allocate(int _width, int _height);
+	void release();
+
+	unsigned int   mTexture;
+	unsigned int   mFrameBuffer;
+	int            mWidth;
+	int            mHeight;
+	Renderer::Rect mArea;
+	bool           mValid;
+	bool           mCapturing;
+
+	static size_t  sTotalMemUsage;
+};
+
+#endif // ES_CORE_RESOURCES_RENDER_TEXTURE_H
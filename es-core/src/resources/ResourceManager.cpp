@@ -1,15 +1,21 @@
 #include "ResourceManager.h"
 
+#include "resources/ThemePack.h"
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
 #include <fstream>
 
+#define MAPPED_FILE_MIN_SIZE	65536
+#define CACHED_FILE_MAX_SIZE	16384
+#define CACHED_FILES_MAX_COUNT	64
+#define CACHED_FILES_MAX_BYTES	(1024 * 1024)
+
 auto array_deleter = [](unsigned char* p) { delete[] p; };
 auto nop_deleter = [](unsigned char* /*p*/) { };
 
 std::shared_ptr<ResourceManager> ResourceManager::sInstance = nullptr;
 
-ResourceManager::ResourceManager()
+ResourceManager::ResourceManager() : mCachedBytes(0)
 {
 }
 
@@ -72,9 +78,21 @@ const ResourceData ResourceManager::getFileData(const std::string& path) const
 	//check if its a resource
 	const std::string respath = getResourcePath(path);
 
+	//check if it's in the pack of the theme
+	ResourceData packed = ThemePack::getFileData(respath);
+	if (packed.ptr != nullptr)
+		return packed;
+
 	auto size = Utils::FileSystem::getFileSize(respath);
 	if (size > 0)
 	{
+		// Only map files nobody rewrites while we run : a truncated mapping faults on read
+		if (size >= MAPPED_FILE_MIN_SIZE && isBundledResource(respath))
+			return loadMappedFile(respath, size);
+
+		if (size <= CACHED_FILE_MAX_SIZE)
+			return loadCachedFile(respath, size);
+
 		ResourceData data = loadFile(respath, size);
 		return data;
 	}
@@ -84,6 +102,23 @@ const ResourceData ResourceManager::getFileData(const std::string& path) const
 	return data;
 }
 
+bool ResourceManager::isBundledResource(const std::string& path) const
+{
+	// Read-only system locations only : the user can replace anything under the ES config or userdata folders
+	const std::string roots[] =
+	{
+		Utils::FileSystem::getSharedConfigPath() + "/resources/",
+		"/etc/emulationstation/themes/",
+		"/usr/share/fonts/"
+	};
+
+	for (const auto& root : roots)
+		if (Utils::String::startsWith(path, root))
+			return true;
+
+	return false;
+}
+
 ResourceData ResourceManager::loadFile(const std::string& path, size_t size) const
 {
 	std::ifstream stream(path, std::ios::binary);
@@ -104,12 +139,100 @@ ResourceData ResourceManager::loadFile(const std::string& path, size_t size) con
 	return ret;
 }
 
+ResourceData ResourceManager::loadMappedFile(const std::string& path, size_t size) const
+{
+	std::unique_lock<std::mutex> lock(mLock);
+
+	std::shared_ptr<Utils::FileSystem::MappedFile> file;
+
+	auto it = mMappedFiles.find(path);
+	if (it != mMappedFiles.cend())
+		file = it->second.lock();
+
+	// Not used anymore, or the file was replaced
+	if (file == nullptr || file->size() != size)
+	{
+		file = std::make_shared<Utils::FileSystem::MappedFile>(path);
+		if (file->data() == nullptr)
+		{
+			ResourceData data = { NULL, 0 };
+			return data;
+		}
+
+		// Forget the files released since
+		for (auto mapped = mMappedFiles.begin(); mapped != mMappedFiles.end(); )
+		{
+			if (mapped->second.expired())
+				mapped = mMappedFiles.erase(mapped);
+			else
+				++mapped;
+		}
+
+		mMappedFiles[path] = file;
+	}
+
+	// The data keeps the mapping alive. Readers never write to it
+	ResourceData data = { std::shared_ptr<unsigned char>(file, (unsigned char*)file->data()), file->size() };
+	return data;
+}
+
+ResourceData ResourceManager::loadCachedFile(const std::string& path, size_t size) const
+{
+	time_t date = Utils::FileSystem::getFileModificationDate(path).getTime();
+
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+
+		for (auto it = mCachedFiles.begin(); it != mCachedFiles.end(); ++it)
+		{
+			if (it->path != path)
+				continue;
+
+			if (it->length == size && it->date == date)
+			{
+				mCachedFiles.splice(mCachedFiles.begin(), mCachedFiles, it);
+
+				ResourceData data = { it->ptr, it->length };
+				return data;
+			}
+
+			mCachedBytes -= it->length;
+			mCachedFiles.erase(it);
+			break;
+		}
+	}
+
+	ResourceData data = loadFile(path, size);
+
+	std::unique_lock<std::mutex> lock(mLock);
+
+	CachedFile file;
+	file.path = path;
+	file.date = date;
+	file.ptr = data.ptr;
+	file.length = data.length;
+
+	mCachedFiles.push_front(file);
+	mCachedBytes += file.length;
+
+	while (mCachedFiles.size() > CACHED_FILES_MAX_COUNT || mCachedBytes > CACHED_FILES_MAX_BYTES)
+	{
+		mCachedBytes -= mCachedFiles.back().length;
+		mCachedFiles.pop_back();
+	}
+
+	return data;
+}
+
 bool ResourceManager::fileExists(const std::string& path) const
 {
 	//if it exists as a resource file, return true
 	if(getResourcePath(path) != path)
 		return true;
 
+	if(ThemePack::contains(path))
+		return true;
+
 	return Utils::FileSystem::exists(path);
 }
 
@@ -2,12 +2,17 @@
 #ifndef ES_CORE_RESOURCES_RESOURCE_MANAGER_H
 #define ES_CORE_RESOURCES_RESOURCE_MANAGER_H
 
+#include "utils/FileSystemUtil.h"
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 
 //The ResourceManager exists to...
 //Allow loading resources embedded into the executable like an actual file.
 //Allow embedded resources to be optionally remapped to actual files for further customization.
+//Big files are memory mapped, one mapping being shared by everyone loading the same file (fonts opened at several sizes...)
+//Small files are kept in memory for a while, as they are often loaded again.
 
 struct ResourceData
 {
@@ -43,7 +48,24 @@ private:
 
 	static std::shared_ptr<ResourceManager> sInstance;
 
+	bool isBundledResource(const std::string& path) const;
+
 	ResourceData loadFile(const std::string& path, size_t size) const;
+	ResourceData loadMappedFile(const std::string& path, size_t size) const;
+	ResourceData loadCachedFile(const std::string& path, size_t size) const;
+
+	struct CachedFile
+	{
+		std::string path;
+		time_t date;
+		std::shared_ptr<unsigned char> ptr;
+		size_t length;
+	};
+
+	mutable std::mutex mLock;
+	mutable std::map<std::string, std::weak_ptr<Utils::FileSystem::MappedFile>> mMappedFiles;
+	mutable std::list<CachedFile> mCachedFiles; // most recently used first
+	mutable size_t mCachedBytes;
 
 	class ReloadableInfo
 	{
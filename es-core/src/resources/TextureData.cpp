@@ -192,14 +192,51 @@ bool TextureData::initFromExternalRGBA(unsigned char* dataRGBA, size_t width, si
 	if (!mIsExternalDataRGBA && mDataRGBA != nullptr)
 		delete[] mDataRGBA;
 
+	bool sameSize = (mWidth == width && mHeight == height);
+
 	mIsExternalDataRGBA = true;
 	mDataRGBA = dataRGBA;
 	mWidth = width;
 	mHeight = height;
 
 	if (mTextureID != 0)
-		Renderer::updateTexture(mTextureID, Renderer::Texture::RGBA, -1, -1, mWidth, mHeight, mDataRGBA);
+	{
+		// Streamed frames keep their size, replace the content instead of reallocating the texture
+		if (sameSize)
+			Renderer::updateTexture(mTextureID, Renderer::Texture::RGBA, 0, 0, mWidth, mHeight, mDataRGBA);
+		else
+			Renderer::updateTexture(mTextureID, Renderer::Texture::RGBA, -1, -1, mWidth, mHeight, mDataRGBA);
+	}
+
+	return true;
+}
+
+bool TextureData::initFromPixelBuffer(unsigned int pixelBuffer, size_t width, size_t height)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	if (!mIsExternalDataRGBA && mDataRGBA != nullptr)
+		delete[] mDataRGBA;
+
+	mIsExternalDataRGBA = false;
+	mDataRGBA = nullptr;
+
+	if (mTextureID != 0 && (mWidth != width || mHeight != height))
+	{
+		Renderer::destroyTexture(mTextureID);
+		mTextureID = 0;
+	}
+
+	mWidth = width;
+	mHeight = height;
+
+	if (mTextureID == 0)
+		mTextureID = Renderer::createTexture(Renderer::Texture::RGBA, mLinear, mTile, mWidth, mHeight, nullptr);
+
+	if (mTextureID == 0)
+		return false;
 
+	Renderer::updateTextureFromPixelBuffer(mTextureID, pixelBuffer, Renderer::Texture::RGBA, mWidth, mHeight);
 	return true;
 }
 
@@ -61,6 +61,9 @@ public:
 
 	bool initFromExternalRGBA(unsigned char* dataRGBA, size_t width, size_t height);
 
+	// Replaces the texture content with a mapped pixel buffer (see Renderer::mapPixelBuffer)
+	bool initFromPixelBuffer(unsigned int pixelBuffer, size_t width, size_t height);
+
 private:
 	std::mutex		mMutex;
 	bool			mTile;
@@ -184,7 +184,8 @@ void TextureDataManager::load(std::shared_ptr<TextureData> tex, bool block)
 
 	// Not loaded. Make sure there is room
 	size_t size = TextureResource::getTotalMemUsage();
-	size_t max_texture = (size_t)Settings::getInstance()->getInt("MaxVRAM") * 1024 * 1024;
+	static SettingValue<int> maxVRAM("MaxVRAM");
+	size_t max_texture = (size_t)maxVRAM.get() * 1024 * 1024;
 
 	if (size >= max_texture)
 	{
@@ -270,7 +271,7 @@ void TextureLoader::threadProc()
 	{		
 		// Wait for an event to say there is something in the queue
 		std::unique_lock<std::mutex> lock(mLoaderLock);
-		mEvent.wait(lock, [this]() { return mExit || !mTextureDataQ.empty(); });
+		mEvent.wait(lock, [this]() { return mExit || !mTextureDataQ.empty() || !mJobQ.empty(); });
 
 		if (mExit)
 			break;
@@ -298,7 +299,15 @@ void TextureLoader::threadProc()
 			}
 
 			std::this_thread::yield();
-		}		
+		}
+		else if (!mJobQ.empty())
+		{
+			std::function<void()> job = mJobQ.front();
+			mJobQ.pop_front();
+
+			lock.unlock();
+			job();
+		}
 	}
 }
 
@@ -360,8 +369,22 @@ void TextureLoader::clearQueue()
 	mTextureDataQ.clear();	
 }
 
+void TextureLoader::run(const std::function<void()>& job)
+{
+	std::unique_lock<std::mutex> lock(mLoaderLock);
+
+	mJobQ.push_back(job);
+	mEvent.notify_one();
+}
+
 void TextureDataManager::clearQueue()
 {
 	if (mLoader != nullptr)
 		mLoader->clearQueue();
+}
+
+void TextureDataManager::run(const std::function<void()>& job)
+{
+	if (mLoader != nullptr)
+		mLoader->run(job);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #define ES_CORE_RESOURCES_TEXTURE_DATA_MANAGER_H
 
 #include <condition_variable>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
@@ -24,6 +25,9 @@ public:
 	bool remove(std::shared_ptr<TextureData> textureData);
 	void clearQueue();
 
+	// Runs a job on the loader threads, once no texture is waiting
+	void run(const std::function<void()>& job);
+
 	size_t getQueueSize();
 
 private:	
@@ -31,6 +35,7 @@ private:
 
 	std::list<std::shared_ptr<TextureData>> 										mProcessingTextureDataQ;
 	std::list<std::shared_ptr<TextureData>> 										mTextureDataQ;
+	std::list<std::function<void()>>												mJobQ;
 
 	std::vector<std::thread>	mThreads;
 	std::mutex					mLoaderLock;
@@ -83,6 +88,8 @@ public:
 
 	void clearQueue();
 
+	void run(const std::function<void()>& job);
+
 	void onTextureLoaded(std::shared_ptr<TextureData> tex);
 
 private:
@@ -2,7 +2,9 @@
 
 #include "utils/FileSystemUtil.h"
 #include "resources/TextureData.h"
+#include "resources/RenderTexture.h"
 #include <cstring>
+#include <ctime>
 #include "Settings.h"
 #include "PowerSaver.h"
 #include "Log.h"
@@ -11,6 +13,36 @@ TextureDataManager		TextureResource::sTextureDataManager;
 std::map< TextureResource::TextureKeyType, std::weak_ptr<TextureResource> > TextureResource::sTextureMap;
 std::set<TextureResource*> 	TextureResource::sAllTextures;
 
+#define LINKID_CACHE_SECONDS	30
+#define LINKID_CACHE_MAXSIZE	4096
+
+struct LinkIdEntry
+{
+	std::string	id;
+	time_t		time;
+};
+
+static std::map<std::string, LinkIdEntry> sLinkIds;
+
+// Hardlink identity of a dynamic texture path. A stat per lookup is too much for the gamelist views,
+// so the answer is kept for a while : a media replaced by the scraper is shared a bit later
+static std::string getCachedHardLinkId(const std::string& path)
+{
+	time_t now = time(NULL);
+
+	auto it = sLinkIds.find(path);
+	if (it != sLinkIds.cend() && now - it->second.time < LINKID_CACHE_SECONDS)
+		return it->second.id;
+
+	if (sLinkIds.size() >= LINKID_CACHE_MAXSIZE)
+		sLinkIds.clear();
+
+	LinkIdEntry& entry = sLinkIds[path];
+	entry.id = Utils::FileSystem::getHardLinkId(path);
+	entry.time = now;
+	return entry.id;
+}
+
 TextureResource::TextureResource(const std::string& path, bool tile, bool linear, bool dynamic, bool allowAsync, MaxSizeInfo* maxSize) : mTextureData(nullptr), mForceLoad(false)
 {
 	// Create a texture data object for this texture
@@ -110,6 +142,17 @@ void TextureResource::initFromExternalPixels(unsigned char* dataRGBA, size_t wid
 	mSourceSize = Vector2f(mTextureData->sourceWidth(), mTextureData->sourceHeight());
 }
 
+bool TextureResource::initFromPixelBuffer(unsigned int pixelBuffer, size_t width, size_t height)
+{
+	if (!mTextureData->initFromPixelBuffer(pixelBuffer, width, height))
+		return false;
+
+	// Cache the image dimensions
+	mSize = Vector2i((int)width, (int)height);
+	mSourceSize = Vector2f(mTextureData->sourceWidth(), mTextureData->sourceHeight());
+	return true;
+}
+
 void TextureResource::initFromPixels(unsigned char* dataRGBA, size_t width, size_t height)
 {
 	// This is only valid if we have a local texture data object
@@ -189,7 +232,12 @@ std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, b
 	if (canonicalPath.length() > 0 && canonicalPath[0] == ':')
 		dynamic = false;
 
-	TextureKeyType key(canonicalPath, tile, linear);
+	// Identical medias are hardlinked by the scraper : all their paths share the same texture
+	std::string linkId;
+	if (dynamic)
+		linkId = getCachedHardLinkId(canonicalPath);
+
+	TextureKeyType key(linkId.empty() ? canonicalPath : linkId, tile, linear);
 	auto foundTexture = sTextureMap.find(key);
 	if(foundTexture != sTextureMap.cend())
 	{
@@ -221,7 +269,7 @@ std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, b
 	
 	// need to create it
 	std::shared_ptr<TextureResource> tex;
-	tex = std::make_shared<TextureResource>(std::get<0>(key), tile, linear, dynamic, !forceLoad, maxSize);
+	tex = std::make_shared<TextureResource>(canonicalPath, tile, linear, dynamic, !forceLoad, maxSize);
 	std::shared_ptr<TextureData> data = sTextureDataManager.get(tex.get(), !forceLoad);
 
 	if (asReloadable)
@@ -301,6 +349,8 @@ size_t TextureResource::getTotalMemUsage()
 	total += sTextureDataManager.getCommittedSize();
 	// And the size of the loading queue
 	total += sTextureDataManager.getQueueSize();
+	// And the cached render layers
+	total += RenderTexture::getTotalMemUsage();
 	return total;
 }
 
@@ -351,4 +401,9 @@ void TextureResource::reload()
 void TextureResource::clearQueue()
 {
 	sTextureDataManager.clearQueue();
+}
+
+void TextureResource::runAsync(const std::function<void()>& job)
+{
+	sTextureDataManager.run(job);
 }
\ No newline at end of file
@@ -23,6 +23,7 @@ public:
 	static std::shared_ptr<TextureResource> get(const std::string& path, bool tile = false, bool linear = false, bool forceLoad = false, bool dynamic = true, bool asReloadable = true, MaxSizeInfo* maxSize = nullptr);
 	void initFromPixels(unsigned char* dataRGBA, size_t width, size_t height);
 	void initFromExternalPixels(unsigned char* dataRGBA, size_t width, size_t height);
+	bool initFromPixelBuffer(unsigned int pixelBuffer, size_t width, size_t height);
 	virtual void initFromMemory(const char* file, size_t length);
 
 	// For scalable source images in textures we want to set the resolution to rasterize at
@@ -47,6 +48,9 @@ public:
 
 	static void clearQueue();
 
+	// Runs a job on the texture loader threads (ex: decoding the next frames of an animation)
+	static void runAsync(const std::function<void()>& job);
+
 private:
 	// mTextureData is used for textures that are not loaded from a file - these ones
 	// are permanently allocated and cannot be loaded and unloaded based on resources
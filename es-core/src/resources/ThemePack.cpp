@@ -0,0 +1,359 @@
+#include "resources/ThemePack.h"
+
+#include "utils/StringUtil.h"
+#include "Log.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#define THEME_PACK_MAGIC	"ESTPACK2"
+#define THEME_PACK_NAME		"theme.pack"
+
+// Layout : header, entries, names, then the files, each one aligned on 8 bytes. Offsets are from the start of the pack
+struct ThemePackHeader
+{
+	char     magic[8];
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct ThemePackEntry
+{
+	uint64_t nameOffset;
+	uint64_t dataOffset;
+	uint64_t dataLength;
+	uint32_t nameLength;
+	uint32_t reserved;
+	int64_t  modificationTime; // of the source file, whose size is dataLength
+};
+
+static std::mutex sLock;
+static std::vector<std::shared_ptr<ThemePack>> sPacks;
+static std::string sLastFolder; // theme set of the last open, all the systems of a theme load share it
+
+static const char* sPackedExtensions[] = { ".xml", ".png", ".jpg", ".jpeg", ".svg", ".gif", ".ttf", ".otf" };
+
+static std::string getKey(const std::string& name)
+{
+#if WIN32
+	return Utils::String::toLower(name);
+#else
+	return name;
+#endif
+}
+
+// "<folder>/nes/../art/logo.png" -> "art/logo.png", empty if the path isn't below the folder
+static std::string getPackName(const std::string& folder, const std::string& _path)
+{
+	std::string path = Utils::FileSystem::getGenericPath(_path);
+	if (path.size() <= folder.size() + 1 || path.compare(0, folder.size(), folder) != 0 || path[folder.size()] != '/')
+		return "";
+
+	std::vector<std::string> segments;
+
+	size_t start = folder.size() + 1;
+	while (start <= path.size())
+	{
+		size_t end = path.find('/', start);
+		if (end == std::string::npos)
+			end = path.size();
+
+		std::string segment = path.substr(start, end - start);
+		if (segment == "..")
+		{
+			if (segments.empty())
+				return "";
+
+			segments.pop_back();
+		}
+		else if (!segment.empty() && segment != ".")
+			segments.push_back(segment);
+
+		start = end + 1;
+	}
+
+	std::string name;
+	for (auto& segment : segments)
+		name += (name.empty() ? "" : "/") + segment;
+
+	return getKey(name);
+}
+
+static int compareName(const char* name, size_t length, const std::string& key)
+{
+	int result = memcmp(name, key.data(), std::min(length, key.size()));
+	if (result != 0)
+		return result;
+
+	return length < key.size() ? -1 : (length > key.size() ? 1 : 0);
+}
+
+ThemePack::ThemePack(const std::string& folder, const std::string& path, size_t size, time_t date)
+	: mFolder(folder), mSize(size), mDate(date), mEntries(nullptr), mCount(0)
+{
+	mFile = std::make_shared<Utils::FileSystem::MappedFile>(path);
+
+	const char* data = mFile->data();
+	size_t length = mFile->size();
+
+	if (data == nullptr || length < sizeof(ThemePackHeader))
+		return;
+
+	const ThemePackHeader* header = (const ThemePackHeader*)data;
+	if (memcmp(header->magic, THEME_PACK_MAGIC, sizeof(header->magic)) != 0)
+		return;
+
+	if ((length - sizeof(ThemePackHeader)) / sizeof(ThemePackEntry) < header->count)
+		return;
+
+	const ThemePackEntry* entries = (const ThemePackEntry*)(data + sizeof(ThemePackHeader));
+	for (unsigned int i = 0; i < header->count; i++)
+		if (entries[i].nameOffset + entries[i].nameLength > length || entries[i].dataOffset + entries[i].dataLength > length)
+			return;
+
+	mEntries = entries;
+	mCount = header->count;
+	mCurrent = checkEntries();
+}
+
+std::vector<bool> ThemePack::checkEntries() const
+{
+	std::vector<bool> current(mCount);
+
+	const char* data = mFile->data();
+	for (unsigned int i = 0; i < mCount; i++)
+	{
+		std::string path = mFolder + "/" + std::string(data + mEntries[i].nameOffset, mEntries[i].nameLength);
+
+		current[i] = Utils::FileSystem::getFileSize(path) == (size_t)mEntries[i].dataLength &&
+			(int64_t)Utils::FileSystem::getFileModificationDate(path).getTime() == mEntries[i].modificationTime;
+	}
+
+	return current;
+}
+
+const ThemePackEntry* ThemePack::find(const std::string& path) const
+{
+	std::string key = getPackName(mFolder, path);
+	if (key.empty())
+		return nullptr;
+
+	const char* data = mFile->data();
+
+	const ThemePackEntry* entry = std::lower_bound(mEntries, mEntries + mCount, key, [data](const ThemePackEntry& entry, const std::string& key)
+	{
+		return compareName(data + entry.nameOffset, entry.nameLength, key) < 0;
+	});
+
+	if (entry == mEntries + mCount || compareName(data + entry->nameOffset, entry->nameLength, key) != 0)
+		return nullptr;
+
+	// Changed since the pack was built : the theme folder has the right one
+	if (!mCurrent[entry - mEntries])
+		return nullptr;
+
+	return entry;
+}
+
+std::shared_ptr<ThemePack> ThemePack::getPack(const std::string& path)
+{
+	std::unique_lock<std::mutex> lock(sLock);
+
+	for (auto& pack : sPacks)
+		if (path.size() > pack->mFolder.size() && path.compare(0, pack->mFolder.size(), pack->mFolder) == 0 && (path[pack->mFolder.size()] == '/' || path[pack->mFolder.size()] == '\\'))
+			return pack;
+
+	return nullptr;
+}
+
+void ThemePack::open(const std::string& themeFolder)
+{
+	std::string folder = Utils::FileSystem::getGenericPath(themeFolder);
+	std::string path = folder + "/" + THEME_PACK_NAME;
+
+	size_t size = Utils::FileSystem::getFileSize(path);
+	time_t date = (size == 0 ? 0 : Utils::FileSystem::getFileModificationDate(path).getTime());
+
+	auto findPack = [&folder](const std::shared_ptr<ThemePack>& pack) { return pack->mFolder == folder; };
+
+	std::shared_ptr<ThemePack> current;
+	bool themeChanged;
+
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+
+		auto it = std::find_if(sPacks.begin(), sPacks.end(), findPack);
+		if (it != sPacks.end())
+			current = *it;
+
+		themeChanged = (sLastFolder != folder);
+		sLastFolder = folder;
+	}
+
+	// open is called for each system : the theme files are only checked again when switching back to this theme set,
+	// without holding the lock
+	if (current != nullptr && current->mSize == size && current->mDate == date && (!themeChanged || current->checkEntries() == current->mCurrent))
+		return;
+
+	std::shared_ptr<ThemePack> pack;
+	if (size != 0)
+		pack = std::shared_ptr<ThemePack>(new ThemePack(folder, path, size, date));
+
+	std::unique_lock<std::mutex> lock(sLock);
+
+	// Removed, built again or theme files changed. Files still in use keep the previous mapping alive
+	auto it = std::find_if(sPacks.begin(), sPacks.end(), findPack);
+	if (it != sPacks.end())
+		sPacks.erase(it);
+
+	if (pack == nullptr)
+		return;
+
+	if (pack->mEntries == nullptr)
+	{
+		LOG(LogWarning) << "ThemePack : " << path << " is invalid, build it again";
+		return;
+	}
+
+	sPacks.push_back(pack);
+
+	size_t changed = std::count(pack->mCurrent.cbegin(), pack->mCurrent.cend(), false);
+	if (changed > 0)
+		LOG(LogWarning) << "ThemePack : " << changed << " files changed since " << path << " was built, they are read from the theme folder. Build it again";
+
+	LOG(LogInfo) << "ThemePack : using " << path << " (" << pack->mCount - changed << " files)";
+}
+
+bool ThemePack::contains(const std::string& path)
+{
+	std::shared_ptr<ThemePack> pack = getPack(path);
+	return pack != nullptr && pack->find(path) != nullptr;
+}
+
+ResourceData ThemePack::getFileData(const std::string& path)
+{
+	std::shared_ptr<ThemePack> pack = getPack(path);
+	const ThemePackEntry* entry = (pack != nullptr ? pack->find(path) : nullptr);
+
+	if (entry == nullptr || entry->dataLength == 0)
+	{
+		ResourceData data = { NULL, 0 };
+		return data;
+	}
+
+	ResourceData data = { std::shared_ptr<unsigned char>(pack->mFile, (unsigned char*)pack->mFile->data() + entry->dataOffset), (size_t)entry->dataLength };
+	return data;
+}
+
+bool ThemePack::build(const std::string& themeFolder, std::string& error)
+{
+	std::string folder = Utils::FileSystem::getAbsolutePath(themeFolder);
+	if (!Utils::FileSystem::isDirectory(folder))
+	{
+		error = folder + " is not a directory";
+		return false;
+	}
+
+	// pack name, path
+	std::vector<std::pair<std::string, std::string>> files;
+
+	for (auto file : Utils::FileSystem::getDirContent(folder, true))
+	{
+		if (!Utils::FileSystem::isRegularFile(file))
+			continue;
+
+		std::string extension = Utils::String::toLower(Utils::FileSystem::getExtension(file));
+		if (std::find(std::begin(sPackedExtensions), std::end(sPackedExtensions), extension) == std::end(sPackedExtensions))
+			continue;
+
+		std::string name = getPackName(folder, file);
+		if (!name.empty())
+			files.push_back(std::make_pair(name, file));
+	}
+
+	std::sort(files.begin(), files.end());
+
+	std::vector<ThemePackEntry> entries(files.size());
+
+	uint64_t offset = sizeof(ThemePackHeader) + entries.size() * sizeof(ThemePackEntry);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		entries[i].nameOffset = offset;
+		entries[i].nameLength = (uint32_t)files[i].first.size();
+		entries[i].reserved = 0;
+		offset += files[i].first.size();
+	}
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		offset = (offset + 7) & ~(uint64_t)7;
+
+		entries[i].dataOffset = offset;
+		entries[i].dataLength = Utils::FileSystem::getFileSize(files[i].second);
+		entries[i].modificationTime = (int64_t)Utils::FileSystem::getFileModificationDate(files[i].second).getTime();
+		offset += entries[i].dataLength;
+	}
+
+	std::string path = folder + "/" + THEME_PACK_NAME;
+	std::string tmpPath = path + ".tmp";
+
+	std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		error = "unable to write " + tmpPath;
+		return false;
+	}
+
+	ThemePackHeader header;
+	memcpy(header.magic, THEME_PACK_MAGIC, sizeof(header.magic));
+	header.count = (uint32_t)entries.size();
+	header.reserved = 0;
+
+	file.write((const char*)&header, sizeof(header));
+	if (!entries.empty())
+		file.write((const char*)entries.data(), entries.size() * sizeof(ThemePackEntry));
+
+	for (auto& item : files)
+		file.write(item.first.data(), item.first.size());
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		// Padding
+		while ((uint64_t)file.tellp() < entries[i].dataOffset)
+			file.put(0);
+
+		Utils::FileSystem::MappedFile content(files[i].second);
+		if (content.size() != entries[i].dataLength || (content.size() > 0 && content.data() == nullptr))
+		{
+			error = "unable to read " + files[i].second;
+			file.close();
+			Utils::FileSystem::removeFile(tmpPath);
+			return false;
+		}
+
+		if (content.size() > 0)
+			file.write(content.data(), content.size());
+	}
+
+	file.close();
+	if (file.fail())
+	{
+		error = "unable to write " + tmpPath;
+		Utils::FileSystem::removeFile(tmpPath);
+		return false;
+	}
+
+	Utils::FileSystem::removeFile(path);
+	if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		error = "unable to write " + path;
+		return false;
+	}
+
+	LOG(LogInfo) << "ThemePack : " << path << " built with " << files.size() << " files";
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef ES_CORE_RESOURCES_THEME_PACK_H
+#define ES_CORE_RESOURCES_THEME_PACK_H
+
+#include "resources/ResourceManager.h"
+#include "utils/FileSystemUtil.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ThemePackEntry;
+
+// Single file holding the xml, images and fonts of a theme set (<theme set>/theme.pack), read through one memory mapping.
+// A theme is made of dozens of includes and hundreds of images : on SD cards, loading it is mostly small file I/O.
+// The pack is built with "emulationstation --build-theme-pack <theme set>", and must be built again when the theme
+// changes. Files which are not in the pack (videos, sounds...) are read from the theme folder as usual, and so are
+// the packed files whose size or modification time changed since the pack was built.
+class ThemePack
+{
+public:
+	static bool build(const std::string& themeFolder, std::string& error);
+
+	// Serves the files below this theme set from its pack, if it has one
+	static void open(const std::string& themeFolder);
+
+	static bool contains(const std::string& path);
+
+	// Empty data if the file isn't packed. The data keeps the mapping alive
+	static ResourceData getFileData(const std::string& path);
+
+private:
+	ThemePack(const std::string& folder, const std::string& path, size_t size, time_t date);
+
+	const ThemePackEntry* find(const std::string& path) const;
+
+	// For each entry, whether the file in the theme folder is still the one that was packed
+	std::vector<bool> checkEntries() const;
+
+	static std::shared_ptr<ThemePack> getPack(const std::string& path);
+
+	std::string mFolder;
+	size_t      mSize;
+	time_t      mDate;
+
+	std::shared_ptr<Utils::FileSystem::MappedFile> mFile;
+	const ThemePackEntry* mEntries; // sorted by name, nullptr if the pack is invalid
+	unsigned int mCount;
+	std::vector<bool> mCurrent;
+};
+
+#endif // ES_CORE_RESOURCES_THEME_PACK_H
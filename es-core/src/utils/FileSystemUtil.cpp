@@ -3,9 +3,11 @@
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
 
+#include "Log.h"
 #include "Settings.h"
 #include <sys/stat.h>
 #include <string.h>
+#include <time.h>
 
 #if defined(_WIN32)
 // because windows...
@@ -21,12 +23,18 @@
 #define S_ISDIR(x) (((x) & S_IFMT) == S_IFDIR)
 #else // _WIN32
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <mutex>
 #endif // _WIN32
 
+#include <atomic>
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace Utils
 {
@@ -56,6 +64,8 @@ namespace Utils
 
 	// FileCache
 
+		#define FILE_CACHE_SHARDS	16
+
 		struct FileCache
 		{
 			FileCache() {}
@@ -113,8 +123,6 @@ namespace Utils
 			{
 				int ret = stat64(key.c_str(), info);
 
-				std::unique_lock<std::mutex> lock(mFileCacheMutex);
-
 				FileCache cache(ret == 0, false);
 				if (cache.exists)
 				{
@@ -124,58 +132,287 @@ namespace Utils
 #endif
 				}
 
-				mFileCache[key] = cache;
+				add(key, cache);
 
 				return ret;
 			}
 
-			static void add(const std::string& key, FileCache cache)
+			static void add(const std::string& key, FileCache cache);
+			static bool get(const std::string& key, FileCache& cache);
+
+			// All the entries of this directory are being added, missing ones don't exist
+			static void setEnumerated(const std::string& path);
+
+			static void validate();
+			static void load();
+			static void save();
+
+			static void setEnabled(bool value) { mEnabled = value; }
+
+			static std::atomic<unsigned int> mHits;
+			static std::atomic<unsigned int> mMisses;
+
+		private:
+			static bool mEnabled;
+		};
+
+		std::atomic<unsigned int> FileCache::mHits(0);
+		std::atomic<unsigned int> FileCache::mMisses(0);
+		bool FileCache::mEnabled = false;
+
+		// The entries of a directory stay valid as long as its modification time doesn't change
+		struct FileCacheDirectory
+		{
+			time_t modificationTime; // 0 if missing, -1 if changed too recently to be trusted
+			bool   enumerated;
+		};
+
+		// A file and its directory are always in the same shard
+		struct FileCacheShard
+		{
+			std::mutex lock;
+			std::unordered_map<std::string, FileCache> files;
+			std::unordered_map<std::string, FileCacheDirectory> directories;
+		};
+
+		static FileCacheShard sFileCacheShards[FILE_CACHE_SHARDS];
+		static std::atomic<bool> sFileCacheDirty(false);
+
+		static FileCacheShard& getFileCacheShard(const std::string& directory)
+		{
+			return sFileCacheShards[std::hash<std::string>()(directory) % FILE_CACHE_SHARDS];
+		}
+
+		static time_t getDirectoryTime(const std::string& path)
+		{
+			struct stat64 info;
+			if (stat64(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+				return 0;
+
+			// A second change made in the same second would keep the same time
+			if (time(NULL) - info.st_mtime < 2)
+				return -1;
+
+			return info.st_mtime;
+		}
+
+		// Called with the shard lock held
+		static void removeDirectoryEntries(FileCacheShard& shard, const std::unordered_set<std::string>& directories)
+		{
+			for (auto& directory : directories)
+				shard.directories.erase(directory);
+
+			for (auto it = shard.files.begin(); it != shard.files.end(); )
+			{
+				if (directories.find(getParent(it->first)) != directories.cend())
+					it = shard.files.erase(it);
+				else
+					++it;
+			}
+		}
+
+		void FileCache::add(const std::string& key, FileCache cache)
+		{
+			if (!mEnabled)
+				return;
+
+			std::string parent = getParent(key);
+			FileCacheShard& shard = getFileCacheShard(parent);
+
 			{
-				if (!mEnabled)
+				std::unique_lock<std::mutex> lock(shard.lock);
+				shard.files[key] = cache;
+
+				if (shard.directories.find(parent) != shard.directories.cend())
 					return;
+			}
+
+			// First entry of this directory
+			FileCacheDirectory directory;
+			directory.modificationTime = getDirectoryTime(parent);
+			directory.enumerated = false;
+
+			std::unique_lock<std::mutex> lock(shard.lock);
+			shard.directories.insert(std::make_pair(parent, directory));
+			sFileCacheDirty = true;
+		}
+
+		bool FileCache::get(const std::string& key, FileCache& cache)
+		{
+			if (!mEnabled)
+				return false;
 
-				std::unique_lock<std::mutex> lock(mFileCacheMutex);
-				mFileCache[key] = cache;
+			std::string parent = getParent(key);
+			FileCacheShard& shard = getFileCacheShard(parent);
+
+			std::unique_lock<std::mutex> lock(shard.lock);
+
+			auto it = shard.files.find(key);
+			if (it != shard.files.cend())
+			{
+				mHits++;
+				cache = it->second;
+				return true;
 			}
 
-			static FileCache* get(const std::string& key)
+			auto directory = shard.directories.find(parent);
+			if (directory != shard.directories.cend() && directory->second.enumerated)
 			{
-				if (!mEnabled)
-					return nullptr;
+				mHits++;
+				cache = FileCache(false, false);
+				shard.files[key] = cache;
+				return true;
+			}
 
-				std::unique_lock<std::mutex> lock(mFileCacheMutex);
+			mMisses++;
+			return false;
+		}
+
+		void FileCache::setEnumerated(const std::string& path)
+		{
+			if (!mEnabled)
+				return;
+
+			// Taken before reading the entries, so that a change made meanwhile is seen later
+			time_t modificationTime = getDirectoryTime(path);
+
+			FileCacheShard& shard = getFileCacheShard(path);
+			std::unique_lock<std::mutex> lock(shard.lock);
+
+			auto it = shard.directories.find(path);
+			if (it != shard.directories.cend() && it->second.modificationTime != modificationTime)
+			{
+				std::unordered_set<std::string> outdated;
+				outdated.insert(path);
+				removeDirectoryEntries(shard, outdated);
+			}
 
-				auto it = mFileCache.find(key);
-				if (it != mFileCache.cend())
-					return &it->second;
+			FileCacheDirectory& directory = shard.directories[path];
+			directory.modificationTime = modificationTime;
+			directory.enumerated = true;
+
+			sFileCacheDirty = true;
+		}
+
+		// Drops the entries of the directories changed since they were cached : one stat per directory instead of one per file
+		void FileCache::validate()
+		{
+			int directories = 0;
+			int outdatedDirectories = 0;
+
+			for (auto& shard : sFileCacheShards)
+			{
+				std::vector<std::pair<std::string, time_t>> times;
 
-				it = mFileCache.find(Utils::FileSystem::getParent(key) + "/*");
-				if (it != mFileCache.cend())
 				{
-					mFileCache[key] = FileCache(false, false);
-					return &mFileCache[key];
+					std::unique_lock<std::mutex> lock(shard.lock);
+					times.reserve(shard.directories.size());
+
+					for (auto& directory : shard.directories)
+						times.push_back(std::make_pair(directory.first, directory.second.modificationTime));
 				}
 
-				return nullptr;
+				std::unordered_set<std::string> outdated;
+				for (auto& time : times)
+					if (time.second == -1 || getDirectoryTime(time.first) != time.second)
+						outdated.insert(time.first);
+
+				directories += (int)times.size();
+				outdatedDirectories += (int)outdated.size();
+
+				if (outdated.empty())
+					continue;
+
+				std::unique_lock<std::mutex> lock(shard.lock);
+				removeDirectoryEntries(shard, outdated);
+				sFileCacheDirty = true;
 			}
 
-			static void resetCache()
+			LOG(LogDebug) << "FileCache : " << outdatedDirectories << " of " << directories << " directories changed";
+		}
+
+		static std::string getFileCachePath()
+		{
+			return getEsConfigPath() + "/filesystem.cache";
+		}
+
+		void FileCache::load()
+		{
+			std::ifstream file(getFileCachePath());
+			if (!file.is_open())
+				return;
+
+			// D|time|enumerated|path, then F|exists directory hidden symlink|path
+			std::string line;
+			while (std::getline(file, line))
 			{
-				std::unique_lock<std::mutex> lock(mFileCacheMutex);
-				mFileCache.clear();
+				if (line.size() < 4 || line[1] != '|')
+					continue;
+
+				if (line[0] == 'D')
+				{
+					size_t pos = line.find('|', 2);
+					if (pos == std::string::npos || pos + 3 > line.size())
+						continue;
+
+					FileCacheDirectory directory;
+					directory.modificationTime = (time_t)atoll(line.substr(2, pos - 2).c_str());
+					directory.enumerated = (line[pos + 1] == '1');
+
+					std::string path = line.substr(pos + 3);
+					getFileCacheShard(path).directories[path] = directory;
+				}
+				else if (line[0] == 'F' && line.size() > 7)
+				{
+					std::string path = line.substr(7);
+					FileCacheShard& shard = getFileCacheShard(getParent(path));
+
+					// Entries can only be validated through their directory
+					if (shard.directories.find(getParent(path)) == shard.directories.cend())
+						continue;
+
+					FileCache cache(line[2] == '1', line[3] == '1');
+					cache.hidden = (line[4] == '1');
+					cache.isSymLink = (line[5] == '1');
+					shard.files[path] = cache;
+				}
 			}
+		}
 
-			static void setEnabled(bool value) { mEnabled = value; }
+		void FileCache::save()
+		{
+			if (!sFileCacheDirty)
+				return;
 
-		private:
-			static std::map<std::string, FileCache> mFileCache;
-			static std::mutex mFileCacheMutex;
-			static bool mEnabled;
-		};
+			std::string path = getFileCachePath();
+			std::string tmpPath = path + ".tmp";
 
-		std::map<std::string, FileCache> FileCache::mFileCache;
-		std::mutex FileCache::mFileCacheMutex;
-		bool FileCache::mEnabled = false;
+			std::ofstream file(tmpPath, std::ios_base::out | std::ios_base::trunc);
+			if (!file.is_open())
+				return;
+
+			for (auto& shard : sFileCacheShards)
+			{
+				std::unique_lock<std::mutex> lock(shard.lock);
+
+				for (auto& directory : shard.directories)
+					file << "D|" << (long long)directory.second.modificationTime << "|" << (directory.second.enumerated ? "1" : "0") << "|" << directory.first << "\n";
+			}
+
+			for (auto& shard : sFileCacheShards)
+			{
+				std::unique_lock<std::mutex> lock(shard.lock);
+
+				for (auto& item : shard.files)
+					file << "F|" << item.second.exists << item.second.directory << item.second.hidden << item.second.isSymLink << "|" << item.first << "\n";
+			}
+
+			file.close();
+
+			removeFile(path);
+			if (std::rename(tmpPath.c_str(), path.c_str()) == 0)
+				sFileCacheDirty = false;
+		}
 
 	// FileSystemCacheActivator
 
@@ -185,8 +422,8 @@ namespace Utils
 		{
 			if (mReferenceCount == 0)
 			{
+				FileCache::validate();
 				FileCache::setEnabled(true);
-				FileCache::resetCache();
 			}
 
 			mReferenceCount++;
@@ -199,10 +436,30 @@ namespace Utils
 			if (mReferenceCount <= 0)
 			{
 				FileCache::setEnabled(false);
-				FileCache::resetCache();
+				LOG(LogDebug) << "FileCache : " << FileCache::mHits << " hits, " << FileCache::mMisses << " misses";
 			}
 		}
 
+		void FileSystemCacheActivator::loadCache()
+		{
+			FileCache::load();
+		}
+
+		void FileSystemCacheActivator::saveCache()
+		{
+			FileCache::save();
+		}
+
+		unsigned int FileSystemCacheActivator::getHits()
+		{
+			return FileCache::mHits;
+		}
+
+		unsigned int FileSystemCacheActivator::getMisses()
+		{
+			return FileCache::mMisses;
+		}
+
 	// Methods
 
 		stringList getDirContent(const std::string& _path, const bool _recursive)
@@ -214,7 +471,7 @@ namespace Utils
 			if(isDirectory(path))
 			{
 				// tell filecache we enumerated the folder
-				FileCache::add(path + "/*", FileCache(true, true));
+				FileCache::setEnumerated(path);
 
 #if defined(_WIN32)
 				WIN32_FIND_DATAW findData;
@@ -295,7 +552,7 @@ namespace Utils
 			if (isDirectory(path))
 			{
 				// tell filecache we enumerated the folder
-				FileCache::add(path + "/*", FileCache(true, true));
+				FileCache::setEnumerated(path);
 
 #if defined(_WIN32)
 				WIN32_FIND_DATAW findData;
@@ -482,26 +739,52 @@ namespace Utils
 			return path;
 		}
 
+		// True if getGenericPath would return the path unchanged
+		static bool isGenericPath(const std::string& _path)
+		{
+			size_t length = _path.length();
+			if (length == 0)
+				return true;
+
+			if (_path[length - 1] == '/')
+				return false;
+
+			const char* data = _path.c_str();
+			for (size_t i = 0; i < length; i++)
+				if (data[i] == '\\' || (data[i] == '/' && data[i + 1] == '/'))
+					return false;
+
+			return true;
+		}
+
 		std::string getGenericPath(const std::string& _path)
 		{
-			std::string path   = _path;
-			size_t      offset = std::string::npos;
+			// most paths are already generic
+			if (isGenericPath(_path))
+				return _path;
+
+			size_t start = 0;
 
 			// remove "\\\\?\\"
-			if((path.find("\\\\?\\")) == 0)
-				path.erase(0, 4);
+			if(_path.compare(0, 4, "\\\\?\\") == 0)
+				start = 4;
 
-			// convert '\\' to '/'
-			while((offset = path.find('\\')) != std::string::npos)
-				path.replace(offset, 1 ,"/");
+			std::string path;
+			path.reserve(_path.length() - start);
 
-			// remove double '/'
-			while((offset = path.find("//")) != std::string::npos)
-				path.erase(offset, 1);
+			// convert '\\' to '/' and remove double '/', in one pass
+			for (size_t i = start; i < _path.length(); i++)
+			{
+				char c = (_path[i] == '\\' ? '/' : _path[i]);
+				if (c == '/' && !path.empty() && path[path.length() - 1] == '/')
+					continue;
+
+				path += c;
+			}
 
 			// remove trailing '/'
-			while(path.length() && ((offset = path.find_last_of('/')) == (path.length() - 1)))
-				path.erase(offset, 1);
+			while(path.length() && path[path.length() - 1] == '/')
+				path.erase(path.length() - 1);
 
 			// return generic path
 			return path;
@@ -631,62 +914,72 @@ namespace Utils
 
 		std::string getParent(const std::string& _path)
 		{
-			std::string path   = getGenericPath(_path);
-			size_t      offset = std::string::npos;
+			if (!isGenericPath(_path))
+				return getParent(getGenericPath(_path));
 
-			// find last '/' and erase it
-			if((offset = path.find_last_of('/')) != std::string::npos)
-				return path.erase(offset);
+			// find last '/' and return what's before
+			size_t offset = _path.find_last_of('/');
+			if(offset != std::string::npos)
+				return std::string(_path, 0, offset);
 
 			// no parent found
-			return path;
+			return _path;
 
 		} // getParent
 
-		std::string getFileName(const std::string& _path)
+		// Position of the file name in a generic path
+		static size_t getFileNameOffset(const std::string& _path)
 		{
-			std::string path   = getGenericPath(_path);
-			size_t      offset = std::string::npos;
+			size_t offset = _path.find_last_of('/');
+			return offset == std::string::npos ? 0 : offset + 1;
+		}
 
-			// find last '/' and return the filename
-			if((offset = path.find_last_of('/')) != std::string::npos)
-				return ((path[offset + 1] == 0) ? "." : std::string(path, offset + 1));
+		std::string getFileName(const std::string& _path)
+		{
+			if (!isGenericPath(_path))
+				return getFileName(getGenericPath(_path));
 
 			// no '/' found, entire path is a filename
-			return path;
+			return std::string(_path, getFileNameOffset(_path));
 
 		} // getFileName
 
 		std::string getStem(const std::string& _path)
 		{
-			std::string fileName = getFileName(_path);
-			size_t      offset   = std::string::npos;
+			if (!isGenericPath(_path))
+				return getStem(getGenericPath(_path));
+
+			size_t start = getFileNameOffset(_path);
 
 			// empty fileName
-			if(fileName == ".")
-				return fileName;
+			if(_path.compare(start, std::string::npos, ".") == 0)
+				return ".";
 
 			// find last '.' and erase the extension
-			if((offset = fileName.find_last_of('.')) != std::string::npos)
-				return fileName.erase(offset);
+			size_t offset = _path.find_last_of('.');
+			if(offset != std::string::npos && offset >= start)
+				return std::string(_path, start, offset - start);
 
 			// no '.' found, filename has no extension
-			return fileName;
+			return std::string(_path, start);
 
 		} // getStem
 
 		std::string getExtension(const std::string& _path)
 		{
-			std::string fileName = getFileName(_path);
-			size_t      offset   = std::string::npos;
+			if (!isGenericPath(_path))
+				return getExtension(getGenericPath(_path));
+
+			size_t start = getFileNameOffset(_path);
 
 			// empty fileName
-			if(fileName == ".")
-				return fileName;
+			if(_path.compare(start, std::string::npos, ".") == 0)
+				return ".";
 
 			// find last '.' and return the extension
-			if((offset = fileName.find_last_of('.')) != std::string::npos)
-				return std::string(fileName, offset);
+			size_t offset = _path.find_last_of('.');
+			if(offset != std::string::npos && offset >= start)
+				return std::string(_path, offset);
 
 			// no '.' found, filename has no extension
 			return ".";
@@ -844,9 +1137,9 @@ namespace Utils
 			if (_path.empty())
 				return false;
 
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists;
 
 #ifdef WIN32			
 			DWORD dwAttr = GetFileAttributes(_path.c_str());
@@ -880,9 +1173,9 @@ namespace Utils
 
 		bool isRegularFile(const std::string& _path)
 		{
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists && !it->directory && !it->isSymLink;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists && !cache.directory && !cache.isSymLink;
 
 			std::string path = getGenericPath(_path);
 			struct stat64 info;
@@ -898,9 +1191,9 @@ namespace Utils
 
 		bool isDirectory(const std::string& _path)
 		{
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists && it->directory;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists && cache.directory;
 
 #ifdef WIN32
 			// check for symlink attribute
@@ -923,9 +1216,9 @@ namespace Utils
 		bool isSymlink(const std::string& _path)
 		{
 		
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists && it->isSymLink;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists && cache.isSymLink;
 				
 			std::string path = getGenericPath(_path);
 
@@ -953,9 +1246,9 @@ namespace Utils
 
 		bool isHidden(const std::string& _path)
 		{
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists && it->hidden;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists && cache.hidden;
 
 			std::string path = getGenericPath(_path);
 
@@ -1053,6 +1346,18 @@ namespace Utils
 			return Utils::Time::DateTime();
 		}
 
+		Utils::Time::DateTime getFileModificationDate(const std::string& _path)
+		{
+			std::string path = getGenericPath(_path);
+			struct stat64 info;
+
+			// check if stat64 succeeded
+			if ((stat64(path.c_str(), &info) == 0))
+				return Utils::Time::DateTime(info.st_mtime);
+
+			return Utils::Time::DateTime();
+		}
+
 		std::string	readAllText(const std::string fileName)
 		{
 			std::ifstream t(fileName);
@@ -1060,6 +1365,123 @@ namespace Utils
 			buffer << t.rdbuf();
 			return buffer.str();
 		}
+
+		bool createHardLink(const std::string& _target, const std::string& _link)
+		{
+			std::string target = getGenericPath(_target);
+			std::string link = getGenericPath(_link);
+
+#if defined(_WIN32)
+			return CreateHardLinkA(link.c_str(), target.c_str(), NULL) != 0;
+#else
+			return ::link(target.c_str(), link.c_str()) == 0;
+#endif
+		}
+
+		std::string getHardLinkId(const std::string& _path)
+		{
+			std::string path = getGenericPath(_path);
+
+#if defined(_WIN32)
+			HANDLE handle = CreateFileA(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+			if (handle == INVALID_HANDLE_VALUE)
+				return "";
+
+			BY_HANDLE_FILE_INFORMATION info;
+			bool linked = GetFileInformationByHandle(handle, &info) && info.nNumberOfLinks > 1;
+			CloseHandle(handle);
+
+			if (linked)
+				return std::to_string(info.dwVolumeSerialNumber) + ":" + std::to_string(((unsigned long long)info.nFileIndexHigh << 32) | info.nFileIndexLow);
+#else
+			struct stat64 info;
+			if (stat64(path.c_str(), &info) == 0 && info.st_nlink > 1)
+				return std::to_string((unsigned long long)info.st_dev) + ":" + std::to_string((unsigned long long)info.st_ino);
+#endif
+
+			return "";
+		}
+
+		MappedFile::MappedFile(const std::string& _path) : mData(nullptr), mSize(0), mMapped(false)
+		{
+			std::string path = getGenericPath(_path);
+
+#if defined(_WIN32)
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+
+			LARGE_INTEGER size;
+			if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+			{
+				HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+				if (mapping != NULL)
+				{
+					// The view keeps the mapping alive
+					mData = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					CloseHandle(mapping);
+				}
+
+				mSize = (size_t)size.QuadPart;
+				mMapped = (mData != nullptr);
+			}
+
+			CloseHandle(file);
+#else
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				return;
+
+			struct stat64 info;
+			if (fstat64(fd, &info) == 0 && info.st_size > 0)
+			{
+				void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (data != MAP_FAILED)
+				{
+					madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+					mData = (const char*)data;
+					mMapped = true;
+				}
+
+				mSize = (size_t)info.st_size;
+			}
+
+			close(fd);
+#endif
+
+			if (mMapped || mSize == 0)
+				return;
+
+			// Not mappable (special files, some network filesystems) : read it
+			FILE* file = fopen(path.c_str(), "rb");
+			if (file == nullptr)
+			{
+				mSize = 0;
+				return;
+			}
+
+			char* buffer = new char[mSize];
+			mSize = fread(buffer, 1, mSize, file);
+			fclose(file);
+
+			mData = buffer;
+		}
+
+		MappedFile::~MappedFile()
+		{
+			if (mData == nullptr)
+				return;
+
+			if (!mMapped)
+				delete[] mData;
+#if defined(_WIN32)
+			else
+				UnmapViewOfFile(mData);
+#else
+			else
+				munmap((void*)mData, mSize);
+#endif
+		}
 	} // FileSystem::
 
 } // Utils::
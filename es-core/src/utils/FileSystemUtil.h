@@ -60,14 +60,49 @@ namespace Utils
 		std::string combine(const std::string& _path, const std::string& filename);
 		size_t		getFileSize(const std::string& _path);
 		Utils::Time::DateTime getFileCreationDate(const std::string& _path);
+		Utils::Time::DateTime getFileModificationDate(const std::string& _path);
 		std::string	readAllText(const std::string fileName);
 
+		// Makes _link another name of the _target file, fails if the filesystem doesn't support it (FAT...)
+		bool		createHardLink(const std::string& _target, const std::string& _link);
+
+		// Identifies the file behind hardlinked paths, empty if the file has only one name
+		std::string getHardLinkId(const std::string& _path);
+
+		// Read only view of a whole file, memory mapped when possible : pages are loaded on demand and aren't heap memory
+		class MappedFile
+		{
+		public:
+			MappedFile(const std::string& _path);
+			~MappedFile();
+
+			const char* data() const { return mData; } // nullptr if the file can't be read
+			size_t      size() const { return mSize; }
+
+		private:
+			MappedFile(const MappedFile&);
+			MappedFile& operator=(const MappedFile&);
+
+			const char* mData;
+			size_t      mSize;
+			bool        mMapped;
+		};
+
+		// Caches the file attributes while alive. The cache is kept between activations and saved across boots : on
+		// activation, the entries of the directories whose modification time changed are dropped.
 		class FileSystemCacheActivator
 		{
 		public:
 			FileSystemCacheActivator();
 			~FileSystemCacheActivator();
 
+			// ~/.emulationstation/filesystem.cache
+			static void loadCache();
+			static void saveCache();
+
+			static unsigned int getHits();
+			static unsigned int getMisses();
+
 		private:
 			static int mReferenceCount;
 		};
@@ -0,0 +1,113 @@
+#include "utils/InternedPath.h"
+
+#include "utils/FileSystemUtil.h"
+#include <mutex>
+
+namespace Utils
+{
+	namespace FileSystem
+	{
+		static std::mutex sInternLock;
+		static std::unordered_map<std::string, InternedPath*> sTopLevel; // "" for '/', drives on Windows
+		static std::string sSegment; // kept to reuse its buffer, under sInternLock
+
+		InternedPath::InternedPath(const InternedPath* _parent, const std::string& _name)
+			: mParent(_parent), mName(_name), mExtension(_name.find_last_of('.')), mPath(nullptr), mChildren(nullptr)
+		{
+		}
+
+		// Called with sInternLock held
+		InternedPath* InternedPath::getChild(InternedPath* _parent, const std::string& _name)
+		{
+			std::unordered_map<std::string, InternedPath*>* children = &sTopLevel;
+			if (_parent != nullptr)
+			{
+				if (_parent->mChildren == nullptr)
+					_parent->mChildren = new std::unordered_map<std::string, InternedPath*>();
+
+				children = _parent->mChildren;
+			}
+
+			auto it = children->find(_name);
+			if (it != children->cend())
+				return it->second;
+
+			InternedPath* node = new InternedPath(_parent, _name);
+			children->insert(std::make_pair(_name, node));
+			return node;
+		}
+
+		const InternedPath* InternedPath::get(const std::string& _path)
+		{
+			std::string path = getGenericPath(_path);
+			if (path.empty())
+				return nullptr;
+
+			std::unique_lock<std::mutex> lock(sInternLock);
+
+			InternedPath* node = nullptr;
+
+			size_t start = 0;
+			while (true)
+			{
+				size_t end = path.find('/', start);
+				sSegment.assign(path, start, end == std::string::npos ? std::string::npos : end - start);
+
+				node = getChild(node, sSegment);
+
+				if (end == std::string::npos)
+					break;
+
+				start = end + 1;
+			}
+
+			return node;
+		}
+
+		const std::string& InternedPath::getPath() const
+		{
+			std::string* path = mPath.load();
+			if (path != nullptr)
+				return *path;
+
+			if (mParent == nullptr)
+				path = new std::string(mName);
+			else
+			{
+				const std::string& parentPath = mParent->getPath();
+
+				path = new std::string();
+				path->reserve(parentPath.size() + 1 + mName.size());
+				path->append(parentPath).append(1, '/').append(mName);
+			}
+
+			// Another thread may have built it meanwhile
+			std::string* expected = nullptr;
+			if (!mPath.compare_exchange_strong(expected, path))
+			{
+				delete path;
+				return *expected;
+			}
+
+			return *path;
+		}
+
+		std::string InternedPath::getStem() const
+		{
+			if (mName == "." || mExtension == std::string::npos)
+				return mName;
+
+			return mName.substr(0, mExtension);
+		}
+
+		std::string InternedPath::getExtension() const
+		{
+			if (mName == "." || mExtension == std::string::npos)
+				return ".";
+
+			return mName.substr(mExtension);
+		}
+
+	} // FileSystem::
+
+} // Utils::
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef ES_CORE_UTILS_INTERNED_PATH_H
+#define ES_CORE_UTILS_INTERNED_PATH_H
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+namespace Utils
+{
+	namespace FileSystem
+	{
+		// One node per directory or file, holding its parent and its name : a folder is stored once whatever the number
+		// of files it contains, and everyone asking for the same path gets the same node. The full path is only built
+		// when first asked, then kept. Nodes are never freed, a reload finds the nodes it created before.
+		// Thread safe.
+		class InternedPath
+		{
+		public:
+			// Generic path, nullptr if empty
+			static const InternedPath* get(const std::string& _path);
+
+			const InternedPath* getParent() const { return mParent; }
+
+			const std::string& getName() const { return mName; }
+			const std::string& getPath() const;
+
+			// Same results as Utils::FileSystem::getStem / getExtension
+			std::string getStem() const;
+			std::string getExtension() const;
+
+		private:
+			InternedPath(const InternedPath* _parent, const std::string& _name);
+
+			static InternedPath* getChild(InternedPath* _parent, const std::string& _name);
+
+			const InternedPath*               mParent;
+			std::string                       mName;
+			size_t                            mExtension; // last '.' of mName, npos if none
+			mutable std::atomic<std::string*> mPath;
+
+			std::unordered_map<std::string, InternedPath*>* mChildren; // only allocated for folders
+		};
+
+	} // FileSystem::
+
+} // Utils::
+
+#endif // ES_CORE_UTILS_INTERNED_PATH_H